@@ -0,0 +1,328 @@
+// Implementation of background Collada loading
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+
+#include <boost/filesystem.hpp>
+
+#include <libxml/xmlIO.h>
+
+#include <COLLADABUURI.h>
+#include <COLLADAFWRoot.h>
+
+#include <OgreLogManager.h>
+
+#include "OgreColladaAsyncImport.h"
+#include "OgreSceneWriter.h"
+#include "OgreColladaLog.h"
+
+namespace OgreCollada {
+
+// shared between an import, its loading thread, and the libxml2 input callbacks
+struct ImportProgress {
+  ImportProgress() : bytesParsed(0), geometries(0), cancelled(false), opened(false) {}
+
+  std::atomic<size_t> bytesParsed;
+  std::atomic<size_t> geometries;
+  std::atomic<bool> cancelled;
+  std::atomic<bool> opened;        // by our input callbacks
+};
+
+}
+
+namespace {
+
+// The libxml2 parser underneath OpenCOLLADA reads its input through callbacks we can replace.
+// Ours count the bytes handed to the parser, and fail the read once an import is cancelled,
+// which stops parsing right away instead of at the next Collada object.  The parser calls them
+// on the thread that asked it to load, and each import loads on a thread of its own, so the
+// import they belong to is the one running on the calling thread - two imports of the same file
+// never see each other's progress.  The file is matched by canonical path, however the loader
+// spells it; any other file goes to the standard callbacks
+struct ActiveImport {
+  std::string path;                                         // canonical
+  std::shared_ptr<OgreCollada::ImportProgress> progress;
+};
+thread_local const ActiveImport* currentImport = 0;
+std::once_flag callbacksRegistered;
+
+struct ImportInput {
+  std::ifstream stream;
+  std::shared_ptr<OgreCollada::ImportProgress> progress;
+};
+
+// What the parser is asked to open may be a plain path or a (percent-encoded) file URI
+std::string inputPath(const char* filename) {
+  std::string path(filename);
+  if (path.compare(0, 5, "file:") == 0) {
+    path = COLLADABU::URI(path).toNativePath();     // decoded
+  }
+  return path;
+}
+
+// a single spelling of each file, so the import and the parser agree
+std::string canonicalPath(const std::string& path) {
+  if (path.empty()) {
+    return path;
+  }
+  boost::system::error_code ec;
+  boost::filesystem::path canonical = boost::filesystem::canonical(path, ec);
+  return (ec ? boost::filesystem::absolute(path) : canonical).make_preferred().string();
+}
+
+// the import running on this thread, if it is the one reading this file
+const ActiveImport* findImport(const char* filename) {
+  if (!currentImport) {
+    return 0;
+  }
+  return (canonicalPath(inputPath(filename)) == currentImport->path) ? currentImport : 0;
+}
+
+int XMLCALL matchImport(const char* filename) {
+  return findImport(filename) ? 1 : 0;
+}
+
+void* XMLCALL openImport(const char* filename) {
+  const ActiveImport* active = findImport(filename);
+  if (!active) {
+    return 0;
+  }
+  std::unique_ptr<ImportInput> input(new ImportInput);
+  input->progress = active->progress;
+  input->stream.open(active->path.c_str(), std::ios::binary);
+  if (!input->stream.is_open()) {
+    return 0;
+  }
+  input->progress->opened = true;
+  return input.release();
+}
+
+int XMLCALL readImport(void* context, char* buffer, int len) {
+  ImportInput* input = static_cast<ImportInput*>(context);
+  if (input->progress->cancelled) {
+    return -1;
+  }
+  input->stream.read(buffer, len);
+  std::streamsize count = input->stream.gcount();
+  if ((count == 0) && input->stream.bad()) {
+    return -1;
+  }
+  input->progress->bytesParsed += count;
+  return int(count);
+}
+
+int XMLCALL closeImport(void* context) {
+  delete static_cast<ImportInput*>(context);
+  return 0;
+}
+
+// makes an import the current thread's for as long as it is loading
+class ImportScope {
+ public:
+  ImportScope(const std::string& path, const std::shared_ptr<OgreCollada::ImportProgress>& progress) {
+    std::call_once(callbacksRegistered,
+		   []() { xmlRegisterInputCallbacks(matchImport, openImport, readImport, closeImport); });
+    m_import.path = canonicalPath(path);
+    m_import.progress = progress;
+    currentImport = &m_import;
+  }
+  ~ImportScope() { currentImport = 0; }
+
+ private:
+  ActiveImport m_import;
+};
+
+}
+
+OgreCollada::AsyncImport::AsyncImport(SceneWriter& writer, const Ogre::String& fileName)
+  : m_writer(writer), m_fileName(fileName), m_fileSize(0), m_progress(std::make_shared<ImportProgress>()),
+    m_proxy(writer, *m_progress), m_resourcesCreated(false), m_result(false) {
+
+  boost::system::error_code ec;
+  boost::uintmax_t size = boost::filesystem::file_size(fileName, ec);
+  if (!ec) {
+    m_fileSize = size_t(size);
+  }
+
+  m_writer.setDeferResourceCreation(true);
+  m_loaded = std::async(std::launch::async, [this]() { return load(); }).share();
+}
+
+OgreCollada::AsyncImport::~AsyncImport() {
+  if (!isReady()) {
+    cancel();
+  }
+  m_loaded.wait();
+  if (!m_resourcesCreated) {
+    m_writer.discardDeferredResources();
+  }
+  m_writer.setDeferResourceCreation(false);
+}
+
+bool OgreCollada::AsyncImport::load() {
+  bool result;
+  {
+    ImportScope scope(m_fileName, m_progress);
+    m_loader.setExtraDataWriter(&m_writer);      // it can't see past the proxy
+    COLLADAFW::Root root(&m_loader, &m_proxy);
+    result = root.loadDocument(m_fileName);
+  }
+
+  if (m_progress->cancelled) {
+    LOG_DEBUG("import of " + m_fileName + " cancelled");
+    m_writer.discardDeferredResources();
+    return false;
+  }
+  if (result && !m_progress->opened) {
+    // the parser read the file some other way, so we could neither report progress nor cancel
+    LOG_DEBUG("COLLADA ERROR: " + m_fileName + " was not read through the import's input callbacks");
+    result = false;
+  }
+  if (!result) {
+    LOG_DEBUG("COLLADA ERROR: failed to load " + m_fileName);
+    m_writer.discardDeferredResources();
+  }
+  return result;
+}
+
+size_t OgreCollada::AsyncImport::getBytesParsed() const {
+  return m_progress->bytesParsed;
+}
+
+size_t OgreCollada::AsyncImport::getGeometriesConverted() const {
+  return m_progress->geometries;
+}
+
+void OgreCollada::AsyncImport::cancel() {
+  m_progress->cancelled = true;
+}
+
+bool OgreCollada::AsyncImport::isCancelled() const {
+  return m_progress->cancelled;
+}
+
+bool OgreCollada::AsyncImport::isReady() const {
+  return waitFor(0);
+}
+
+void OgreCollada::AsyncImport::wait() const {
+  m_loaded.wait();
+}
+
+bool OgreCollada::AsyncImport::waitFor(unsigned milliseconds) const {
+  return m_loaded.wait_for(std::chrono::milliseconds(milliseconds)) == std::future_status::ready;
+}
+
+bool OgreCollada::AsyncImport::get() {
+  if (m_resourcesCreated) {
+    return m_result;
+  }
+  m_result = m_loaded.get();
+  m_resourcesCreated = true;
+  if (m_result) {
+    m_writer.createResources();
+  } else {
+    // leave nothing from the failed document behind in the writer
+    m_writer.discardDeferredResources();
+  }
+  m_writer.setDeferResourceCreation(false);
+  return m_result;
+}
+
+OgreCollada::AsyncImport::ProgressWriter::ProgressWriter(SceneWriter& target, ImportProgress& progress)
+  : m_target(target), m_progress(progress) {}
+
+void OgreCollada::AsyncImport::ProgressWriter::cancel(const COLLADAFW::String& errorMessage) {
+  m_target.cancel(errorMessage);
+}
+
+void OgreCollada::AsyncImport::ProgressWriter::start() {
+  m_target.start();
+}
+
+bool OgreCollada::AsyncImport::ProgressWriter::writeGlobalAsset(const COLLADAFW::FileInfo* fi) {
+  return !m_progress.cancelled && m_target.writeGlobalAsset(fi);
+}
+
+bool OgreCollada::AsyncImport::ProgressWriter::writeScene(const COLLADAFW::Scene* s) {
+  return !m_progress.cancelled && m_target.writeScene(s);
+}
+
+bool OgreCollada::AsyncImport::ProgressWriter::writeLibraryNodes(const COLLADAFW::LibraryNodes* ln) {
+  return !m_progress.cancelled && m_target.writeLibraryNodes(ln);
+}
+
+bool OgreCollada::AsyncImport::ProgressWriter::writeMaterial(const COLLADAFW::Material* m) {
+  return !m_progress.cancelled && m_target.writeMaterial(m);
+}
+
+bool OgreCollada::AsyncImport::ProgressWriter::writeEffect(const COLLADAFW::Effect* e) {
+  return !m_progress.cancelled && m_target.writeEffect(e);
+}
+
+bool OgreCollada::AsyncImport::ProgressWriter::writeCamera(const COLLADAFW::Camera* c) {
+  return !m_progress.cancelled && m_target.writeCamera(c);
+}
+
+bool OgreCollada::AsyncImport::ProgressWriter::writeImage(const COLLADAFW::Image* i) {
+  return !m_progress.cancelled && m_target.writeImage(i);
+}
+
+bool OgreCollada::AsyncImport::ProgressWriter::writeLight(const COLLADAFW::Light* l) {
+  return !m_progress.cancelled && m_target.writeLight(l);
+}
+
+bool OgreCollada::AsyncImport::ProgressWriter::writeAnimation(const COLLADAFW::Animation* a) {
+  return !m_progress.cancelled && m_target.writeAnimation(a);
+}
+
+bool OgreCollada::AsyncImport::ProgressWriter::writeAnimationList(const COLLADAFW::AnimationList* al) {
+  return !m_progress.cancelled && m_target.writeAnimationList(al);
+}
+
+bool OgreCollada::AsyncImport::ProgressWriter::writeSkinControllerData(const COLLADAFW::SkinControllerData* scd) {
+  return !m_progress.cancelled && m_target.writeSkinControllerData(scd);
+}
+
+bool OgreCollada::AsyncImport::ProgressWriter::writeController(const COLLADAFW::Controller* c) {
+  return !m_progress.cancelled && m_target.writeController(c);
+}
+
+bool OgreCollada::AsyncImport::ProgressWriter::writeFormulas(const COLLADAFW::Formulas* f) {
+  return !m_progress.cancelled && m_target.writeFormulas(f);
+}
+
+bool OgreCollada::AsyncImport::ProgressWriter::writeKinematicsScene(const COLLADAFW::KinematicsScene* ks) {
+  return !m_progress.cancelled && m_target.writeKinematicsScene(ks);
+}
+
+bool OgreCollada::AsyncImport::ProgressWriter::writeVisualScene(const COLLADAFW::VisualScene* vs) {
+  return !m_progress.cancelled && m_target.writeVisualScene(vs);
+}
+
+bool OgreCollada::AsyncImport::ProgressWriter::writeGeometry(const COLLADAFW::Geometry* g) {
+  if (m_progress.cancelled || !m_target.writeGeometry(g)) {
+    return false;
+  }
+  ++m_progress.geometries;
+  return true;
+}
+
+void OgreCollada::AsyncImport::ProgressWriter::finish() {
+  if (!m_progress.cancelled) {
+    m_target.finish();
+  }
+}
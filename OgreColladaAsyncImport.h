@@ -0,0 +1,116 @@
+// OgreColladaAsyncImport.h, loading a Collada file into a SceneWriter on a background thread
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef OGRE_COLLADA_ASYNCIMPORT_H
+#define OGRE_COLLADA_ASYNCIMPORT_H
+
+#include <future>
+#include <memory>
+
+#include <OgreString.h>
+
+#include "OgreColladaSaxLoader.h"
+#include "OgreColladaWriterBase.h"
+
+namespace OgreCollada {
+
+class SceneWriter;
+struct ImportProgress;
+
+// Parses the file and converts its geometry on a thread of its own, leaving only the creation of
+// Ogre resources (which must happen on the render thread) for get().  Rather like a std::future:
+//
+//   AsyncImport import(writer, "model.dae");
+//   ... each frame, report import.getBytesParsed() / import.getFileSize() ...
+//   if (import.isReady()) { import.get(); }
+//
+// Destroying an import that is still running cancels it.  The writer must not be used by anything
+// else until the import is done with it
+class AsyncImport {
+ public:
+  AsyncImport(SceneWriter&, const Ogre::String& fileName);
+  ~AsyncImport();
+
+  // progress so far
+  size_t getBytesParsed() const;
+  size_t getFileSize() const { return m_fileSize; }
+  size_t getGeometriesConverted() const;
+
+  // Stop parsing as soon as possible and throw away what has been converted.  get() will return false
+  void cancel();
+  bool isCancelled() const;
+
+  // whether the background part is done (successfully or not)
+  bool isReady() const;
+  void wait() const;
+  bool waitFor(unsigned milliseconds) const;
+
+  // Call from the render thread.  Waits for the background part, then creates meshes, textures,
+  // and materials, and instantiates the scene (or prepares to, with incremental instantiation).
+  // Returns false if the load failed or was cancelled, in which case the writer is left empty.
+  // With incremental instantiation the writer's step() uses the document this import owns, so
+  // the stepping must finish before the import is destroyed; afterwards step() returns false
+  bool get();
+
+ private:
+  // hide default xtor and compiler-generated copy and assignment operators
+  AsyncImport();
+  AsyncImport(const AsyncImport&);
+  const AsyncImport& operator=(const AsyncImport&);
+
+  // forwards everything to the SceneWriter, counting geometries and stopping on cancellation
+  class ProgressWriter : public WriterBase {
+  public:
+    ProgressWriter(SceneWriter&, ImportProgress&);
+
+    virtual void cancel(const COLLADAFW::String&);
+    virtual void start();
+    virtual bool writeGlobalAsset(const COLLADAFW::FileInfo*);
+    virtual bool writeScene(const COLLADAFW::Scene*);
+    virtual bool writeLibraryNodes(const COLLADAFW::LibraryNodes*);
+    virtual bool writeMaterial(const COLLADAFW::Material*);
+    virtual bool writeEffect(const COLLADAFW::Effect*);
+    virtual bool writeCamera(const COLLADAFW::Camera*);
+    virtual bool writeImage(const COLLADAFW::Image*);
+    virtual bool writeLight(const COLLADAFW::Light*);
+    virtual bool writeAnimation(const COLLADAFW::Animation*);
+    virtual bool writeAnimationList(const COLLADAFW::AnimationList*);
+    virtual bool writeSkinControllerData(const COLLADAFW::SkinControllerData*);
+    virtual bool writeController(const COLLADAFW::Controller*);
+    virtual bool writeFormulas(const COLLADAFW::Formulas*);
+    virtual bool writeKinematicsScene(const COLLADAFW::KinematicsScene*);
+    virtual bool writeVisualScene(const COLLADAFW::VisualScene*);
+    virtual bool writeGeometry(const COLLADAFW::Geometry*);
+    virtual void finish();
+
+  private:
+    SceneWriter& m_target;
+    ImportProgress& m_progress;
+  };
+
+  bool load();
+
+  SceneWriter& m_writer;
+  Ogre::String m_fileName;
+  size_t m_fileSize;
+  std::shared_ptr<ImportProgress> m_progress;   // shared with the libxml2 input callbacks
+  SaxLoader m_loader;                           // owns the Collada objects the writer refers to
+  ProgressWriter m_proxy;
+  std::shared_future<bool> m_loaded;
+  bool m_resourcesCreated;
+  bool m_result;
+};
+
+} // end namespace OgreCollada
+
+#endif // OGRE_COLLADA_ASYNCIMPORT_H
@@ -0,0 +1,197 @@
+// Implementation of the bounding volume hierarchy
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <algorithm>
+#include <limits>
+
+#include "OgreColladaBvh.h"
+
+namespace {
+
+const Ogre::uint32 MAX_LEAF_ITEMS = 4;
+
+// Slab test.  Returns the distance at which the ray enters the box, or a negative value if it misses
+Ogre::Real enterBox(const Ogre::Vector3& minimum, const Ogre::Vector3& maximum,
+		    const Ogre::Vector3& origin, const Ogre::Vector3& invDirection) {
+  Ogre::Real tnear = 0, tfar = std::numeric_limits<Ogre::Real>::max();
+  for (int axis = 0; axis < 3; ++axis) {
+    Ogre::Real t0 = (minimum[axis] - origin[axis]) * invDirection[axis];
+    Ogre::Real t1 = (maximum[axis] - origin[axis]) * invDirection[axis];
+    if (t0 > t1) {
+      std::swap(t0, t1);
+    }
+    tnear = std::max(tnear, t0);
+    tfar = std::min(tfar, t1);
+    if (tnear > tfar) {
+      return -1;
+    }
+  }
+  return tnear;
+}
+
+bool overlaps(const Ogre::Vector3& amin, const Ogre::Vector3& amax,
+	      const Ogre::Vector3& bmin, const Ogre::Vector3& bmax) {
+  return (amin.x <= bmax.x) && (bmin.x <= amax.x) &&
+    (amin.y <= bmax.y) && (bmin.y <= amax.y) &&
+    (amin.z <= bmax.z) && (bmin.z <= amax.z);
+}
+
+}
+
+const Ogre::uint32 OgreCollada::Bvh::NO_ITEM;
+
+void OgreCollada::Bvh::clear() {
+  m_nodes.clear();
+  m_items.clear();
+  m_itemBounds.clear();
+}
+
+void OgreCollada::Bvh::build(const std::vector<Ogre::AxisAlignedBox>& boxes) {
+  clear();
+  std::vector<Ogre::Vector3> centers;
+  for (size_t i = 0; i < boxes.size(); ++i) {
+    if (!boxes[i].isNull()) {
+      m_items.push_back(Ogre::uint32(i));
+      m_itemBounds.push_back(boxes[i].getMinimum());
+      m_itemBounds.push_back(boxes[i].getMaximum());
+      centers.push_back(boxes[i].getCenter());
+    } else {
+      m_itemBounds.push_back(Ogre::Vector3::ZERO);
+      m_itemBounds.push_back(Ogre::Vector3::ZERO);
+      centers.push_back(Ogre::Vector3::ZERO);
+    }
+  }
+  if (m_items.empty()) {
+    return;
+  }
+
+  // split nodes in turn; each range of items becomes a leaf once it's small enough
+  Node root = { Ogre::Vector3::ZERO, Ogre::Vector3::ZERO, 0, Ogre::uint32(m_items.size()) };
+  m_nodes.push_back(root);
+  std::vector<Ogre::uint32> work(1, 0);
+  while (!work.empty()) {
+    Ogre::uint32 n = work.back();
+    work.pop_back();
+    Ogre::uint32 first = m_nodes[n].first, count = m_nodes[n].count;
+
+    Ogre::Vector3 minimum = boxes[m_items[first]].getMinimum(), maximum = boxes[m_items[first]].getMaximum();
+    Ogre::Vector3 cmin = centers[m_items[first]], cmax = cmin;
+    for (Ogre::uint32 i = first + 1; i < first + count; ++i) {
+      minimum.makeFloor(boxes[m_items[i]].getMinimum());
+      maximum.makeCeil(boxes[m_items[i]].getMaximum());
+      cmin.makeFloor(centers[m_items[i]]);
+      cmax.makeCeil(centers[m_items[i]]);
+    }
+    m_nodes[n].minimum = minimum;
+    m_nodes[n].maximum = maximum;
+    if (count <= MAX_LEAF_ITEMS) {
+      continue;
+    }
+
+    Ogre::Vector3 extent = cmax - cmin;
+    int axis = (extent.x >= extent.y) ? ((extent.x >= extent.z) ? 0 : 2) : ((extent.y >= extent.z) ? 1 : 2);
+    Ogre::uint32 half = count / 2;
+    std::nth_element(m_items.begin() + first, m_items.begin() + first + half, m_items.begin() + first + count,
+		     [&centers, axis](Ogre::uint32 a, Ogre::uint32 b) { return centers[a][axis] < centers[b][axis]; });
+
+    Ogre::uint32 left = Ogre::uint32(m_nodes.size());
+    Node lnode = { Ogre::Vector3::ZERO, Ogre::Vector3::ZERO, first, half };
+    Node rnode = { Ogre::Vector3::ZERO, Ogre::Vector3::ZERO, first + half, count - half };
+    m_nodes.push_back(lnode);
+    m_nodes.push_back(rnode);
+    m_nodes[n].first = left;
+    m_nodes[n].count = 0;
+    work.push_back(left);
+    work.push_back(left + 1);
+  }
+}
+
+Ogre::uint32 OgreCollada::Bvh::raycast(const Ogre::Ray& ray, const HitTest& hitTest, Ogre::Real& distance) const {
+  Ogre::uint32 best = NO_ITEM;
+  if (m_nodes.empty()) {
+    return best;
+  }
+  const Ogre::Vector3& origin = ray.getOrigin();
+  const Ogre::Vector3& dir = ray.getDirection();
+  // division by zero gives infinities, which the slab test handles
+  Ogre::Vector3 inv(Ogre::Real(1) / dir.x, Ogre::Real(1) / dir.y, Ogre::Real(1) / dir.z);
+
+  Ogre::Real bestDistance = std::numeric_limits<Ogre::Real>::max();
+  std::vector<std::pair<Ogre::Real, Ogre::uint32> > stack;   // (entry distance, node)
+  Ogre::Real t = enterBox(m_nodes[0].minimum, m_nodes[0].maximum, origin, inv);
+  if (t >= 0) {
+    stack.push_back(std::make_pair(t, Ogre::uint32(0)));
+  }
+  while (!stack.empty()) {
+    std::pair<Ogre::Real, Ogre::uint32> entry = stack.back();
+    stack.pop_back();
+    if (entry.first > bestDistance) {
+      continue;   // something nearer has been hit already
+    }
+    const Node& node = m_nodes[entry.second];
+    if (node.count > 0) {
+      for (Ogre::uint32 i = node.first; i < node.first + node.count; ++i) {
+	Ogre::uint32 item = m_items[i];
+	Ogre::Real d = enterBox(m_itemBounds[2 * item], m_itemBounds[2 * item + 1], origin, inv);
+	if ((d < 0) || (d > bestDistance)) {
+	  continue;
+	}
+	if (hitTest(item, d) && (d < bestDistance)) {
+	  bestDistance = d;
+	  best = item;
+	}
+      }
+      continue;
+    }
+    // push the farther child first, so the nearer one is searched first
+    Ogre::Real t0 = enterBox(m_nodes[node.first].minimum, m_nodes[node.first].maximum, origin, inv);
+    Ogre::Real t1 = enterBox(m_nodes[node.first + 1].minimum, m_nodes[node.first + 1].maximum, origin, inv);
+    std::pair<Ogre::Real, Ogre::uint32> nearer(t0, node.first), farther(t1, node.first + 1);
+    if ((t1 >= 0) && ((t0 < 0) || (t1 < t0))) {
+      std::swap(nearer, farther);
+    }
+    if (farther.first >= 0) {
+      stack.push_back(farther);
+    }
+    if (nearer.first >= 0) {
+      stack.push_back(nearer);
+    }
+  }
+  distance = bestDistance;
+  return best;
+}
+
+void OgreCollada::Bvh::query(const Ogre::AxisAlignedBox& box, std::vector<Ogre::uint32>& items) const {
+  if (m_nodes.empty() || box.isNull()) {
+    return;
+  }
+  std::vector<Ogre::uint32> stack(1, 0);
+  while (!stack.empty()) {
+    const Node& node = m_nodes[stack.back()];
+    stack.pop_back();
+    if (!overlaps(node.minimum, node.maximum, box.getMinimum(), box.getMaximum())) {
+      continue;
+    }
+    if (node.count > 0) {
+      for (Ogre::uint32 i = node.first; i < node.first + node.count; ++i) {
+	Ogre::uint32 item = m_items[i];
+	if (overlaps(m_itemBounds[2 * item], m_itemBounds[2 * item + 1], box.getMinimum(), box.getMaximum())) {
+	  items.push_back(item);
+	}
+      }
+    } else {
+      stack.push_back(node.first);
+      stack.push_back(node.first + 1);
+    }
+  }
+}
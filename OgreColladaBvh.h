@@ -0,0 +1,58 @@
+// OgreColladaBvh.h, a bounding volume hierarchy for ray and region queries over imported objects
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef OGRE_COLLADA_BVH_H
+#define OGRE_COLLADA_BVH_H
+
+#include <functional>
+#include <vector>
+
+#include <OgreAxisAlignedBox.h>
+#include <OgreRay.h>
+#include <OgreVector3.h>
+
+namespace OgreCollada {
+
+// A binary tree of boxes over a set of items, each known only by its box and its index.
+// Built top down, splitting at the median along the longest axis of the item centers
+class Bvh {
+ public:
+  static const Ogre::uint32 NO_ITEM = ~Ogre::uint32(0);
+
+  void build(const std::vector<Ogre::AxisAlignedBox>& boxes);
+  void clear();
+  bool empty() const { return m_nodes.empty(); }
+
+  // Nearest item hit by the ray.  Boxes are visited front to back, and for each item whose box the ray
+  // enters hitTest decides whether the item itself is hit.  It gets the distance at which the ray enters
+  // the box, to replace with the exact one.  Subtrees farther away than the best hit so far are skipped
+  typedef std::function<bool (Ogre::uint32 item, Ogre::Real& distance)> HitTest;
+  Ogre::uint32 raycast(const Ogre::Ray&, const HitTest&, Ogre::Real& distance) const;
+
+  // items whose boxes intersect the given one
+  void query(const Ogre::AxisAlignedBox&, std::vector<Ogre::uint32>& items) const;
+
+ private:
+  struct Node {
+    Ogre::Vector3 minimum, maximum;
+    Ogre::uint32 first;       // children (at first and first + 1) for an interior node, items for a leaf
+    Ogre::uint32 count;       // items in a leaf; zero for an interior node
+  };
+  std::vector<Node> m_nodes;          // the root is first
+  std::vector<Ogre::uint32> m_items;  // leaves refer to ranges of this
+  std::vector<Ogre::Vector3> m_itemBounds;   // minimum and maximum of each item, by item index
+};
+
+} // end namespace OgreCollada
+
+#endif // OGRE_COLLADA_BVH_H
@@ -0,0 +1,41 @@
+// OgreColladaJson.h, the little JSON output the profiler and memory report need
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef OGRE_COLLADA_JSON_H
+#define OGRE_COLLADA_JSON_H
+
+#include <ostream>
+#include <string>
+
+namespace OgreCollada {
+
+// write a string as a quoted JSON string
+inline void writeJsonString(std::ostream& os, const std::string& s) {
+  os << '"';
+  for (size_t i = 0; i < s.size(); ++i) {
+    unsigned char c = s[i];
+    if ((c == '"') || (c == '\\')) {
+      os << '\\' << c;
+    } else if (c < 0x20) {
+      const char* hex = "0123456789abcdef";
+      os << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+    } else {
+      os << c;
+    }
+  }
+  os << '"';
+}
+
+} // end namespace OgreCollada
+
+#endif // OGRE_COLLADA_JSON_H
@@ -0,0 +1,182 @@
+// Implementation of import memory accounting
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "OgreColladaMemoryAccount.h"
+#include "OgreColladaJson.h"
+
+#include <algorithm>
+
+namespace {
+
+// entries in order of decreasing size, ties by name
+template<typename Size>
+std::vector<std::pair<size_t, Ogre::String> > largestFirst(const std::map<Ogre::String, Size>& entries,
+							   size_t (*size)(const Size&)) {
+  std::vector<std::pair<size_t, Ogre::String> > result;
+  result.reserve(entries.size());
+  for (typename std::map<Ogre::String, Size>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+    result.push_back(std::make_pair(size(it->second), it->first));
+  }
+  std::sort(result.begin(), result.end(),
+	    [](const std::pair<size_t, Ogre::String>& a, const std::pair<size_t, Ogre::String>& b) {
+	      return (a.first > b.first) || ((a.first == b.first) && (a.second < b.second));
+	    });
+  return result;
+}
+
+size_t usageTotal(const OgreCollada::MemoryAccount::Usage& u) { return u.total(); }
+size_t bytes(const size_t& b) { return b; }
+
+void writeUsage(std::ostream& os, const OgreCollada::MemoryAccount::Usage& u) {
+  os << "\"vertexBytes\":" << u.vertexBytes << ",\"indexBytes\":" << u.indexBytes
+     << ",\"textureBytes\":" << u.textureBytes;
+}
+
+}
+
+OgreCollada::MemoryAccount::MemoryAccount() : m_staging(0), m_peakStaging(0) {}
+
+void OgreCollada::MemoryAccount::addGeometryBuffers(const Ogre::String& geometry, size_t vertexBytes, size_t indexBytes) {
+  Usage& u = m_geometries[geometry];
+  u.vertexBytes += vertexBytes;
+  u.indexBytes += indexBytes;
+}
+
+void OgreCollada::MemoryAccount::removeGeometry(const Ogre::String& geometry) {
+  m_geometries.erase(geometry);
+}
+
+void OgreCollada::MemoryAccount::addMaterialBuffers(const Ogre::String& material, size_t vertexBytes, size_t indexBytes) {
+  Usage& u = m_materials[material];
+  u.vertexBytes += vertexBytes;
+  u.indexBytes += indexBytes;
+}
+
+void OgreCollada::MemoryAccount::addTexture(const Ogre::String& texture, size_t bytes) {
+  m_textures[texture] = bytes;     // loading the same image again makes no new texture
+}
+
+void OgreCollada::MemoryAccount::addMaterialTexture(const Ogre::String& material, const Ogre::String& texture) {
+  m_materialTextures[material].insert(texture);
+}
+
+void OgreCollada::MemoryAccount::stage(size_t bytes) {
+  m_staging += bytes;
+  m_peakStaging = std::max(m_peakStaging, m_staging);
+}
+
+void OgreCollada::MemoryAccount::unstage(size_t bytes) {
+  m_staging -= std::min(bytes, m_staging);
+}
+
+OgreCollada::MemoryAccount::Usage OgreCollada::MemoryAccount::getTotal() const {
+  Usage total;
+  for (std::map<Ogre::String, Usage>::const_iterator it = m_geometries.begin(); it != m_geometries.end(); ++it) {
+    total.vertexBytes += it->second.vertexBytes;
+    total.indexBytes += it->second.indexBytes;
+  }
+  for (std::map<Ogre::String, size_t>::const_iterator it = m_textures.begin(); it != m_textures.end(); ++it) {
+    total.textureBytes += it->second;
+  }
+  return total;
+}
+
+OgreCollada::MemoryAccount::Usage OgreCollada::MemoryAccount::getGeometryUsage(const Ogre::String& geometry) const {
+  std::map<Ogre::String, Usage>::const_iterator it = m_geometries.find(geometry);
+  return (it == m_geometries.end()) ? Usage() : it->second;
+}
+
+OgreCollada::MemoryAccount::Usage OgreCollada::MemoryAccount::getMaterialUsage(const Ogre::String& material) const {
+  std::map<Ogre::String, Usage>::const_iterator it = m_materials.find(material);
+  Usage u = (it == m_materials.end()) ? Usage() : it->second;
+  std::map<Ogre::String, std::set<Ogre::String> >::const_iterator tit = m_materialTextures.find(material);
+  if (tit != m_materialTextures.end()) {
+    for (std::set<Ogre::String>::const_iterator t = tit->second.begin(); t != tit->second.end(); ++t) {
+      u.textureBytes += getTextureBytes(*t);
+    }
+  }
+  return u;
+}
+
+size_t OgreCollada::MemoryAccount::getTextureBytes(const Ogre::String& texture) const {
+  std::map<Ogre::String, size_t>::const_iterator it = m_textures.find(texture);
+  return (it == m_textures.end()) ? 0 : it->second;
+}
+
+std::vector<Ogre::String> OgreCollada::MemoryAccount::getMaterials() const {
+  std::set<Ogre::String> names;
+  for (std::map<Ogre::String, Usage>::const_iterator it = m_materials.begin(); it != m_materials.end(); ++it) {
+    names.insert(it->first);
+  }
+  for (std::map<Ogre::String, std::set<Ogre::String> >::const_iterator it = m_materialTextures.begin();
+       it != m_materialTextures.end(); ++it) {
+    names.insert(it->first);
+  }
+  return std::vector<Ogre::String>(names.begin(), names.end());
+}
+
+void OgreCollada::MemoryAccount::writeJson(std::ostream& os) const {
+  os << "{\n\"total\":{";
+  writeUsage(os, getTotal());
+  os << "},\n\"staging\":{\"currentBytes\":" << m_staging << ",\"peakBytes\":" << m_peakStaging << "},\n";
+
+  os << "\"geometries\":[";
+  std::vector<std::pair<size_t, Ogre::String> > geometries = largestFirst(m_geometries, &usageTotal);
+  for (size_t i = 0; i < geometries.size(); ++i) {
+    os << ((i == 0) ? "\n" : ",\n") << "{\"name\":";
+    writeJsonString(os, geometries[i].second);
+    os << ",";
+    writeUsage(os, m_geometries.find(geometries[i].second)->second);
+    os << "}";
+  }
+
+  os << "],\n\"materials\":[";
+  std::map<Ogre::String, Usage> materials;
+  std::vector<Ogre::String> names = getMaterials();
+  for (size_t i = 0; i < names.size(); ++i) {
+    materials[names[i]] = getMaterialUsage(names[i]);
+  }
+  std::vector<std::pair<size_t, Ogre::String> > sorted = largestFirst(materials, &usageTotal);
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    os << ((i == 0) ? "\n" : ",\n") << "{\"name\":";
+    writeJsonString(os, sorted[i].second);
+    os << ",";
+    writeUsage(os, materials[sorted[i].second]);
+    os << ",\"textures\":[";
+    std::map<Ogre::String, std::set<Ogre::String> >::const_iterator tit = m_materialTextures.find(sorted[i].second);
+    if (tit != m_materialTextures.end()) {
+      for (std::set<Ogre::String>::const_iterator t = tit->second.begin(); t != tit->second.end(); ++t) {
+	os << ((t == tit->second.begin()) ? "" : ",");
+	writeJsonString(os, *t);
+      }
+    }
+    os << "]}";
+  }
+
+  os << "],\n\"textures\":[";
+  std::vector<std::pair<size_t, Ogre::String> > textures = largestFirst(m_textures, &bytes);
+  for (size_t i = 0; i < textures.size(); ++i) {
+    os << ((i == 0) ? "\n" : ",\n") << "{\"name\":";
+    writeJsonString(os, textures[i].second);
+    os << ",\"bytes\":" << textures[i].first << "}";
+  }
+  os << "]\n}\n";
+}
+
+void OgreCollada::MemoryAccount::clear() {
+  m_geometries.clear();
+  m_materials.clear();
+  m_materialTextures.clear();
+  m_textures.clear();
+  m_staging = m_peakStaging = 0;
+}
@@ -0,0 +1,82 @@
+// OgreColladaMemoryAccount.h, a tally of the memory an import takes: vertex and index buffers by geometry
+// and material, textures, and the intermediate data held while converting
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef OGRE_COLLADA_MEMORYACCOUNT_H
+#define OGRE_COLLADA_MEMORYACCOUNT_H
+
+#include <map>
+#include <ostream>
+#include <set>
+#include <vector>
+
+#include <OgreString.h>
+
+namespace OgreCollada {
+
+// Filled in by a Writer with memory accounting enabled (see Writer::setMemoryAccounting).  Buffer sizes
+// are those of the hardware buffers made for the vertex format in use.  A geometry instantiated several
+// times into one mesh is charged for every copy; a mesh shared among instances is charged once.
+// Index buffers for generated levels of detail go to the mesh they belong to: the geometry's own mesh
+// with SceneWriter, and the merged output mesh (or tile) with MeshWriter
+class MemoryAccount {
+ public:
+  struct Usage {
+    Usage() : vertexBytes(0), indexBytes(0), textureBytes(0) {}
+
+    size_t vertexBytes;
+    size_t indexBytes;
+    size_t textureBytes;      // for materials, the textures they use; each is counted once in the total
+
+    size_t total() const { return vertexBytes + indexBytes + textureBytes; }
+  };
+
+  MemoryAccount();
+
+  // recording
+  void addGeometryBuffers(const Ogre::String& geometry, size_t vertexBytes, size_t indexBytes);
+  void removeGeometry(const Ogre::String& geometry);      // its buffers were released
+  void addMaterialBuffers(const Ogre::String& material, size_t vertexBytes, size_t indexBytes);
+  void addTexture(const Ogre::String& texture, size_t bytes);
+  void addMaterialTexture(const Ogre::String& material, const Ogre::String& texture);
+  // Intermediate ("staging") data: flattened geometry waiting to become buffers, and the like
+  void stage(size_t bytes);
+  void unstage(size_t bytes);
+
+  // queries
+  Usage getTotal() const;
+  Usage getGeometryUsage(const Ogre::String& geometry) const;
+  Usage getMaterialUsage(const Ogre::String& material) const;
+  size_t getTextureBytes(const Ogre::String& texture) const;
+  size_t getStagingBytes() const { return m_staging; }
+  size_t getPeakStagingBytes() const { return m_peakStaging; }
+  const std::map<Ogre::String, Usage>& getGeometries() const { return m_geometries; }
+  std::vector<Ogre::String> getMaterials() const;
+  const std::map<Ogre::String, size_t>& getTextures() const { return m_textures; }
+
+  // Everything above as a JSON object, with each list sorted largest first
+  void writeJson(std::ostream&) const;
+
+  void clear();
+
+ private:
+  std::map<Ogre::String, Usage> m_geometries;
+  std::map<Ogre::String, Usage> m_materials;                    // buffers only
+  std::map<Ogre::String, std::set<Ogre::String> > m_materialTextures;
+  std::map<Ogre::String, size_t> m_textures;
+  size_t m_staging, m_peakStaging;
+};
+
+} // end namespace OgreCollada
+
+#endif // OGRE_COLLADA_MEMORYACCOUNT_H
@@ -0,0 +1,99 @@
+// OgreColladaMeshCodecFormat.h, layout and shared primitives of the compressed mesh container
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef OGRE_COLLADA_MESHCODECFORMAT_H
+#define OGRE_COLLADA_MESHCODECFORMAT_H
+
+#include <cmath>
+
+#include <OgrePrerequisites.h>
+
+// Container layout (all multi-byte values little-endian, "varint" is LEB128):
+//   header:     "OCMZ", u8 version, f32 bounds min[3], max[3], f32 radius
+//               u8 hasShared, [vertex array if hasShared], varint submesh count
+//   submesh:    varint name length, name bytes, u8 operation type, u8 useShared,
+//               [vertex array if !useShared], index block
+//   vertex arr: varint vertex count, u8 hasNormals, u8 hasUVs, then positions, normals (octahedral),
+//               and UVs, each as an attribute block
+//   attribute:  u8 bits, f32 min[comps], f32 extent[comps], then one byte plane stream per byte of
+//               zigzagged deltas between successive quantized vertices
+//   index blk:  varint index count, one stream of varint zigzagged deltas between successive indices
+//   stream:     u8 mode, varint raw size, then either the raw bytes (mode 0) or (mode 1) varint symbol
+//               count, (u8 symbol, u16 frequency - 1) pairs, varint coded size, the initial rANS
+//               states (u32 each), and the coded bytes, padded if necessary to at least
+//               minCodedSize(raw size)
+// A vertex array holds at most MAX_VERTICES vertices and an index block at most MAX_INDICES indices.
+// Together with the padding, these let a decoder check every count against the size of its input
+// before allocating anything for it
+
+namespace OgreCollada {
+namespace codec {
+
+const unsigned char MAGIC[4] = { 'O', 'C', 'M', 'Z' };
+const unsigned char VERSION = 2;
+
+const size_t MAX_VERTICES = size_t(1) << 25;
+const size_t MAX_INDICES = size_t(1) << 27;
+const size_t MAX_EXPANSION = 1024;    // decoded bytes per coded byte of a stream
+
+inline size_t minCodedSize(size_t rawSize) {
+  return rawSize / MAX_EXPANSION + ((rawSize % MAX_EXPANSION) ? 1 : 0);
+}
+
+enum StreamMode { STREAM_RAW = 0, STREAM_RANS = 1 };
+
+// rANS parameters: 12-bit probabilities, 32-bit state normalized to [2^23, 2^31), byte-wise I/O
+const unsigned PROB_BITS = 12;
+const Ogre::uint32 PROB_SCALE = 1u << PROB_BITS;
+const Ogre::uint32 RANS_L = 1u << 23;
+const unsigned RANS_STATES = 4;   // interleaved, symbol i belonging to state i % RANS_STATES
+
+inline Ogre::uint32 zigzag(Ogre::int32 v) { return (Ogre::uint32(v) << 1) ^ Ogre::uint32(v >> 31); }
+inline Ogre::int32 unzigzag(Ogre::uint32 v) { return Ogre::int32(v >> 1) ^ -Ogre::int32(v & 1); }
+
+// bytes needed for zigzagged deltas of values with the given number of bits
+inline unsigned planeCount(unsigned bits) { return (bits + 1 + 7) / 8; }
+
+// octahedral mapping of unit vectors onto the square [-1, 1]^2
+inline void octEncode(float x, float y, float z, float& u, float& v) {
+  float l1 = std::abs(x) + std::abs(y) + std::abs(z);
+  if (l1 == 0) {
+    u = v = 0;   // not a direction at all; any answer will do
+    return;
+  }
+  u = x / l1;
+  v = y / l1;
+  if (z < 0) {
+    float pu = u, pv = v;
+    u = (1 - std::abs(pv)) * ((pu >= 0) ? 1 : -1);
+    v = (1 - std::abs(pu)) * ((pv >= 0) ? 1 : -1);
+  }
+}
+
+inline void octDecode(float u, float v, float* n) {
+  float z = 1 - std::abs(u) - std::abs(v);
+  float x = u, y = v;
+  if (z < 0) {
+    x = (1 - std::abs(v)) * ((u >= 0) ? 1 : -1);
+    y = (1 - std::abs(u)) * ((v >= 0) ? 1 : -1);
+  }
+  float len = std::sqrt(x*x + y*y + z*z);
+  n[0] = x / len;
+  n[1] = y / len;
+  n[2] = z / len;
+}
+
+} // end namespace codec
+} // end namespace OgreCollada
+
+#endif // OGRE_COLLADA_MESHCODECFORMAT_H
@@ -0,0 +1,658 @@
+// Implementation of direct mesh construction from flattened Collada geometry
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+
+#include <OgreMeshManager.h>
+#include <OgreSubMesh.h>
+#include <OgreHardwareBufferManager.h>
+#include <OgreVertexIndexData.h>
+#include <OgreLogManager.h>
+
+#include "OgreColladaMeshData.h"
+#include "OgreColladaLog.h"
+
+// normalized (fixed point) vertex element types appeared in Ogre 1.11
+#if OGRE_VERSION >= ((1 << 16) | (11 << 8))
+#define OGRECOLLADA_HAVE_NORM_ELEMENTS
+#endif
+
+namespace {
+
+// convert a value in [-1, 1] to a signed short as interpreted by the *_NORM vertex element types
+short toNormShort(Ogre::Real v) {
+  v = std::max(Ogre::Real(-1), std::min(Ogre::Real(1), v));
+  return static_cast<short>((v >= 0) ? (v * 32767 + 0.5f) : (v * 32767 - 0.5f));
+}
+
+// can these texture coordinates be stored as normalized shorts?
+// Tiled textures (coordinates outside [-1, 1]) are common, so this is checked per vertex array
+bool uvsFitNormShort(const OgreCollada::VertexArray& va) {
+  for (size_t v = 0, vcount = va.size(); v < vcount; ++v) {
+    const Ogre::Real* uv = va.vertex(v) + va.uvOffset();
+    if ((std::abs(uv[0]) > 1) || (std::abs(uv[1]) > 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// The size of each vertex in the buffer createVertexData makes from va.  Whether texture coordinates
+// can be packed is judged from the vertices from "first" on, so a growing array can be sized piecemeal
+size_t vertexSize(const OgreCollada::VertexArray& va, const OgreCollada::VertexFormat& fmt, size_t first) {
+#ifdef OGRECOLLADA_HAVE_NORM_ELEMENTS
+  bool quantize = fmt.quantizePositions;
+  bool packNormals = fmt.packNormals;
+  bool packUVs = va.hasUVs && fmt.packUVs;
+  for (size_t v = first, vcount = va.size(); packUVs && (v < vcount); ++v) {
+    const Ogre::Real* uv = va.vertex(v) + va.uvOffset();
+    packUVs = (std::abs(uv[0]) <= 1) && (std::abs(uv[1]) <= 1);
+  }
+#else
+  bool quantize = false, packNormals = false, packUVs = false;
+#endif
+  // float3 or short4 positions and normals, float2 or short2 texture coordinates
+  return (quantize ? 8 : 12) + (va.hasNormals ? (packNormals ? 8 : 12) : 0) + (va.hasUVs ? (packUVs ? 4 : 8) : 0);
+}
+
+// Two 64-bit multiply-rotate lanes fed the same input with different constants, mixed together at
+// the end.  Not cryptographic, but accidental collisions between real meshes are vanishingly unlikely
+class Hasher128 {
+public:
+  Hasher128() : m_h1(0x9E3779B97F4A7C15ull), m_h2(0xC2B2AE3D27D4EB4Full), m_length(0) {}
+
+  void add(Ogre::uint64 k) {
+    m_h1 = rotl(m_h1 ^ (rotl(k * 0x87C37B91114253D5ull, 31) * 0x4CF5AD432745937Full), 27) * 5 + 0x52DCE729;
+    m_h2 = rotl(m_h2 ^ (rotl(k * 0x4CF5AD432745937Full, 33) * 0x87C37B91114253D5ull), 31) * 5 + 0x38495AB5;
+    ++m_length;
+  }
+
+  void add(const void* data, size_t bytes) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (; bytes >= 8; p += 8, bytes -= 8) {
+      Ogre::uint64 k;
+      std::memcpy(&k, p, 8);
+      add(k);
+    }
+    if (bytes > 0) {
+      Ogre::uint64 k = 0;
+      std::memcpy(&k, p, bytes);
+      add(k ^ (Ogre::uint64(bytes) << 56));
+    }
+  }
+
+  OgreCollada::MeshFingerprint result() const {
+    Ogre::uint64 h1 = m_h1 ^ m_length, h2 = m_h2 ^ m_length;
+    h1 += h2;
+    h2 += h1;
+    h1 = fmix(h1);
+    h2 = fmix(h2);
+    h1 += h2;
+    h2 += h1;
+    OgreCollada::MeshFingerprint fp;
+    fp.hi = h1;
+    fp.lo = h2;
+    return fp;
+  }
+
+private:
+  static Ogre::uint64 rotl(Ogre::uint64 x, int r) { return (x << r) | (x >> (64 - r)); }
+  static Ogre::uint64 fmix(Ogre::uint64 k) {
+    k ^= k >> 33;
+    k *= 0xFF51AFD7ED558CCDull;
+    k ^= k >> 33;
+    k *= 0xC4CEB9FE1A85EC53ull;
+    k ^= k >> 33;
+    return k;
+  }
+
+  Ogre::uint64 m_h1, m_h2, m_length;
+};
+
+void hashVertexArray(Hasher128& h, const OgreCollada::VertexArray& va) {
+  h.add((va.hasNormals ? 1 : 0) | (va.hasUVs ? 2 : 0));
+  h.add(va.data.size());
+  if (!va.data.empty()) {
+    h.add(&va.data[0], va.data.size() * sizeof(Ogre::Real));
+  }
+}
+
+bool sameVertices(const OgreCollada::VertexArray& a, const OgreCollada::VertexArray& b) {
+  return (a.hasNormals == b.hasNormals) && (a.hasUVs == b.hasUVs) && (a.data.size() == b.data.size()) &&
+    (a.data.empty() || (std::memcmp(&a.data[0], &b.data[0], a.data.size() * sizeof(Ogre::Real)) == 0));
+}
+
+Ogre::VertexData* createVertexData(const OgreCollada::VertexArray& va,
+                                   const OgreCollada::VertexFormat& fmt,
+                                   const OgreCollada::Dequantization& dq) {
+  Ogre::VertexData* vdata = OGRE_NEW Ogre::VertexData();
+  vdata->vertexStart = 0;
+  vdata->vertexCount = va.size();
+
+  // decide on the layout
+  Ogre::VertexDeclaration* decl = vdata->vertexDeclaration;
+  size_t offset = 0;
+#ifdef OGRECOLLADA_HAVE_NORM_ELEMENTS
+  bool packNormals = va.hasNormals && fmt.packNormals;
+  bool packUVs = va.hasUVs && fmt.packUVs && uvsFitNormShort(va);
+  Ogre::VertexElementType ptype = fmt.quantizePositions ? Ogre::VET_SHORT4_NORM : Ogre::VET_FLOAT3;
+  Ogre::VertexElementType ntype = packNormals ? Ogre::VET_SHORT4_NORM : Ogre::VET_FLOAT3;
+  Ogre::VertexElementType uvtype = packUVs ? Ogre::VET_SHORT2_NORM : Ogre::VET_FLOAT2;
+#else
+  Ogre::VertexElementType ptype = Ogre::VET_FLOAT3;
+  Ogre::VertexElementType ntype = Ogre::VET_FLOAT3;
+  Ogre::VertexElementType uvtype = Ogre::VET_FLOAT2;
+#endif
+  size_t poffset = offset;
+  decl->addElement(0, poffset, ptype, Ogre::VES_POSITION);
+  offset += Ogre::VertexElement::getTypeSize(ptype);
+  size_t noffset = offset;
+  if (va.hasNormals) {
+    decl->addElement(0, noffset, ntype, Ogre::VES_NORMAL);
+    offset += Ogre::VertexElement::getTypeSize(ntype);
+  }
+  size_t uvoffset = offset;
+  if (va.hasUVs) {
+    decl->addElement(0, uvoffset, uvtype, Ogre::VES_TEXTURE_COORDINATES, 0);
+    offset += Ogre::VertexElement::getTypeSize(uvtype);
+  }
+  size_t vsize = offset;
+
+  Ogre::HardwareVertexBufferSharedPtr vbuf =
+    Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(vsize, vdata->vertexCount,
+                                                                   Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
+  vdata->vertexBufferBinding->setBinding(0, vbuf);
+
+  unsigned char* vptr = static_cast<unsigned char*>(vbuf->lock(Ogre::HardwareBuffer::HBL_DISCARD));
+  for (size_t v = 0, vcount = va.size(); v < vcount; ++v, vptr += vsize) {
+    const Ogre::Real* src = va.vertex(v);
+    if (ptype == Ogre::VET_FLOAT3) {
+      float pos[3] = { float(src[0]), float(src[1]), float(src[2]) };
+      std::memcpy(vptr + poffset, pos, sizeof(pos));
+    } else {
+      short pos[4] = { toNormShort((src[0] - dq.offset.x) / dq.scale.x),
+                       toNormShort((src[1] - dq.offset.y) / dq.scale.y),
+                       toNormShort((src[2] - dq.offset.z) / dq.scale.z),
+                       32767 };
+      std::memcpy(vptr + poffset, pos, sizeof(pos));
+    }
+    if (va.hasNormals) {
+      const Ogre::Real* nsrc = src + va.normalOffset();
+      // the node transform that undoes quantization also gets applied to normals (as its inverse transpose)
+      // so pre-scale them to compensate
+      Ogre::Vector3 norm(nsrc[0] * dq.scale.x, nsrc[1] * dq.scale.y, nsrc[2] * dq.scale.z);
+      norm.normalise();
+      if (ntype == Ogre::VET_FLOAT3) {
+        float n[3] = { float(norm.x), float(norm.y), float(norm.z) };
+        std::memcpy(vptr + noffset, n, sizeof(n));
+      } else {
+        short n[4] = { toNormShort(norm.x), toNormShort(norm.y), toNormShort(norm.z), 0 };
+        std::memcpy(vptr + noffset, n, sizeof(n));
+      }
+    }
+    if (va.hasUVs) {
+      const Ogre::Real* uvsrc = src + va.uvOffset();
+      if (uvtype == Ogre::VET_FLOAT2) {
+        float uv[2] = { float(uvsrc[0]), float(uvsrc[1]) };
+        std::memcpy(vptr + uvoffset, uv, sizeof(uv));
+      } else {
+        short uv[2] = { toNormShort(uvsrc[0]), toNormShort(uvsrc[1]) };
+        std::memcpy(vptr + uvoffset, uv, sizeof(uv));
+      }
+    }
+  }
+  vbuf->unlock();
+
+  return vdata;
+}
+
+}
+
+Ogre::AxisAlignedBox OgreCollada::computeBounds(const VertexArray& va) {
+  Ogre::AxisAlignedBox bounds;   // starts out null
+  for (size_t v = 0, vcount = va.size(); v < vcount; ++v) {
+    bounds.merge(Ogre::Vector3(va.vertex(v)[0], va.vertex(v)[1], va.vertex(v)[2]));
+  }
+  return bounds;
+}
+
+void OgreCollada::bufferSizes(const MeshData& md, const VertexFormat& fmt, size_t firstSubmesh, size_t firstSharedVertex,
+                              std::vector<BufferSize>& sizes) {
+  sizes.assign(md.submeshes.size() - std::min(firstSubmesh, md.submeshes.size()), BufferSize());
+  size_t sharedIndices = 0;
+  size_t lastShared = sizes.size();
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    const SubmeshData& smd = md.submeshes[firstSubmesh + i];
+    // same choice of index width as createMesh
+    const VertexArray& vertices = smd.useSharedVertices ? md.sharedVertices : smd.vertices;
+    sizes[i].indexBytes = smd.indices.size() * ((vertices.size() <= MAX_16BIT_VERTICES) ? 2 : 4);
+    if (smd.useSharedVertices) {
+      sharedIndices += smd.indices.size();
+      lastShared = i;
+    } else {
+      sizes[i].vertexBytes = smd.vertices.size() * vertexSize(smd.vertices, fmt, 0);
+    }
+  }
+
+  // divide the shared vertices among their users; the last gets the remainder, so the total is exact
+  if ((lastShared < sizes.size()) && (md.sharedVertices.size() > firstSharedVertex)) {
+    size_t sharedBytes = (md.sharedVertices.size() - firstSharedVertex) *
+      vertexSize(md.sharedVertices, fmt, firstSharedVertex);
+    size_t assigned = 0;
+    for (size_t i = 0; i < lastShared; ++i) {
+      const SubmeshData& smd = md.submeshes[firstSubmesh + i];
+      if (smd.useSharedVertices && (sharedIndices > 0)) {
+	sizes[i].vertexBytes = Ogre::uint64(sharedBytes) * smd.indices.size() / sharedIndices;
+	assigned += sizes[i].vertexBytes;
+      }
+    }
+    sizes[lastShared].vertexBytes = sharedBytes - assigned;
+  }
+}
+
+size_t OgreCollada::dataBytes(const MeshData& md, size_t firstSubmesh, size_t firstSharedVertex) {
+  size_t bytes = 0;
+  if (md.sharedVertices.data.size() > firstSharedVertex * md.sharedVertices.stride()) {
+    bytes += (md.sharedVertices.data.size() - firstSharedVertex * md.sharedVertices.stride()) * sizeof(Ogre::Real);
+  }
+  for (size_t i = firstSubmesh; i < md.submeshes.size(); ++i) {
+    bytes += md.submeshes[i].vertices.data.size() * sizeof(Ogre::Real) +
+      md.submeshes[i].indices.size() * sizeof(Ogre::uint32);
+  }
+  return bytes;
+}
+
+OgreCollada::MeshFingerprint OgreCollada::fingerprint(const MeshData& md) {
+  Hasher128 h;
+  hashVertexArray(h, md.sharedVertices);
+  h.add(md.submeshes.size());
+  for (size_t i = 0; i < md.submeshes.size(); ++i) {
+    const SubmeshData& smd = md.submeshes[i];
+    h.add(smd.materialId);
+    h.add(smd.opType);
+    h.add(smd.useSharedVertices ? 1 : 0);
+    if (!smd.useSharedVertices) {
+      hashVertexArray(h, smd.vertices);
+    }
+    h.add(smd.indices.size());
+    if (!smd.indices.empty()) {
+      h.add(&smd.indices[0], smd.indices.size() * sizeof(Ogre::uint32));
+    }
+  }
+  return h.result();
+}
+
+bool OgreCollada::sameContents(const MeshData& a, const MeshData& b) {
+  if (!sameVertices(a.sharedVertices, b.sharedVertices) || (a.submeshes.size() != b.submeshes.size())) {
+    return false;
+  }
+  for (size_t i = 0; i < a.submeshes.size(); ++i) {
+    const SubmeshData& sa = a.submeshes[i];
+    const SubmeshData& sb = b.submeshes[i];
+    if ((sa.materialId != sb.materialId) || (sa.materialName != sb.materialName) || (sa.opType != sb.opType) ||
+        (sa.useSharedVertices != sb.useSharedVertices) || (sa.indices != sb.indices) ||
+        (!sa.useSharedVertices && !sameVertices(sa.vertices, sb.vertices))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void OgreCollada::extractVertices(const VertexArray& source, SubmeshData& smd) {
+  size_t stride = source.stride();
+
+  VertexArray own;
+  own.hasNormals = source.hasNormals;
+  own.hasUVs = source.hasUVs;
+
+  const Ogre::uint32 UNMAPPED = ~Ogre::uint32(0);
+  std::vector<Ogre::uint32> remap(source.size(), UNMAPPED);
+  for (size_t i = 0; i < smd.indices.size(); ++i) {
+    Ogre::uint32& idx = smd.indices[i];
+    if (remap[idx] == UNMAPPED) {
+      remap[idx] = own.size();
+      own.data.insert(own.data.end(), source.vertex(idx), source.vertex(idx) + stride);
+    }
+    idx = remap[idx];
+  }
+
+  std::swap(smd.vertices, own);
+  smd.useSharedVertices = false;
+}
+
+void OgreCollada::unshareVertices(MeshData& md) {
+  for (size_t i = 0; i < md.submeshes.size(); ++i) {
+    if (md.submeshes[i].useSharedVertices) {
+      extractVertices(md.sharedVertices, md.submeshes[i]);
+    }
+  }
+  md.sharedVertices = VertexArray();
+}
+
+size_t OgreCollada::removeUnusedSharedVertices(MeshData& md, size_t firstVertex) {
+  VertexArray& va = md.sharedVertices;
+  size_t stride = va.stride();
+  const Ogre::uint32 UNUSED = ~Ogre::uint32(0);
+  std::vector<Ogre::uint32> remap(va.size(), UNUSED);
+  for (size_t i = 0; i < md.submeshes.size(); ++i) {
+    const SubmeshData& smd = md.submeshes[i];
+    for (size_t j = 0; smd.useSharedVertices && (j < smd.indices.size()); ++j) {
+      remap[smd.indices[j]] = 0;
+    }
+  }
+
+  // slide the used vertices down over the unused ones, keeping their order
+  size_t kept = firstVertex;
+  for (size_t v = firstVertex; v < remap.size(); ++v) {
+    if (remap[v] != UNUSED) {
+      remap[v] = kept;
+      if (kept != v) {
+        std::copy(va.vertex(v), va.vertex(v) + stride, va.vertex(kept));
+      }
+      ++kept;
+    }
+  }
+  size_t removed = va.size() - kept;
+  if (removed == 0) {
+    return 0;
+  }
+  va.data.resize(kept * stride);
+
+  for (size_t i = 0; i < md.submeshes.size(); ++i) {
+    SubmeshData& smd = md.submeshes[i];
+    for (size_t j = 0; smd.useSharedVertices && (j < smd.indices.size()); ++j) {
+      if (smd.indices[j] >= firstVertex) {
+        smd.indices[j] = remap[smd.indices[j]];
+      }
+    }
+  }
+  return removed;
+}
+
+void OgreCollada::appendMeshData(MeshData& from, MeshData& to, size_t maxSharedVertices) {
+  if (!from.sharedVertices.data.empty()) {
+    if (to.sharedVertices.data.empty()) {
+      to.sharedVertices.hasNormals = from.sharedVertices.hasNormals;
+      to.sharedVertices.hasUVs = from.sharedVertices.hasUVs;
+    }
+    if ((to.sharedVertices.hasNormals != from.sharedVertices.hasNormals) ||
+        (to.sharedVertices.hasUVs != from.sharedVertices.hasUVs) ||
+        (to.sharedVertices.size() + from.sharedVertices.size() > maxSharedVertices)) {
+      unshareVertices(from);
+    } else {
+      Ogre::uint32 offset = to.sharedVertices.size();
+      for (size_t i = 0; i < from.submeshes.size(); ++i) {
+        SubmeshData& smd = from.submeshes[i];
+        for (size_t j = 0; smd.useSharedVertices && (j < smd.indices.size()); ++j) {
+          smd.indices[j] += offset;
+        }
+      }
+      to.sharedVertices.data.insert(to.sharedVertices.data.end(),
+                                    from.sharedVertices.data.begin(), from.sharedVertices.data.end());
+      from.sharedVertices = VertexArray();
+    }
+  }
+  to.submeshes.insert(to.submeshes.end(),
+                      std::make_move_iterator(from.submeshes.begin()), std::make_move_iterator(from.submeshes.end()));
+  from.submeshes.clear();
+}
+
+void OgreCollada::splitSubmesh(const SubmeshData& in, size_t maxVertices, std::vector<SubmeshData>& out) {
+  size_t primsize = (in.opType == Ogre::RenderOperation::OT_LINE_LIST) ? 2 : 3;
+  size_t stride = in.vertices.stride();
+
+  // map from input vertex to its index in the current output piece
+  std::vector<Ogre::uint32> remap(in.vertices.size());
+  std::vector<bool> mapped(in.vertices.size());
+  std::vector<Ogre::uint32> used;   // which input vertices got mapped in the current piece, for reset
+
+  SubmeshData* piece = 0;
+  for (size_t prim = 0, pcount = in.indices.size() / primsize; prim < pcount; ++prim) {
+    const Ogre::uint32* pidx = &in.indices[prim * primsize];
+
+    // start a new piece if this primitive's new vertices would overflow the current one
+    size_t newverts = 0;
+    for (size_t k = 0; k < primsize; ++k) {
+      if (!mapped[pidx[k]]) {
+        ++newverts;
+      }
+    }
+    if (!piece || (piece->vertices.size() + newverts > maxVertices)) {
+      for (size_t u = 0; u < used.size(); ++u) {
+        mapped[used[u]] = false;
+      }
+      used.clear();
+      out.push_back(SubmeshData());
+      piece = &out.back();
+      piece->materialId = in.materialId;
+      piece->materialName = in.materialName;
+      piece->opType = in.opType;
+      piece->vertices.hasNormals = in.vertices.hasNormals;
+      piece->vertices.hasUVs = in.vertices.hasUVs;
+    }
+
+    for (size_t k = 0; k < primsize; ++k) {
+      Ogre::uint32 v = pidx[k];
+      if (!mapped[v]) {
+        mapped[v] = true;
+        used.push_back(v);
+        remap[v] = piece->vertices.size();
+        piece->vertices.data.insert(piece->vertices.data.end(), in.vertices.vertex(v), in.vertices.vertex(v) + stride);
+      }
+      piece->indices.push_back(remap[v]);
+    }
+  }
+}
+
+void OgreCollada::tileMesh(const MeshData& md, size_t maxPrimitives, std::vector<MeshData>& tiles) {
+  // every primitive, in submesh order, with its center
+  struct Primitive {
+    Ogre::uint32 submesh;
+    Ogre::uint32 first;            // index of its first index
+    Ogre::Vector3 center;
+    unsigned octant;
+  };
+  std::vector<Primitive> prims;
+  size_t largestSource = md.sharedVertices.size();
+  for (size_t i = 0; i < md.submeshes.size(); ++i) {
+    const SubmeshData& smd = md.submeshes[i];
+    const VertexArray& va = smd.useSharedVertices ? md.sharedVertices : smd.vertices;
+    largestSource = std::max(largestSource, va.size());
+    size_t primsize = (smd.opType == Ogre::RenderOperation::OT_LINE_LIST) ? 2 : 3;
+    for (size_t first = 0; first + primsize <= smd.indices.size(); first += primsize) {
+      Ogre::Vector3 center(Ogre::Vector3::ZERO);
+      for (size_t k = 0; k < primsize; ++k) {
+	center += Ogre::Vector3(va.vertex(smd.indices[first + k]));
+      }
+      Primitive p = { Ogre::uint32(i), Ogre::uint32(first), center / Ogre::Real(primsize), 0 };
+      prims.push_back(p);
+    }
+  }
+  if (prims.empty()) {
+    return;
+  }
+
+  // Split ranges of primitives into octants until they are small enough.  The sort is stable, so each
+  // tile keeps its primitives in their original order, grouped by submesh.  A depth limit stops the
+  // splitting of primitives piled on the same spot
+  const unsigned MAX_DEPTH = 16;
+  struct Range {
+    size_t begin, end;
+    unsigned depth;
+  };
+  std::vector<std::pair<size_t, size_t> > leaves;
+  Range all = { 0, prims.size(), 0 };
+  std::vector<Range> work(1, all);
+  while (!work.empty()) {
+    Range r = work.back();
+    work.pop_back();
+    Ogre::Vector3 minimum = prims[r.begin].center, maximum = minimum;
+    for (size_t i = r.begin + 1; i < r.end; ++i) {
+      minimum.makeFloor(prims[i].center);
+      maximum.makeCeil(prims[i].center);
+    }
+    if ((r.end - r.begin <= maxPrimitives) || (r.depth == MAX_DEPTH) || (minimum == maximum)) {
+      leaves.push_back(std::make_pair(r.begin, r.end));
+      continue;
+    }
+    Ogre::Vector3 mid = (minimum + maximum) * 0.5f;
+    for (size_t i = r.begin; i < r.end; ++i) {
+      const Ogre::Vector3& c = prims[i].center;
+      prims[i].octant = ((c.x > mid.x) ? 1 : 0) | ((c.y > mid.y) ? 2 : 0) | ((c.z > mid.z) ? 4 : 0);
+    }
+    std::stable_sort(prims.begin() + r.begin, prims.begin() + r.end,
+		     [](const Primitive& a, const Primitive& b) { return a.octant < b.octant; });
+    // pushed in reverse, so tiles come out in octant order
+    size_t end = r.end;
+    while (end > r.begin) {
+      size_t begin = end;
+      while ((begin > r.begin) && (prims[begin - 1].octant == prims[end - 1].octant)) {
+	--begin;
+      }
+      Range child = { begin, end, r.depth + 1 };
+      work.push_back(child);
+      end = begin;
+    }
+  }
+
+  // gather each tile's vertices, renumbering them per output submesh
+  const Ogre::uint32 UNMAPPED = ~Ogre::uint32(0);
+  std::vector<Ogre::uint32> remap(largestSource, UNMAPPED);
+  std::vector<Ogre::uint32> used;
+  for (size_t l = 0; l < leaves.size(); ++l) {
+    tiles.push_back(MeshData());
+    MeshData& tile = tiles.back();
+    SubmeshData* out = 0;
+    const VertexArray* va = 0;
+    size_t stride = 0, primsize = 0;
+    for (size_t i = leaves[l].first; i < leaves[l].second; ++i) {
+      const SubmeshData& in = md.submeshes[prims[i].submesh];
+      if (!out || (prims[i].submesh != prims[i - 1].submesh)) {
+	for (size_t u = 0; u < used.size(); ++u) {
+	  remap[used[u]] = UNMAPPED;
+	}
+	used.clear();
+	tile.submeshes.push_back(SubmeshData());
+	out = &tile.submeshes.back();
+	out->materialId = in.materialId;
+	out->materialName = in.materialName;
+	out->opType = in.opType;
+	va = in.useSharedVertices ? &md.sharedVertices : &in.vertices;
+	out->vertices.hasNormals = va->hasNormals;
+	out->vertices.hasUVs = va->hasUVs;
+	stride = va->stride();
+	primsize = (in.opType == Ogre::RenderOperation::OT_LINE_LIST) ? 2 : 3;
+      }
+      for (size_t k = 0; k < primsize; ++k) {
+	Ogre::uint32 v = in.indices[prims[i].first + k];
+	if (remap[v] == UNMAPPED) {
+	  remap[v] = Ogre::uint32(out->vertices.size());
+	  used.push_back(v);
+	  out->vertices.data.insert(out->vertices.data.end(), va->vertex(v), va->vertex(v) + stride);
+	}
+	out->indices.push_back(remap[v]);
+      }
+    }
+  }
+}
+
+Ogre::MeshPtr OgreCollada::createMesh(const Ogre::String& name,
+                                      const MeshData& md,
+                                      const VertexFormat& requested,
+                                      Dequantization* dqout) {
+  VertexFormat fmt = requested;
+#ifndef OGRECOLLADA_HAVE_NORM_ELEMENTS
+  if (fmt.isCompact()) {
+    LOG_DEBUG("compact vertex formats require Ogre 1.11 or later; using full floats for mesh " + name);
+    fmt = VertexFormat();
+  }
+#endif
+
+  // overall bounds, for Ogre and (possibly) for quantization
+  Ogre::AxisAlignedBox bounds = computeBounds(md.sharedVertices);
+  for (size_t i = 0; i < md.submeshes.size(); ++i) {
+    bounds.merge(computeBounds(md.submeshes[i].vertices));
+  }
+
+  Dequantization dq;
+  if (fmt.quantizePositions && !bounds.isNull()) {
+    dq.offset = bounds.getCenter();
+    dq.scale = bounds.getHalfSize();
+    // flat geometry has zero extent in some direction; leave that axis alone
+    for (int axis = 0; axis < 3; ++axis) {
+      if (dq.scale[axis] <= 0) {
+        dq.scale[axis] = 1;
+      }
+    }
+  }
+  if (dqout) {
+    *dqout = dq;
+  }
+
+  Ogre::MeshPtr mesh = Ogre::MeshManager::getSingleton().createManual(name, "General");
+  if (!md.sharedVertices.data.empty()) {
+    mesh->sharedVertexData = createVertexData(md.sharedVertices, fmt, dq);
+  }
+  for (size_t i = 0; i < md.submeshes.size(); ++i) {
+    const SubmeshData& smd = md.submeshes[i];
+    Ogre::SubMesh* sm = mesh->createSubMesh();
+    sm->setMaterialName(smd.materialName);
+    sm->operationType = smd.opType;
+    sm->useSharedVertices = smd.useSharedVertices;
+    if (!smd.useSharedVertices) {
+      sm->vertexData = createVertexData(smd.vertices, fmt, dq);
+    }
+
+    // use 16-bit indices when we can; they take half the space
+    const VertexArray& vertices = smd.useSharedVertices ? md.sharedVertices : smd.vertices;
+    bool use16 = vertices.size() <= MAX_16BIT_VERTICES;
+    sm->indexData->indexStart = 0;
+    sm->indexData->indexCount = smd.indices.size();
+    sm->indexData->indexBuffer =
+      Ogre::HardwareBufferManager::getSingleton().createIndexBuffer(use16 ? Ogre::HardwareIndexBuffer::IT_16BIT :
+                                                                            Ogre::HardwareIndexBuffer::IT_32BIT,
+                                                                    smd.indices.size(),
+                                                                    Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
+    if (!smd.indices.empty()) {
+      if (use16) {
+        std::vector<Ogre::uint16> indices16(smd.indices.begin(), smd.indices.end());
+        sm->indexData->indexBuffer->writeData(0, indices16.size() * sizeof(Ogre::uint16), &indices16[0], true);
+      } else {
+        sm->indexData->indexBuffer->writeData(0, smd.indices.size() * sizeof(Ogre::uint32), &smd.indices[0], true);
+      }
+    }
+  }
+
+  // bounds are in the (possibly quantized) space of the stored positions
+  Ogre::AxisAlignedBox meshBounds = bounds;
+  if (fmt.quantizePositions && !bounds.isNull()) {
+    meshBounds.setExtents((bounds.getMinimum() - dq.offset) / dq.scale,
+                          (bounds.getMaximum() - dq.offset) / dq.scale);
+  }
+  Ogre::Real radius = 0;
+  if (!meshBounds.isNull()) {
+    const Ogre::Vector3& mn = meshBounds.getMinimum();
+    const Ogre::Vector3& mx = meshBounds.getMaximum();
+    radius = Ogre::Vector3(std::max(std::abs(mn.x), std::abs(mx.x)),
+                           std::max(std::abs(mn.y), std::abs(mx.y)),
+                           std::max(std::abs(mn.z), std::abs(mx.z))).length();
+  }
+  mesh->_setBounds(meshBounds);
+  mesh->_setBoundingSphereRadius(radius);
+  mesh->load();
+
+  return mesh;
+}
@@ -0,0 +1,158 @@
+// OgreColladaMeshData.h, intermediate storage for geometry flattened out of Collada meshes
+// and direct construction of Ogre meshes from it (an alternative to ManualObject)
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef OGRE_COLLADA_MESHDATA_H
+#define OGRE_COLLADA_MESHDATA_H
+
+#include <vector>
+
+#include <OgreString.h>
+#include <OgreVector3.h>
+#include <OgreAxisAlignedBox.h>
+#include <OgreRenderOperation.h>
+#include <OgreMesh.h>
+
+#include <COLLADAFWMaterialBinding.h>
+
+namespace OgreCollada {
+
+// Deduplicated vertices, stored interleaved: position, then normal (if present), then
+// a single set of texture coordinates (if present)
+struct VertexArray {
+  VertexArray() : hasNormals(false), hasUVs(false) {}
+
+  bool hasNormals;
+  bool hasUVs;
+  std::vector<Ogre::Real> data;
+
+  size_t stride() const { return 3 + (hasNormals ? 3 : 0) + (hasUVs ? 2 : 0); }
+  size_t size() const { return data.size() / stride(); }
+  size_t normalOffset() const { return 3; }
+  size_t uvOffset() const { return hasNormals ? 6 : 3; }
+  const Ogre::Real* vertex(size_t v) const { return &data[v * stride()]; }
+  Ogre::Real* vertex(size_t v) { return &data[v * stride()]; }
+};
+
+// The contents of a single Ogre submesh, made from one Collada mesh primitive
+struct SubmeshData {
+  SubmeshData() : materialId(0), materialName("BaseWhiteNoLighting"),
+                  opType(Ogre::RenderOperation::OT_TRIANGLE_LIST), useSharedVertices(false) {}
+
+  COLLADAFW::MaterialId materialId;     // the primitive's material "symbol", for binding at instantiation
+  Ogre::String materialName;            // resolved Ogre material (if we had bindings to look it up)
+  Ogre::RenderOperation::OperationType opType;
+  VertexArray vertices;                 // unused if useSharedVertices is set
+  bool useSharedVertices;               // indices refer to MeshData::sharedVertices
+  std::vector<Ogre::uint32> indices;
+};
+
+struct MeshData {
+  VertexArray sharedVertices;           // vertices pooled among submeshes
+  std::vector<SubmeshData> submeshes;
+};
+
+// How vertex attributes get stored in hardware buffers we create ourselves
+struct VertexFormat {
+  VertexFormat() : packNormals(false), packUVs(false), quantizePositions(false) {}
+
+  bool packNormals;        // VET_SHORT4_NORM instead of VET_FLOAT3
+  bool packUVs;            // VET_SHORT2_NORM instead of VET_FLOAT2, if all coordinates are within [-1, 1]
+  bool quantizePositions;  // VET_SHORT4_NORM relative to the mesh bounds instead of VET_FLOAT3
+
+  bool isCompact() const { return packNormals || packUVs || quantizePositions; }
+};
+
+// Quantized positions must be scaled and offset by this to restore their original values
+struct Dequantization {
+  Dequantization() : offset(Ogre::Vector3::ZERO), scale(Ogre::Vector3::UNIT_SCALE) {}
+
+  Ogre::Vector3 offset;
+  Ogre::Vector3 scale;
+};
+
+Ogre::AxisAlignedBox computeBounds(const VertexArray&);
+
+// The hardware buffer space createMesh gives a submesh: its vertices (for a submesh using shared vertices,
+// a share of those in proportion to its indices) and its indices
+struct BufferSize {
+  BufferSize() : vertexBytes(0), indexBytes(0) {}
+
+  size_t vertexBytes, indexBytes;
+};
+
+// Buffer space for each of md's submeshes from firstSubmesh on, counting only the shared vertices
+// from firstSharedVertex on, as laid out by createMesh with the given format
+void bufferSizes(const MeshData& md, const VertexFormat& fmt, size_t firstSubmesh, size_t firstSharedVertex,
+                 std::vector<BufferSize>& sizes);
+
+// The memory held by md's vertex and index arrays, counting submeshes from firstSubmesh on and
+// shared vertices from firstSharedVertex on
+size_t dataBytes(const MeshData& md, size_t firstSubmesh = 0, size_t firstSharedVertex = 0);
+
+// A 128-bit hash of everything that goes into an Ogre mesh: vertex attributes, indices, primitive
+// types, and material IDs.  Meshes with equal fingerprints can be treated as identical
+struct MeshFingerprint {
+  MeshFingerprint() : hi(0), lo(0) {}
+
+  Ogre::uint64 hi, lo;
+
+  bool operator==(const MeshFingerprint& other) const { return (hi == other.hi) && (lo == other.lo); }
+  bool operator<(const MeshFingerprint& other) const { return (hi < other.hi) || ((hi == other.hi) && (lo < other.lo)); }
+};
+
+MeshFingerprint fingerprint(const MeshData&);
+
+// Whether two meshes have exactly the same contents: the fields fingerprint() hashes, compared bit
+// for bit, plus default material names.  Confirms a match of fingerprints
+bool sameContents(const MeshData&, const MeshData&);
+
+// the most vertices a submesh can have and still use 16-bit indices
+const size_t MAX_16BIT_VERTICES = 65536;
+
+// Copy the vertices a submesh references out of "source" into its own vertex array, renumbering them
+// in order of first use
+void extractVertices(const VertexArray& source, SubmeshData&);
+
+// Give every submesh using shared vertices its own copy of the ones it needs
+void unshareVertices(MeshData&);
+
+// Drop the shared vertices at or after firstVertex that no submesh references, keeping the rest in order.
+// Returns the number removed
+size_t removeUnusedSharedVertices(MeshData&, size_t firstVertex);
+
+// Move the submeshes of "from" to the end of "to".  The shared vertices of "from" join those of "to" if their
+// attributes agree and the total stays within maxSharedVertices; otherwise its submeshes get their own copies
+void appendMeshData(MeshData& from, MeshData& to, size_t maxSharedVertices);
+
+// Break a submesh into pieces of no more than maxVertices vertices each, appending them to "out".
+// Triangles (or lines) are kept whole and in their original order
+void splitSubmesh(const SubmeshData& in, size_t maxVertices, std::vector<SubmeshData>& out);
+
+// Divide a mesh among spatial tiles of no more than maxPrimitives triangles (or lines) each, by recursively
+// splitting the region holding the primitives' centers into octants.  Each tile has a submesh for every input
+// submesh it got primitives from, with only the vertices those use, so its bounds are tight
+void tileMesh(const MeshData& md, size_t maxPrimitives, std::vector<MeshData>& tiles);
+
+// Create an Ogre mesh with one submesh per SubmeshData, laid out as specified by the format.
+// Submeshes marked useSharedVertices reference a single vertex buffer made from md.sharedVertices.
+// Index buffers are 16 bits wide whenever the referenced vertex count allows it.
+// If positions are quantized the mapping back to the original space is supplied through dq
+Ogre::MeshPtr createMesh(const Ogre::String& name,
+                         const MeshData& md,
+                         const VertexFormat& fmt = VertexFormat(),
+                         Dequantization* dq = 0);
+
+} // end namespace OgreCollada
+
+#endif // OGRE_COLLADA_MESHDATA_H
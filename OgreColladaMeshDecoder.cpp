@@ -0,0 +1,443 @@
+// Implementation of the compressed mesh decoder
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include <OgreMeshManager.h>
+#include <OgreSubMesh.h>
+#include <OgreHardwareBufferManager.h>
+#include <OgreVertexIndexData.h>
+#include <OgreLogManager.h>
+#include <OgreStringConverter.h>
+
+#include "OgreColladaMeshDecoder.h"
+#include "OgreColladaMeshCodecFormat.h"
+#include "OgreColladaLog.h"
+
+using namespace OgreCollada::codec;
+
+namespace {
+
+// bounds-checked reading.  Once anything runs off the end, all further reads fail
+class ByteReader {
+public:
+  ByteReader(const unsigned char* data, size_t size) : m_ptr(data), m_end(data + size), m_ok(true) {}
+
+  bool ok() const { return m_ok; }
+  size_t remaining() const { return m_end - m_ptr; }
+
+  unsigned char u8() { return have(1) ? *m_ptr++ : 0; }
+  Ogre::uint16 u16() {
+    Ogre::uint16 lo = u8();
+    return lo | (Ogre::uint16(u8()) << 8);
+  }
+  Ogre::uint32 u32() {
+    Ogre::uint32 v = 0;
+    for (int i = 0; i < 4; ++i) {
+      v |= Ogre::uint32(u8()) << (8 * i);
+    }
+    return v;
+  }
+  float f32() {
+    Ogre::uint32 bits = u32();
+    float v;
+    std::memcpy(&v, &bits, sizeof(v));
+    return v;
+  }
+  size_t varint() {
+    size_t v = 0;
+    for (unsigned shift = 0; m_ok && (shift < 8 * sizeof(size_t)); shift += 7) {
+      unsigned char b = u8();
+      v |= size_t(b & 0x7f) << shift;
+      if (!(b & 0x80)) {
+        return v;
+      }
+    }
+    m_ok = false;
+    return 0;
+  }
+  const unsigned char* bytes(size_t size) {
+    if (!have(size)) {
+      return 0;
+    }
+    const unsigned char* p = m_ptr;
+    m_ptr += size;
+    return p;
+  }
+
+private:
+  bool have(size_t size) {
+    m_ok = m_ok && (size_t(m_end - m_ptr) >= size);
+    return m_ok;
+  }
+
+  const unsigned char* m_ptr;
+  const unsigned char* m_end;
+  bool m_ok;
+};
+
+// a * b, unless that overflows
+bool multiply(size_t a, size_t b, size_t& product) {
+  if ((a != 0) && (b > std::numeric_limits<size_t>::max() / a)) {
+    return false;
+  }
+  product = a * b;
+  return true;
+}
+
+struct DecodeSlot {
+  Ogre::uint16 freq;     // of the symbol owning this slot
+  Ogre::uint16 bias;     // offset of the slot from the start of the symbol's range
+  unsigned char symbol;
+};
+
+// Decode one symbol and renormalize.  A state never needs more than two bytes to get back above RANS_L
+inline unsigned char decodeSymbol(Ogre::uint32& x, const DecodeSlot* table, const unsigned char*& ptr) {
+  const DecodeSlot& slot = table[x & (PROB_SCALE - 1)];
+  x = slot.freq * (x >> PROB_BITS) + slot.bias;
+  if (x < RANS_L) {
+    x = (x << 8) | *ptr++;
+    if (x < RANS_L) {
+      x = (x << 8) | *ptr++;
+    }
+  }
+  return slot.symbol;
+}
+
+inline unsigned char decodeSymbolChecked(Ogre::uint32& x, const DecodeSlot* table,
+                                         const unsigned char*& ptr, const unsigned char* end) {
+  const DecodeSlot& slot = table[x & (PROB_SCALE - 1)];
+  x = slot.freq * (x >> PROB_BITS) + slot.bias;
+  while ((x < RANS_L) && (ptr < end)) {
+    x = (x << 8) | *ptr++;
+  }
+  return slot.symbol;
+}
+
+// read a byte stream of no more than maxSize bytes, undoing the entropy coding if present.
+// Sizes are checked against maxSize and the coded data that must back them before anything is allocated
+bool getStream(ByteReader& r, std::vector<unsigned char>& out, size_t maxSize) {
+  unsigned char mode = r.u8();
+  size_t size = r.varint();
+  if (!r.ok() || (size > maxSize)) {
+    return false;
+  }
+
+  if (mode == STREAM_RAW) {
+    if (size > r.remaining()) {
+      return false;
+    }
+    out.resize(size);
+    const unsigned char* raw = r.bytes(size);
+    if (raw && size) {
+      std::memcpy(&out[0], raw, size);
+    }
+    return r.ok();
+  }
+  if (mode != STREAM_RANS) {
+    return false;
+  }
+
+  // everything needed to decode the symbol in each probability slot
+  std::vector<DecodeSlot> slots(PROB_SCALE);
+  size_t symbols = r.varint();
+  if (symbols > 256) {
+    return false;
+  }
+  Ogre::uint32 total = 0;
+  for (size_t i = 0; i < symbols; ++i) {
+    unsigned char s = r.u8();
+    Ogre::uint32 freq = Ogre::uint32(r.u16()) + 1;
+    if (total + freq > PROB_SCALE) {
+      return false;
+    }
+    for (Ogre::uint32 slot = total; slot < total + freq; ++slot) {
+      slots[slot].freq = freq;
+      slots[slot].bias = slot - total;
+      slots[slot].symbol = s;
+    }
+    total += freq;
+  }
+  size_t codedSize = r.varint();
+  const unsigned char* ptr = r.bytes(codedSize);
+  if (!r.ok() || (total != PROB_SCALE) || (codedSize < 4 * RANS_STATES) || (codedSize < minCodedSize(size))) {
+    return false;
+  }
+  const unsigned char* end = ptr + codedSize;
+  out.resize(size);
+
+  Ogre::uint32 x[RANS_STATES];
+  for (unsigned st = 0; st < RANS_STATES; ++st, ptr += 4) {
+    x[st] = ptr[0] | (Ogre::uint32(ptr[1]) << 8) | (Ogre::uint32(ptr[2]) << 16) | (Ogre::uint32(ptr[3]) << 24);
+  }
+  // The states take turns; spelling out each one lets the CPU overlap their (serial) work.
+  // Each state needs at most two bytes per symbol, so with that many left no bounds checks are needed
+  const DecodeSlot* table = &slots[0];
+  unsigned char* dest = &out[0];
+  size_t i = 0;
+  for (; (i + RANS_STATES <= size) && (end - ptr >= 2 * int(RANS_STATES)); i += RANS_STATES) {
+    dest[i]     = decodeSymbol(x[0], table, ptr);
+    dest[i + 1] = decodeSymbol(x[1], table, ptr);
+    dest[i + 2] = decodeSymbol(x[2], table, ptr);
+    dest[i + 3] = decodeSymbol(x[3], table, ptr);
+  }
+  for (; i < size; ++i) {
+    dest[i] = decodeSymbolChecked(x[i % RANS_STATES], table, ptr, end);
+  }
+  return true;
+}
+
+// reconstruct one quantized attribute, writing floats into the vertex buffer at the given offset
+bool getAttribute(ByteReader& r, size_t vcount, size_t comps, bool octahedral,
+                  unsigned char* dest, size_t offset, size_t vsize,
+                  std::vector<std::vector<unsigned char> >& planeData) {
+  unsigned bits = r.u8();
+  float mn[3], step[3];
+  for (size_t c = 0; c < comps; ++c) {
+    mn[c] = r.f32();
+  }
+  if ((bits == 0) || (bits > 24)) {
+    return false;
+  }
+  float qmax = float((1u << bits) - 1);
+  for (size_t c = 0; c < comps; ++c) {
+    step[c] = r.f32() / qmax;
+  }
+  unsigned planes = planeCount(bits);
+  size_t planeSize;
+  if (!multiply(vcount, comps, planeSize)) {
+    return false;
+  }
+  planeData.resize(planes);
+  for (unsigned p = 0; p < planes; ++p) {
+    if (!getStream(r, planeData[p], planeSize) || (planeData[p].size() != planeSize)) {
+      return false;
+    }
+  }
+
+  // summed with wraparound, so corrupt deltas can't overflow; they just land out of range
+  Ogre::uint32 prev[3] = { 0, 0, 0 };
+  for (size_t v = 0; v < vcount; ++v, dest += vsize) {
+    float values[3];
+    for (size_t c = 0; c < comps; ++c) {
+      Ogre::uint32 delta = 0;
+      for (unsigned p = 0; p < planes; ++p) {
+        delta |= Ogre::uint32(planeData[p][comps * v + c]) << (8 * p);
+      }
+      prev[c] += Ogre::uint32(unzigzag(delta));
+      if (prev[c] > Ogre::uint32(qmax)) {
+        return false;
+      }
+      values[c] = mn[c] + prev[c] * step[c];
+    }
+    if (octahedral) {
+      float n[3];
+      octDecode(values[0], values[1], n);
+      std::memcpy(dest + offset, n, sizeof(n));
+    } else {
+      std::memcpy(dest + offset, values, comps * sizeof(float));
+    }
+  }
+  return true;
+}
+
+Ogre::VertexData* getVertexArray(ByteReader& r, std::vector<std::vector<unsigned char> >& planeData) {
+  size_t vcount = r.varint();
+  bool hasNormals = r.u8() != 0;
+  bool hasUVs = r.u8() != 0;
+  // The position planes alone need three bytes per vertex, and the input must be able to hold them.
+  // The limit on vertices also keeps the vertex buffer size (at most 32 bytes a vertex) from overflowing
+  if (!r.ok() || (vcount > MAX_VERTICES) || (minCodedSize(3 * vcount) > r.remaining())) {
+    return 0;
+  }
+
+  Ogre::VertexData* vdata = OGRE_NEW Ogre::VertexData();
+  vdata->vertexStart = 0;
+  vdata->vertexCount = vcount;
+  Ogre::VertexDeclaration* decl = vdata->vertexDeclaration;
+  size_t offset = 0;
+  decl->addElement(0, offset, Ogre::VET_FLOAT3, Ogre::VES_POSITION);
+  offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
+  size_t noffset = offset;
+  if (hasNormals) {
+    decl->addElement(0, noffset, Ogre::VET_FLOAT3, Ogre::VES_NORMAL);
+    offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
+  }
+  size_t uvoffset = offset;
+  if (hasUVs) {
+    decl->addElement(0, uvoffset, Ogre::VET_FLOAT2, Ogre::VES_TEXTURE_COORDINATES, 0);
+    offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT2);
+  }
+  size_t vsize = offset;
+  if (vcount == 0) {
+    return vdata;
+  }
+
+  Ogre::HardwareVertexBufferSharedPtr vbuf =
+    Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(vsize, vcount,
+                                                                   Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
+  vdata->vertexBufferBinding->setBinding(0, vbuf);
+
+  // decode straight into the buffer
+  unsigned char* dest = static_cast<unsigned char*>(vbuf->lock(Ogre::HardwareBuffer::HBL_DISCARD));
+  bool ok = getAttribute(r, vcount, 3, false, dest, 0, vsize, planeData) &&
+            (!hasNormals || getAttribute(r, vcount, 2, true, dest, noffset, vsize, planeData)) &&
+            (!hasUVs || getAttribute(r, vcount, 2, false, dest, uvoffset, vsize, planeData));
+  vbuf->unlock();
+
+  if (!ok) {
+    OGRE_DELETE vdata;
+    return 0;
+  }
+  return vdata;
+}
+
+Ogre::IndexData* getIndices(ByteReader& r, size_t vcount, std::vector<unsigned char>& raw) {
+  // each index takes one to five varint bytes, so the stream needs at least one per index
+  size_t icount = r.varint(), maxSize;
+  if (!r.ok() || (icount > MAX_INDICES) || (minCodedSize(icount) > r.remaining()) ||
+      !multiply(icount, 5, maxSize) || !getStream(r, raw, maxSize) || (raw.size() < icount)) {
+    return 0;
+  }
+
+  Ogre::IndexData* idata = OGRE_NEW Ogre::IndexData();
+  idata->indexStart = 0;
+  idata->indexCount = icount;
+  if (icount == 0) {
+    return idata;
+  }
+
+  bool use16 = vcount <= 65536;
+  idata->indexBuffer =
+    Ogre::HardwareBufferManager::getSingleton().createIndexBuffer(use16 ? Ogre::HardwareIndexBuffer::IT_16BIT :
+                                                                          Ogre::HardwareIndexBuffer::IT_32BIT,
+                                                                  icount,
+                                                                  Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
+  void* dest = idata->indexBuffer->lock(Ogre::HardwareBuffer::HBL_DISCARD);
+  Ogre::uint16* dest16 = static_cast<Ogre::uint16*>(dest);
+  Ogre::uint32* dest32 = static_cast<Ogre::uint32*>(dest);
+
+  // undo varint and delta coding as we go
+  const unsigned char* ptr = raw.empty() ? 0 : &raw[0];
+  const unsigned char* end = ptr + raw.size();
+  Ogre::uint32 prev = 0;    // summed with wraparound, as for attributes
+  bool ok = true;
+  for (size_t i = 0; (i < icount) && ok; ++i) {
+    Ogre::uint32 v = 0;
+    unsigned shift = 0;
+    while ((ptr < end) && (*ptr & 0x80) && (shift < 28)) {
+      v |= Ogre::uint32(*ptr++ & 0x7f) << shift;
+      shift += 7;
+    }
+    ok = (ptr < end);
+    if (ok) {
+      v |= Ogre::uint32(*ptr++) << shift;
+      prev += Ogre::uint32(unzigzag(v));
+      ok = (prev < vcount);
+    }
+    if (use16) {
+      dest16[i] = Ogre::uint16(ok ? prev : 0);
+    } else {
+      dest32[i] = ok ? prev : 0;
+    }
+  }
+  idata->indexBuffer->unlock();
+
+  if (!ok) {
+    OGRE_DELETE idata;
+    return 0;
+  }
+  return idata;
+}
+
+}
+
+Ogre::MeshPtr OgreCollada::decodeMesh(const Ogre::String& name, const unsigned char* data, size_t size,
+                                      const Ogre::String& group) {
+  ByteReader r(data, size);
+  const unsigned char* magic = r.bytes(sizeof(MAGIC));
+  if (!magic || (std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0)) {
+    LOG_DEBUG("data for mesh " + name + " is not a compressed mesh");
+    return Ogre::MeshPtr();
+  }
+  unsigned char version = r.u8();
+  if (version != VERSION) {
+    LOG_DEBUG("compressed mesh " + name + " has unsupported version " + Ogre::StringConverter::toString(version));
+    return Ogre::MeshPtr();
+  }
+  Ogre::Vector3 mn, mx;
+  for (int axis = 0; axis < 3; ++axis) {
+    mn[axis] = r.f32();
+  }
+  for (int axis = 0; axis < 3; ++axis) {
+    mx[axis] = r.f32();
+  }
+  Ogre::Real radius = r.f32();
+
+  // scratch space reused by all the streams
+  std::vector<std::vector<unsigned char> > planeData;
+  std::vector<unsigned char> indexData;
+
+  Ogre::MeshPtr mesh = Ogre::MeshManager::getSingleton().createManual(name, group);
+  bool ok = true;
+  size_t sharedCount = 0;
+  if (r.u8()) {
+    mesh->sharedVertexData = getVertexArray(r, planeData);
+    ok = (mesh->sharedVertexData != 0);
+    sharedCount = ok ? mesh->sharedVertexData->vertexCount : 0;
+  }
+
+  size_t submeshes = ok ? r.varint() : 0;
+  ok = ok && r.ok();     // a header cut short reads as zeros
+  for (size_t i = 0; (i < submeshes) && ok; ++i) {
+    size_t nameLength = r.varint();
+    const unsigned char* matname = r.bytes(nameLength);
+    unsigned char opType = r.u8();
+    bool useShared = r.u8() != 0;
+    ok = r.ok() && (!useShared || mesh->sharedVertexData) &&
+         ((opType == Ogre::RenderOperation::OT_TRIANGLE_LIST) || (opType == Ogre::RenderOperation::OT_LINE_LIST));
+    if (!ok) {
+      break;
+    }
+
+    Ogre::SubMesh* sm = mesh->createSubMesh();
+    sm->setMaterialName(Ogre::String(reinterpret_cast<const char*>(matname), nameLength));
+    sm->operationType = Ogre::RenderOperation::OperationType(opType);
+    sm->useSharedVertices = useShared;
+    size_t vcount = sharedCount;
+    if (!useShared) {
+      sm->vertexData = getVertexArray(r, planeData);
+      ok = (sm->vertexData != 0);
+      vcount = ok ? sm->vertexData->vertexCount : 0;
+    }
+    Ogre::IndexData* idata = ok ? getIndices(r, vcount, indexData) : 0;
+    if (idata) {
+      OGRE_DELETE sm->indexData;
+      sm->indexData = idata;
+    }
+    ok = ok && (idata != 0);
+  }
+
+  if (!ok) {
+    LOG_DEBUG("compressed mesh " + name + " is corrupt or truncated");
+    Ogre::MeshManager::getSingleton().remove(mesh->getHandle());
+    return Ogre::MeshPtr();
+  }
+
+  mesh->_setBounds(Ogre::AxisAlignedBox(mn, mx));
+  mesh->_setBoundingSphereRadius(radius);
+  mesh->load();
+  return mesh;
+}
@@ -0,0 +1,30 @@
+// OgreColladaMeshDecoder.h, creating Ogre meshes from the compressed container format
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef OGRE_COLLADA_MESHDECODER_H
+#define OGRE_COLLADA_MESHDECODER_H
+
+#include <OgreMesh.h>
+#include <OgreString.h>
+
+namespace OgreCollada {
+
+// Decompress a mesh written by encodeMesh directly into hardware buffers of a new manual mesh.
+// Returns a null pointer (and logs the reason) if the data is not a valid compressed mesh.
+// This has no dependency on OpenCOLLADA, so applications can link it on its own
+Ogre::MeshPtr decodeMesh(const Ogre::String& name, const unsigned char* data, size_t size,
+                         const Ogre::String& group = "General");
+
+} // end namespace OgreCollada
+
+#endif // OGRE_COLLADA_MESHDECODER_H
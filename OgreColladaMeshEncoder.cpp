@@ -0,0 +1,295 @@
+// Implementation of the compressed mesh encoder
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cstring>
+
+#include "OgreColladaMeshEncoder.h"
+#include "OgreColladaMeshCodecFormat.h"
+
+using namespace OgreCollada::codec;
+
+namespace {
+
+class ByteWriter {
+public:
+  explicit ByteWriter(std::vector<unsigned char>& out) : m_out(out) {}
+
+  void u8(unsigned char v) { m_out.push_back(v); }
+  void u16(Ogre::uint16 v) { u8(v & 0xff); u8(v >> 8); }
+  void f32(float v) {
+    Ogre::uint32 bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    for (int i = 0; i < 4; ++i) {
+      u8((bits >> (8 * i)) & 0xff);
+    }
+  }
+  void varint(size_t v) {
+    while (v >= 0x80) {
+      u8((v & 0x7f) | 0x80);
+      v >>= 7;
+    }
+    u8(v);
+  }
+  void bytes(const unsigned char* data, size_t size) { m_out.insert(m_out.end(), data, data + size); }
+
+private:
+  std::vector<unsigned char>& m_out;
+};
+
+// scale symbol counts to frequencies summing to PROB_SCALE, keeping every present symbol
+void normalizeFrequencies(const size_t* counts, size_t total, Ogre::uint32* freqs) {
+  Ogre::uint32 sum = 0;
+  int largest = 0;
+  for (int s = 0; s < 256; ++s) {
+    freqs[s] = counts[s] ? std::max<Ogre::uint32>(1, Ogre::uint32((Ogre::uint64(counts[s]) * PROB_SCALE) / total)) : 0;
+    sum += freqs[s];
+    if (freqs[s] > freqs[largest]) {
+      largest = s;
+    }
+  }
+  // rounding leaves us a little off; the most frequent symbol absorbs the difference, or if that
+  // isn't enough, steal from anything that can spare it
+  if (sum < PROB_SCALE) {
+    freqs[largest] += PROB_SCALE - sum;
+  } else {
+    while (sum > PROB_SCALE) {
+      for (int s = 0; (s < 256) && (sum > PROB_SCALE); ++s) {
+        if (freqs[s] > 1) {
+          --freqs[s];
+          --sum;
+        }
+      }
+    }
+  }
+}
+
+// entropy code a byte stream with interleaved rANS states, falling back to storing it raw
+void putStream(ByteWriter& w, const std::vector<unsigned char>& raw) {
+  size_t counts[256] = { 0 };
+  for (size_t i = 0; i < raw.size(); ++i) {
+    ++counts[raw[i]];
+  }
+  Ogre::uint32 freqs[256], starts[256];
+  std::vector<unsigned char> coded;
+  if (!raw.empty()) {
+    normalizeFrequencies(counts, raw.size(), freqs);
+    for (int s = 0, start = 0; s < 256; start += freqs[s], ++s) {
+      starts[s] = start;
+    }
+
+    // encode backwards so the decoder can run forwards
+    coded.resize(raw.size() + raw.size() / 2 + 16);
+    unsigned char* ptr = &coded[0] + coded.size();
+    Ogre::uint32 state[RANS_STATES];
+    std::fill(state, state + RANS_STATES, RANS_L);
+    for (size_t i = raw.size(); i-- > 0; ) {
+      Ogre::uint32& x = state[i % RANS_STATES];
+      Ogre::uint32 freq = freqs[raw[i]];
+      Ogre::uint32 xmax = ((RANS_L >> PROB_BITS) << 8) * freq;
+      while (x >= xmax) {
+        *--ptr = x & 0xff;
+        x >>= 8;
+      }
+      x = ((x / freq) << PROB_BITS) + (x % freq) + starts[raw[i]];
+      if (ptr - &coded[0] < int(4 * RANS_STATES)) {
+        break;   // incompressible; we'll store it raw
+      }
+    }
+    if (ptr - &coded[0] >= int(4 * RANS_STATES)) {
+      for (int st = RANS_STATES - 1; st >= 0; --st) {
+        ptr -= 4;
+        for (int b = 0; b < 4; ++b) {
+          ptr[b] = (state[st] >> (8 * b)) & 0xff;
+        }
+      }
+      coded.erase(coded.begin(), coded.begin() + (ptr - &coded[0]));
+      // the decoder ignores bytes after the ones it needs, so very compressible data is padded
+      // to the size the format requires
+      coded.resize(std::max(coded.size(), minCodedSize(raw.size())), 0);
+    } else {
+      coded.clear();
+    }
+  }
+
+  size_t symbols = 0;
+  for (int s = 0; s < 256; ++s) {
+    symbols += (counts[s] != 0);
+  }
+  if (raw.empty() || coded.empty() || (coded.size() + 3 * symbols + 4 >= raw.size())) {
+    w.u8(STREAM_RAW);
+    w.varint(raw.size());
+    if (!raw.empty()) {
+      w.bytes(&raw[0], raw.size());
+    }
+    return;
+  }
+
+  w.u8(STREAM_RANS);
+  w.varint(raw.size());
+  w.varint(symbols);
+  for (int s = 0; s < 256; ++s) {
+    if (counts[s]) {
+      w.u8(s);
+      w.u16(Ogre::uint16(freqs[s] - 1));   // PROB_SCALE itself doesn't fit; no frequency is zero
+    }
+  }
+  w.varint(coded.size());
+  w.bytes(&coded[0], coded.size());
+}
+
+// quantize "comps" components per vertex, delta code against the previous vertex, and write byte planes
+void putAttribute(ByteWriter& w, const OgreCollada::VertexArray& va, size_t offset, size_t comps,
+                  unsigned bits, bool octahedral) {
+  size_t vcount = va.size();
+
+  // gather the values to quantize
+  std::vector<float> values(vcount * comps);
+  for (size_t v = 0; v < vcount; ++v) {
+    const Ogre::Real* src = va.vertex(v) + offset;
+    if (octahedral) {
+      octEncode(src[0], src[1], src[2], values[2*v], values[2*v + 1]);
+    } else {
+      std::copy(src, src + comps, &values[comps * v]);
+    }
+  }
+
+  float mn[3], extent[3];
+  for (size_t c = 0; c < comps; ++c) {
+    if (octahedral) {
+      mn[c] = -1;
+      extent[c] = 2;
+    } else {
+      float lo = vcount ? values[c] : 0, hi = lo;
+      for (size_t v = 0; v < vcount; ++v) {
+        lo = std::min(lo, values[comps * v + c]);
+        hi = std::max(hi, values[comps * v + c]);
+      }
+      mn[c] = lo;
+      extent[c] = hi - lo;
+    }
+  }
+
+  w.u8(bits);
+  for (size_t c = 0; c < comps; ++c) {
+    w.f32(mn[c]);
+  }
+  for (size_t c = 0; c < comps; ++c) {
+    w.f32(extent[c]);
+  }
+
+  Ogre::uint32 qmax = (1u << bits) - 1;
+  unsigned planes = planeCount(bits);
+  std::vector<std::vector<unsigned char> > planeData(planes, std::vector<unsigned char>(vcount * comps));
+  std::vector<Ogre::int32> prev(comps, 0);
+  for (size_t v = 0; v < vcount; ++v) {
+    for (size_t c = 0; c < comps; ++c) {
+      float t = (extent[c] > 0) ? (values[comps * v + c] - mn[c]) / extent[c] : 0;
+      Ogre::int32 q = Ogre::int32(std::min(1.0f, std::max(0.0f, t)) * qmax + 0.5f);
+      Ogre::uint32 delta = zigzag(q - prev[c]);
+      prev[c] = q;
+      for (unsigned p = 0; p < planes; ++p) {
+        planeData[p][comps * v + c] = (delta >> (8 * p)) & 0xff;
+      }
+    }
+  }
+  for (unsigned p = 0; p < planes; ++p) {
+    putStream(w, planeData[p]);
+  }
+}
+
+void putVertexArray(ByteWriter& w, const OgreCollada::VertexArray& va, const OgreCollada::CodecOptions& opts) {
+  w.varint(va.size());
+  w.u8(va.hasNormals);
+  w.u8(va.hasUVs);
+  putAttribute(w, va, 0, 3, opts.positionBits, false);
+  if (va.hasNormals) {
+    putAttribute(w, va, va.normalOffset(), 2, opts.normalBits, true);
+  }
+  if (va.hasUVs) {
+    putAttribute(w, va, va.uvOffset(), 2, opts.uvBits, false);
+  }
+}
+
+void putIndices(ByteWriter& w, const std::vector<Ogre::uint32>& indices) {
+  w.varint(indices.size());
+  std::vector<unsigned char> raw;
+  raw.reserve(indices.size() * 2);
+  ByteWriter rw(raw);
+  Ogre::uint32 prev = 0;    // differences wrap around, and the decoder sums them the same way
+  for (size_t i = 0; i < indices.size(); ++i) {
+    rw.varint(zigzag(Ogre::int32(indices[i] - prev)));
+    prev = indices[i];
+  }
+  putStream(w, raw);
+}
+
+}
+
+bool OgreCollada::encodeMesh(const MeshData& md, std::vector<unsigned char>& out, const CodecOptions& requested) {
+  out.clear();
+  if (md.sharedVertices.size() > MAX_VERTICES) {
+    return false;
+  }
+  for (size_t i = 0; i < md.submeshes.size(); ++i) {
+    if ((md.submeshes[i].vertices.size() > MAX_VERTICES) || (md.submeshes[i].indices.size() > MAX_INDICES)) {
+      return false;
+    }
+  }
+
+  CodecOptions opts = requested;
+  opts.positionBits = std::max(1u, std::min(24u, opts.positionBits));
+  opts.normalBits = std::max(1u, std::min(24u, opts.normalBits));
+  opts.uvBits = std::max(1u, std::min(24u, opts.uvBits));
+
+  Ogre::AxisAlignedBox bounds = computeBounds(md.sharedVertices);
+  for (size_t i = 0; i < md.submeshes.size(); ++i) {
+    bounds.merge(computeBounds(md.submeshes[i].vertices));
+  }
+  Ogre::Vector3 mn = bounds.isNull() ? Ogre::Vector3::ZERO : bounds.getMinimum();
+  Ogre::Vector3 mx = bounds.isNull() ? Ogre::Vector3::ZERO : bounds.getMaximum();
+  Ogre::Real radius = Ogre::Vector3(std::max(std::abs(mn.x), std::abs(mx.x)),
+                                    std::max(std::abs(mn.y), std::abs(mx.y)),
+                                    std::max(std::abs(mn.z), std::abs(mx.z))).length();
+
+  ByteWriter w(out);
+  w.bytes(MAGIC, sizeof(MAGIC));
+  w.u8(VERSION);
+  for (int axis = 0; axis < 3; ++axis) {
+    w.f32(mn[axis]);
+  }
+  for (int axis = 0; axis < 3; ++axis) {
+    w.f32(mx[axis]);
+  }
+  w.f32(radius);
+
+  bool hasShared = !md.sharedVertices.data.empty();
+  w.u8(hasShared);
+  if (hasShared) {
+    putVertexArray(w, md.sharedVertices, opts);
+  }
+
+  w.varint(md.submeshes.size());
+  for (size_t i = 0; i < md.submeshes.size(); ++i) {
+    const SubmeshData& smd = md.submeshes[i];
+    w.varint(smd.materialName.size());
+    w.bytes(reinterpret_cast<const unsigned char*>(smd.materialName.data()), smd.materialName.size());
+    w.u8(smd.opType);
+    w.u8(smd.useSharedVertices);
+    if (!smd.useSharedVertices) {
+      putVertexArray(w, smd.vertices, opts);
+    }
+    putIndices(w, smd.indices);
+  }
+  return true;
+}
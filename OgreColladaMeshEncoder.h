@@ -0,0 +1,38 @@
+// OgreColladaMeshEncoder.h, writing flattened meshes in the compressed container format
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef OGRE_COLLADA_MESHENCODER_H
+#define OGRE_COLLADA_MESHENCODER_H
+
+#include <vector>
+
+#include "OgreColladaMeshData.h"
+
+namespace OgreCollada {
+
+// quantization precision, in bits per component (at most 24)
+struct CodecOptions {
+  CodecOptions() : positionBits(16), normalBits(12), uvBits(14) {}
+
+  unsigned positionBits;   // relative to the bounds of each vertex array
+  unsigned normalBits;     // of the octahedral encoding
+  unsigned uvBits;         // relative to the range of each vertex array
+};
+
+// Compress a mesh for reading with decodeMesh.  LOD levels are not included.  Returns false (with
+// "out" empty) if a vertex array or submesh is larger than the format allows; see MAX_VERTICES
+bool encodeMesh(const MeshData&, std::vector<unsigned char>& out, const CodecOptions& = CodecOptions());
+
+} // end namespace OgreCollada
+
+#endif // OGRE_COLLADA_MESHENCODER_H
@@ -0,0 +1,357 @@
+// Implementation of vertex cache and vertex fetch optimization for flattened submeshes
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+#include "OgreColladaMeshOptimizer.h"
+
+namespace {
+
+// scoring constants from Forsyth's paper
+const float CACHE_DECAY_POWER = 1.5f;
+const float LAST_TRI_SCORE = 0.75f;
+const float VALENCE_BOOST_SCALE = 2.0f;
+const float VALENCE_BOOST_POWER = 0.5f;
+
+// how desirable it is to emit a triangle using this vertex next
+float vertexScore(int cachePos, size_t remainingTris, size_t cacheSize) {
+  if (remainingTris == 0) {
+    return -1.0f;   // nothing left to draw with it
+  }
+
+  float score = 0.0f;
+  if (cachePos >= 0) {
+    if (cachePos < 3) {
+      // used by the triangle we just emitted.  Slightly penalized so we don't favor strips
+      score = LAST_TRI_SCORE;
+    } else {
+      float scaler = 1.0f / (cacheSize - 3);
+      score = std::pow(1.0f - (cachePos - 3) * scaler, CACHE_DECAY_POWER);
+    }
+  }
+  // favor vertices with few triangles remaining, so we don't leave isolated triangles behind
+  score += VALENCE_BOOST_SCALE * std::pow(float(remainingTris), -VALENCE_BOOST_POWER);
+  return score;
+}
+
+// location in the spatial hash used for welding
+struct WeldCell {
+  long long x, y, z;
+  bool operator==(const WeldCell& other) const { return (x == other.x) && (y == other.y) && (z == other.z); }
+};
+struct WeldCellHash {
+  size_t operator()(const WeldCell& c) const {
+    return size_t(c.x * 73856093LL) ^ size_t(c.y * 19349663LL) ^ size_t(c.z * 83492791LL);
+  }
+};
+
+bool withinTolerance(const Ogre::Real* a, const Ogre::Real* b, size_t count, Ogre::Real tol) {
+  for (size_t i = 0; i < count; ++i) {
+    if (std::abs(a[i] - b[i]) > tol) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// triangle indices rotated so the smallest comes first, preserving winding, plus where it came from
+struct CanonicalTriangle {
+  Ogre::uint32 v[3];
+  size_t tri;
+  bool operator<(const CanonicalTriangle& other) const {
+    if (v[0] != other.v[0]) return v[0] < other.v[0];
+    if (v[1] != other.v[1]) return v[1] < other.v[1];
+    if (v[2] != other.v[2]) return v[2] < other.v[2];
+    return tri < other.tri;
+  }
+  bool sameVertices(const CanonicalTriangle& other) const {
+    return (v[0] == other.v[0]) && (v[1] == other.v[1]) && (v[2] == other.v[2]);
+  }
+};
+
+}
+
+void OgreCollada::optimizeVertexCache(std::vector<Ogre::uint32>& indices, size_t vertexCount, size_t cacheSize) {
+  std::vector<Ogre::uint32> order;
+  vertexCacheOrder(indices, vertexCount, order, cacheSize);
+  reorderTriangles(indices, order);
+}
+
+void OgreCollada::vertexCacheOrder(const std::vector<Ogre::uint32>& indices, size_t vertexCount,
+                                   std::vector<Ogre::uint32>& order, size_t cacheSize) {
+  size_t triCount = indices.size() / 3;
+  order.clear();
+  order.reserve(triCount);
+  if ((triCount < 2) || (cacheSize < 4)) {
+    for (size_t t = 0; t < triCount; ++t) {
+      order.push_back(t);
+    }
+    return;
+  }
+
+  // build vertex->triangle adjacency, stored as one array with a range per vertex
+  std::vector<size_t> triStart(vertexCount + 1, 0);
+  for (size_t i = 0; i < triCount * 3; ++i) {
+    ++triStart[indices[i] + 1];
+  }
+  for (size_t v = 0; v < vertexCount; ++v) {
+    triStart[v + 1] += triStart[v];
+  }
+  std::vector<size_t> remaining(vertexCount, 0);   // triangles not yet emitted, per vertex
+  std::vector<size_t> vertTris(triCount * 3);
+  for (size_t i = 0; i < triCount * 3; ++i) {
+    Ogre::uint32 v = indices[i];
+    vertTris[triStart[v] + remaining[v]++] = i / 3;
+  }
+
+  std::vector<int> cachePos(vertexCount, -1);
+  std::vector<float> vScore(vertexCount);
+  for (size_t v = 0; v < vertexCount; ++v) {
+    vScore[v] = vertexScore(-1, remaining[v], cacheSize);
+  }
+  std::vector<float> triScore(triCount);
+  std::vector<bool> emitted(triCount, false);
+  for (size_t t = 0; t < triCount; ++t) {
+    triScore[t] = vScore[indices[3*t]] + vScore[indices[3*t+1]] + vScore[indices[3*t+2]];
+  }
+
+  std::vector<Ogre::uint32> cache, newCache;
+  cache.reserve(cacheSize + 3);
+  newCache.reserve(cacheSize + 3);
+
+  size_t best = std::max_element(triScore.begin(), triScore.end()) - triScore.begin();
+  size_t nextUnemitted = 0;   // fallback search position, for when the cache has nothing to offer
+  while (order.size() < triCount) {
+    if (best == triCount) {
+      // start over from a fresh area of the mesh
+      while (emitted[nextUnemitted]) {
+        ++nextUnemitted;
+      }
+      best = nextUnemitted;
+    }
+
+    // output the chosen triangle and remove it from its vertices' adjacency lists
+    emitted[best] = true;
+    order.push_back(best);
+    newCache.clear();
+    for (int k = 0; k < 3; ++k) {
+      Ogre::uint32 v = indices[3*best + k];
+      size_t* first = &vertTris[triStart[v]];
+      size_t* last = first + remaining[v];
+      *std::find(first, last, best) = *(last - 1);
+      --remaining[v];
+      if (std::find(newCache.begin(), newCache.end(), v) == newCache.end()) {
+        newCache.push_back(v);
+      }
+    }
+
+    // the triangle's vertices go to the front of the cache; everything else shifts back
+    for (size_t c = 0; c < cache.size(); ++c) {
+      if (std::find(newCache.begin(), newCache.end(), cache[c]) == newCache.end()) {
+        newCache.push_back(cache[c]);
+      }
+    }
+    for (size_t c = cacheSize; c < newCache.size(); ++c) {
+      cachePos[newCache[c]] = -1;   // evicted
+      vScore[newCache[c]] = vertexScore(-1, remaining[newCache[c]], cacheSize);
+    }
+    if (newCache.size() > cacheSize) {
+      newCache.resize(cacheSize);
+    }
+    cache.swap(newCache);
+
+    // rescore the cached vertices, then the triangles they touch, looking for the next best
+    for (size_t c = 0; c < cache.size(); ++c) {
+      cachePos[cache[c]] = c;
+      vScore[cache[c]] = vertexScore(c, remaining[cache[c]], cacheSize);
+    }
+    best = triCount;
+    float bestScore = -1.0f;
+    for (size_t c = 0; c < cache.size(); ++c) {
+      Ogre::uint32 v = cache[c];
+      for (size_t i = triStart[v], end = triStart[v] + remaining[v]; i < end; ++i) {
+        size_t t = vertTris[i];
+        triScore[t] = vScore[indices[3*t]] + vScore[indices[3*t+1]] + vScore[indices[3*t+2]];
+        if (triScore[t] > bestScore) {
+          bestScore = triScore[t];
+          best = t;
+        }
+      }
+    }
+  }
+}
+
+void OgreCollada::reorderTriangles(std::vector<Ogre::uint32>& indices, const std::vector<Ogre::uint32>& order) {
+  std::vector<Ogre::uint32> result;
+  result.reserve(order.size() * 3);
+  for (size_t t = 0; t < order.size(); ++t) {
+    result.insert(result.end(), indices.begin() + 3 * order[t], indices.begin() + 3 * order[t] + 3);
+  }
+  indices.swap(result);
+}
+
+size_t OgreCollada::weldVertices(VertexArray& va, size_t firstVertex,
+                                 const std::vector<std::vector<Ogre::uint32>*>& indexLists,
+                                 const WeldTolerance& tol) {
+  size_t vcount = va.size();
+  if (vcount <= firstVertex + 1) {
+    return 0;
+  }
+  size_t stride = va.stride();
+
+  // With cells as large as the position tolerance, any match is in the same or an adjacent cell.
+  // A zero tolerance still works, with arbitrary cells and exact comparison
+  Ogre::Real cellSize = (tol.position > 0) ? tol.position : 1;
+  typedef std::unordered_map<WeldCell, std::vector<Ogre::uint32>, WeldCellHash> WeldHash;
+  WeldHash cells;
+
+  std::vector<Ogre::Real> welded(va.data.begin(), va.data.begin() + firstVertex * stride);
+  std::vector<Ogre::uint32> remap(vcount);
+  for (size_t v = 0; v < firstVertex; ++v) {
+    remap[v] = v;
+  }
+  for (size_t v = firstVertex; v < vcount; ++v) {
+    const Ogre::Real* vval = va.vertex(v);
+    WeldCell home = { (long long)std::floor(vval[0] / cellSize),
+                      (long long)std::floor(vval[1] / cellSize),
+                      (long long)std::floor(vval[2] / cellSize) };
+
+    // look for an existing vertex close enough in every attribute
+    bool found = false;
+    for (int dx = -1; (dx <= 1) && !found; ++dx) {
+      for (int dy = -1; (dy <= 1) && !found; ++dy) {
+        for (int dz = -1; (dz <= 1) && !found; ++dz) {
+          WeldCell nbr = { home.x + dx, home.y + dy, home.z + dz };
+          WeldHash::const_iterator cit = cells.find(nbr);
+          if (cit == cells.end()) {
+            continue;
+          }
+          for (size_t c = 0; (c < cit->second.size()) && !found; ++c) {
+            const Ogre::Real* cval = &welded[cit->second[c] * stride];
+            if (withinTolerance(vval, cval, 3, tol.position) &&
+                (!va.hasNormals || withinTolerance(vval + va.normalOffset(), cval + va.normalOffset(), 3, tol.normal)) &&
+                (!va.hasUVs || withinTolerance(vval + va.uvOffset(), cval + va.uvOffset(), 2, tol.uv))) {
+              remap[v] = cit->second[c];
+              found = true;
+            }
+          }
+        }
+      }
+    }
+    if (!found) {
+      remap[v] = welded.size() / stride;
+      cells[home].push_back(remap[v]);
+      welded.insert(welded.end(), vval, vval + stride);
+    }
+  }
+
+  for (size_t l = 0; l < indexLists.size(); ++l) {
+    std::vector<Ogre::uint32>& indices = *indexLists[l];
+    for (size_t i = 0; i < indices.size(); ++i) {
+      indices[i] = remap[indices[i]];
+    }
+  }
+  va.data.swap(welded);
+  return vcount - va.size();
+}
+
+size_t OgreCollada::removeDegenerateTriangles(std::vector<Ogre::uint32>& indices, const VertexArray& va,
+                                              Ogre::Real areaTolerance) {
+  size_t kept = 0;
+  for (size_t t = 0, tcount = indices.size() / 3; t < tcount; ++t) {
+    Ogre::uint32 a = indices[3*t], b = indices[3*t+1], c = indices[3*t+2];
+    if ((a == b) || (b == c) || (c == a)) {
+      continue;
+    }
+    const Ogre::Real* pa = va.vertex(a);
+    const Ogre::Real* pb = va.vertex(b);
+    const Ogre::Real* pc = va.vertex(c);
+    Ogre::Vector3 u(pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2]);
+    Ogre::Vector3 w(pc[0] - pa[0], pc[1] - pa[1], pc[2] - pa[2]);
+    if (u.crossProduct(w).length() <= areaTolerance) {
+      continue;
+    }
+    indices[3*kept] = a;
+    indices[3*kept+1] = b;
+    indices[3*kept+2] = c;
+    ++kept;
+  }
+  size_t removed = indices.size() / 3 - kept;
+  indices.resize(3 * kept);
+  return removed;
+}
+
+size_t OgreCollada::removeDuplicateTriangles(std::vector<Ogre::uint32>& indices) {
+  size_t tcount = indices.size() / 3;
+  std::vector<CanonicalTriangle> tris(tcount);
+  for (size_t t = 0; t < tcount; ++t) {
+    const Ogre::uint32* idx = &indices[3*t];
+    int first = (idx[0] <= idx[1]) ? ((idx[0] <= idx[2]) ? 0 : 2) : ((idx[1] <= idx[2]) ? 1 : 2);
+    for (int k = 0; k < 3; ++k) {
+      tris[t].v[k] = idx[(first + k) % 3];
+    }
+    tris[t].tri = t;
+  }
+  std::sort(tris.begin(), tris.end());
+
+  // sorting puts duplicates together, first occurrence first
+  std::vector<bool> duplicate(tcount, false);
+  for (size_t i = 1; i < tcount; ++i) {
+    if (tris[i].sameVertices(tris[i-1])) {
+      duplicate[tris[i].tri] = true;
+    }
+  }
+
+  size_t kept = 0;
+  for (size_t t = 0; t < tcount; ++t) {
+    if (!duplicate[t]) {
+      std::copy(&indices[3*t], &indices[3*t] + 3, &indices[3*kept]);
+      ++kept;
+    }
+  }
+  indices.resize(3 * kept);
+  return tcount - kept;
+}
+
+void OgreCollada::optimizeVertexFetch(SubmeshData& smd) {
+  // pulling the vertices out in first-use order is exactly what we want
+  VertexArray in;
+  std::swap(in, smd.vertices);
+  extractVertices(in, smd);
+}
+
+size_t OgreCollada::countCacheMisses(const std::vector<Ogre::uint32>& indices, size_t vertexCount, size_t cacheSize) {
+  // a vertex is in a FIFO cache if fewer than cacheSize misses have happened since it was loaded
+  std::vector<size_t> loadedAt(vertexCount, 0);
+  std::vector<bool> loaded(vertexCount, false);
+  size_t misses = 0;
+  for (size_t i = 0; i < indices.size(); ++i) {
+    Ogre::uint32 v = indices[i];
+    if (!loaded[v] || (misses - loadedAt[v] >= cacheSize)) {
+      loaded[v] = true;
+      loadedAt[v] = misses;
+      ++misses;
+    }
+  }
+  return misses;
+}
+
+void OgreCollada::optimizeSubmesh(SubmeshData& smd) {
+  if ((smd.opType != Ogre::RenderOperation::OT_TRIANGLE_LIST) || smd.useSharedVertices) {
+    return;
+  }
+  optimizeVertexCache(smd.indices, smd.vertices.size());
+  optimizeVertexFetch(smd);
+}
@@ -0,0 +1,72 @@
+// OgreColladaMeshOptimizer.h, reordering of flattened submesh data for better GPU cache behavior
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef OGRE_COLLADA_MESHOPTIMIZER_H
+#define OGRE_COLLADA_MESHOPTIMIZER_H
+
+#include <vector>
+
+#include "OgreColladaMeshData.h"
+
+namespace OgreCollada {
+
+// Reorder the triangles of an indexed triangle list so that vertices are reused while still
+// in the post-transform cache, using Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+void optimizeVertexCache(std::vector<Ogre::uint32>& indices, size_t vertexCount, size_t cacheSize = 32);
+
+// The reordering optimizeVertexCache performs, as the original number of the triangle that goes in
+// each position, so it can be repeated on identical index lists without running the optimizer again
+void vertexCacheOrder(const std::vector<Ogre::uint32>& indices, size_t vertexCount,
+                      std::vector<Ogre::uint32>& order, size_t cacheSize = 32);
+
+// Rearrange the triangles of a triangle list into the given order
+void reorderTriangles(std::vector<Ogre::uint32>& indices, const std::vector<Ogre::uint32>& order);
+
+// Renumber vertices in the order the indices first reference them, so vertex fetches
+// move through memory sequentially.  Unreferenced vertices are dropped
+void optimizeVertexFetch(SubmeshData&);
+
+// Simulate a FIFO post-transform cache of the given size and report how many vertices
+// had to be transformed.  Divided by the triangle count this is the ACMR
+size_t countCacheMisses(const std::vector<Ogre::uint32>& indices, size_t vertexCount, size_t cacheSize = 16);
+
+// How close vertex attributes must be for vertices to be welded together.  Compared per component
+struct WeldTolerance {
+  WeldTolerance() : position(1e-5f), normal(1e-3f), uv(1e-5f) {}
+
+  Ogre::Real position;
+  Ogre::Real normal;
+  Ogre::Real uv;
+};
+
+// Merge vertices at or after firstVertex whose attributes all agree within the tolerance, and
+// update the supplied index lists to match.  Returns the number of vertices removed
+size_t weldVertices(VertexArray&, size_t firstVertex,
+                    const std::vector<std::vector<Ogre::uint32>*>& indexLists,
+                    const WeldTolerance&);
+
+// Remove triangles that reuse a vertex or whose area (as the length of the edge cross product)
+// is within the given tolerance of zero.  Returns the number removed
+size_t removeDegenerateTriangles(std::vector<Ogre::uint32>& indices, const VertexArray&, Ogre::Real areaTolerance);
+
+// Remove all but the first of any triangles made of the same vertices in the same winding order.
+// Returns the number removed
+size_t removeDuplicateTriangles(std::vector<Ogre::uint32>& indices);
+
+// Both of the above reorderings, for triangle list submeshes with their own vertices.
+// Anything else is left alone
+void optimizeSubmesh(SubmeshData&);
+
+} // end namespace OgreCollada
+
+#endif // OGRE_COLLADA_MESHOPTIMIZER_H
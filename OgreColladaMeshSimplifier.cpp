@@ -0,0 +1,354 @@
+// Implementation of quadric error metric mesh simplification and Ogre LOD registration
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <queue>
+#include <unordered_map>
+
+#include <OgreSubMesh.h>
+#include <OgreHardwareBufferManager.h>
+#include <OgreVertexIndexData.h>
+#include <OgreLodStrategyManager.h>
+#include <OgrePixelCountLodStrategy.h>
+
+#include "OgreColladaMeshSimplifier.h"
+
+namespace {
+
+// plane-distance error quadric (Garland & Heckbert), stored as the upper triangle of a 4x4 matrix
+struct Quadric {
+  Quadric() { std::fill(a, a + 10, 0.0); }
+
+  void addPlane(const Ogre::Vector3& n, double d, double weight) {
+    double p[4] = { n.x, n.y, n.z, d };
+    for (int i = 0, k = 0; i < 4; ++i) {
+      for (int j = i; j < 4; ++j, ++k) {
+        a[k] += weight * p[i] * p[j];
+      }
+    }
+  }
+
+  Quadric& operator+=(const Quadric& other) {
+    for (int k = 0; k < 10; ++k) {
+      a[k] += other.a[k];
+    }
+    return *this;
+  }
+
+  double error(const Ogre::Vector3& v) const {
+    double p[4] = { v.x, v.y, v.z, 1.0 };
+    double err = 0;
+    for (int i = 0, k = 0; i < 4; ++i) {
+      for (int j = i; j < 4; ++j, ++k) {
+        err += ((i == j) ? 1 : 2) * a[k] * p[i] * p[j];
+      }
+    }
+    return std::max(err, 0.0);
+  }
+
+  double a[10];
+};
+
+// a proposal to collapse vertex "from" onto vertex "to", valid while neither has changed
+struct Collapse {
+  double cost;
+  Ogre::uint32 from, to;
+  unsigned fromStamp, toStamp;
+  bool operator<(const Collapse& other) const { return cost > other.cost; }   // cheapest first
+};
+
+Ogre::Vector3 position(const OgreCollada::VertexArray& va, Ogre::uint32 v) {
+  const Ogre::Real* p = va.vertex(v);
+  return Ogre::Vector3(p[0], p[1], p[2]);
+}
+
+Ogre::uint64 edgeKey(Ogre::uint32 a, Ogre::uint32 b) {
+  return (Ogre::uint64(std::min(a, b)) << 32) | std::max(a, b);
+}
+
+void simplifySubmeshes(const OgreCollada::MeshData& md, size_t levels, Ogre::Real reduction,
+                       size_t first, size_t last, OgreCollada::LodData& lods) {
+  for (size_t i = first; i < last; ++i) {
+    const OgreCollada::SubmeshData& smd = md.submeshes[i];
+    const OgreCollada::VertexArray& va = smd.useSharedVertices ? md.sharedVertices : smd.vertices;
+    size_t original = smd.indices.size() / 3;
+    for (size_t level = 1; level <= levels; ++level) {
+      std::vector<Ogre::uint32>& result = lods.indices[level - 1][i];
+      if (smd.opType != Ogre::RenderOperation::OT_TRIANGLE_LIST) {
+        result = smd.indices;    // nothing to do for lines
+        continue;
+      }
+      // each level starts from the previous one, which is both faster and keeps levels consistent
+      const std::vector<Ogre::uint32>& source = (level == 1) ? smd.indices : lods.indices[level - 2][i];
+      size_t target = std::max(size_t(1), size_t(original * std::pow(reduction, Ogre::Real(level))));
+      OgreCollada::simplifyIndices(va, source, target, result);
+      if (result.empty()) {
+        // a closed submesh can collapse away completely, two triangles at a time; an empty level
+        // would get no index buffer at all, so it repeats the level before instead
+        result = source;
+      }
+    }
+  }
+}
+
+// bytes per index in a submesh's reduced index buffers: 16 bits wherever its vertex count allows
+size_t lodIndexSize(const OgreCollada::MeshData& md, size_t submesh) {
+  const OgreCollada::SubmeshData& smd = md.submeshes[submesh];
+  size_t vcount = smd.useSharedVertices ? md.sharedVertices.size() : smd.vertices.size();
+  return (vcount <= OgreCollada::MAX_16BIT_VERTICES) ? sizeof(Ogre::uint16) : sizeof(Ogre::uint32);
+}
+
+}
+
+void OgreCollada::simplifyIndices(const VertexArray& va, const std::vector<Ogre::uint32>& indices,
+                                  size_t targetTriangles, std::vector<Ogre::uint32>& result) {
+  result = indices;
+  size_t tcount = indices.size() / 3;
+  if (tcount <= targetTriangles) {
+    return;
+  }
+  size_t vcount = va.size();
+
+  // vertices on edges used by one triangle (borders and attribute seams) or by more than two
+  // (non-manifold) must stay put, or holes and cracks would open up
+  std::unordered_map<Ogre::uint64, unsigned> edgeUse;
+  for (size_t t = 0; t < tcount; ++t) {
+    for (int k = 0; k < 3; ++k) {
+      ++edgeUse[edgeKey(result[3*t + k], result[3*t + (k+1)%3])];
+    }
+  }
+  std::vector<bool> locked(vcount, false);
+  for (size_t t = 0; t < tcount; ++t) {
+    for (int k = 0; k < 3; ++k) {
+      Ogre::uint32 a = result[3*t + k], b = result[3*t + (k+1)%3];
+      if (edgeUse[edgeKey(a, b)] != 2) {
+        locked[a] = locked[b] = true;
+      }
+    }
+  }
+
+  // per-vertex quadrics from the planes of the surrounding triangles, weighted by area
+  std::vector<Quadric> quadrics(vcount);
+  std::vector<std::vector<Ogre::uint32> > vertTris(vcount);
+  for (size_t t = 0; t < tcount; ++t) {
+    Ogre::Vector3 p0 = position(va, result[3*t]);
+    Ogre::Vector3 n = (position(va, result[3*t+1]) - p0).crossProduct(position(va, result[3*t+2]) - p0);
+    Ogre::Real area2 = n.normalise();
+    for (int k = 0; k < 3; ++k) {
+      vertTris[result[3*t + k]].push_back(t);
+      if (area2 > 0) {
+        quadrics[result[3*t + k]].addPlane(n, -n.dotProduct(p0), area2 / 2);
+      }
+    }
+  }
+
+  std::vector<unsigned> stamp(vcount, 0);
+  std::vector<bool> collapsed(vcount, false);
+  std::vector<bool> deadTri(tcount, false);
+  std::priority_queue<Collapse> queue;
+
+  // propose collapsing each (unlocked) vertex of a triangle onto the other two
+  struct Proposer {
+    static void propose(std::priority_queue<Collapse>& queue, const VertexArray& va,
+                        const std::vector<Quadric>& quadrics, const std::vector<bool>& locked,
+                        const std::vector<unsigned>& stamp, Ogre::uint32 from, Ogre::uint32 to) {
+      if (locked[from] || (from == to)) {
+        return;
+      }
+      Quadric q = quadrics[from];
+      q += quadrics[to];
+      Collapse c = { q.error(position(va, to)), from, to, stamp[from], stamp[to] };
+      queue.push(c);
+    }
+  };
+  for (size_t t = 0; t < tcount; ++t) {
+    for (int k = 0; k < 3; ++k) {
+      Ogre::uint32 a = result[3*t + k], b = result[3*t + (k+1)%3];
+      Proposer::propose(queue, va, quadrics, locked, stamp, a, b);
+      Proposer::propose(queue, va, quadrics, locked, stamp, b, a);
+    }
+  }
+
+  size_t live = tcount;
+  while ((live > targetTriangles) && !queue.empty()) {
+    Collapse c = queue.top();
+    queue.pop();
+    if (collapsed[c.from] || collapsed[c.to] ||
+        (stamp[c.from] != c.fromStamp) || (stamp[c.to] != c.toStamp)) {
+      continue;   // stale
+    }
+
+    // reject collapses that would flip a triangle over
+    bool flips = false;
+    Ogre::Vector3 pto = position(va, c.to);
+    for (size_t i = 0; (i < vertTris[c.from].size()) && !flips; ++i) {
+      Ogre::uint32 t = vertTris[c.from][i];
+      if (deadTri[t] ||
+          (result[3*t] == c.to) || (result[3*t+1] == c.to) || (result[3*t+2] == c.to)) {
+        continue;   // gone already, or will be removed by this collapse
+      }
+      Ogre::Vector3 before[3], after[3];
+      for (int k = 0; k < 3; ++k) {
+        before[k] = position(va, result[3*t + k]);
+        after[k] = (result[3*t + k] == c.from) ? pto : before[k];
+      }
+      Ogre::Vector3 nb = (before[1] - before[0]).crossProduct(before[2] - before[0]);
+      Ogre::Vector3 na = (after[1] - after[0]).crossProduct(after[2] - after[0]);
+      // also refuse large rotations, which let a sequence of collapses fold the surface over
+      flips = (na.dotProduct(nb) <= 0.25f * na.length() * nb.length());
+    }
+    if (flips) {
+      continue;
+    }
+
+    // move the triangles of "from" onto "to", removing the ones that collapse
+    for (size_t i = 0; i < vertTris[c.from].size(); ++i) {
+      Ogre::uint32 t = vertTris[c.from][i];
+      if (deadTri[t]) {
+        continue;
+      }
+      if ((result[3*t] == c.to) || (result[3*t+1] == c.to) || (result[3*t+2] == c.to)) {
+        deadTri[t] = true;
+        --live;
+        continue;
+      }
+      for (int k = 0; k < 3; ++k) {
+        if (result[3*t + k] == c.from) {
+          result[3*t + k] = c.to;
+        }
+      }
+      vertTris[c.to].push_back(t);
+    }
+    std::vector<Ogre::uint32>().swap(vertTris[c.from]);
+    collapsed[c.from] = true;
+    quadrics[c.to] += quadrics[c.from];
+    ++stamp[c.to];
+
+    // costs of all edges touching "to" have changed
+    for (size_t i = 0; i < vertTris[c.to].size(); ++i) {
+      Ogre::uint32 t = vertTris[c.to][i];
+      if (deadTri[t]) {
+        continue;
+      }
+      for (int k = 0; k < 3; ++k) {
+        Ogre::uint32 w = result[3*t + k];
+        Proposer::propose(queue, va, quadrics, locked, stamp, w, c.to);
+        Proposer::propose(queue, va, quadrics, locked, stamp, c.to, w);
+      }
+    }
+  }
+
+  // keep the survivors, in their original order
+  size_t kept = 0;
+  for (size_t t = 0; t < tcount; ++t) {
+    if (!deadTri[t]) {
+      std::copy(&result[3*t], &result[3*t] + 3, &result[3*kept]);
+      ++kept;
+    }
+  }
+  result.resize(3 * kept);
+}
+
+OgreCollada::LodData OgreCollada::generateLods(const MeshData& md, size_t levels, Ogre::Real reduction, unsigned threads) {
+  LodData lods;
+  lods.indices.resize(levels, std::vector<std::vector<Ogre::uint32> >(md.submeshes.size()));
+
+  size_t count = md.submeshes.size();
+  threads = std::max(1u, std::min(threads, unsigned(count)));
+  if (threads == 1) {
+    simplifySubmeshes(md, levels, reduction, 0, count, lods);
+  } else {
+    // each thread writes only its own submeshes' entries, so no locking is needed
+    std::vector<std::future<void> > tasks;
+    for (unsigned th = 0; th < threads; ++th) {
+      tasks.push_back(std::async(std::launch::async, simplifySubmeshes, std::cref(md), levels, reduction,
+                                 count * th / threads, count * (th + 1) / threads, std::ref(lods)));
+    }
+    for (size_t th = 0; th < tasks.size(); ++th) {
+      tasks[th].get();
+    }
+  }
+
+  for (size_t level = 0; level < levels; ++level) {
+    size_t triangles = 0;
+    for (size_t i = 0; i < count; ++i) {
+      if (md.submeshes[i].opType == Ogre::RenderOperation::OT_TRIANGLE_LIST) {
+        triangles += lods.indices[level][i].size() / 3;
+      }
+    }
+    lods.triangleCounts.push_back(triangles);
+  }
+  return lods;
+}
+
+void OgreCollada::applyLods(Ogre::MeshPtr mesh, const MeshData& md, const LodData& lods, Ogre::Real pixelsPerTriangle) {
+  size_t levels = lods.indices.size();
+  if ((levels == 0) || (mesh->getNumSubMeshes() != md.submeshes.size())) {
+    return;
+  }
+
+  // switch levels based on how many pixels the mesh covers on screen
+#if OGRE_VERSION < ((1 << 16) | (10 << 8))
+  Ogre::LodStrategy* strategy = Ogre::PixelCountLodStrategy::getSingletonPtr();
+#else
+  Ogre::LodStrategy* strategy = Ogre::AbsolutePixelCountLodStrategy::getSingletonPtr();
+#endif
+  mesh->setLodStrategy(strategy);
+#if OGRE_VERSION < ((1 << 16) | (10 << 8))
+  mesh->_setLodInfo(levels + 1, false);
+#else
+  mesh->_setLodInfo(levels + 1);
+#endif
+
+  for (size_t level = 1; level <= levels; ++level) {
+    Ogre::MeshLodUsage usage;
+    usage.userValue = lods.triangleCounts[level - 1] * pixelsPerTriangle;
+    usage.value = strategy->transformUserValue(usage.userValue);
+    usage.edgeData = 0;
+    mesh->_setLodUsage(level, usage);
+
+    for (size_t i = 0; i < md.submeshes.size(); ++i) {
+      const std::vector<Ogre::uint32>& indices = lods.indices[level - 1][i];
+      bool use16 = lodIndexSize(md, i) == sizeof(Ogre::uint16);
+
+      Ogre::IndexData* idata = OGRE_NEW Ogre::IndexData();
+      idata->indexStart = 0;
+      idata->indexCount = indices.size();
+      if (!indices.empty()) {
+        idata->indexBuffer =
+          Ogre::HardwareBufferManager::getSingleton().createIndexBuffer(use16 ? Ogre::HardwareIndexBuffer::IT_16BIT :
+                                                                                Ogre::HardwareIndexBuffer::IT_32BIT,
+                                                                        indices.size(),
+                                                                        Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
+        if (use16) {
+          std::vector<Ogre::uint16> indices16(indices.begin(), indices.end());
+          idata->indexBuffer->writeData(0, indices16.size() * sizeof(Ogre::uint16), &indices16[0], true);
+        } else {
+          idata->indexBuffer->writeData(0, indices.size() * sizeof(Ogre::uint32), &indices[0], true);
+        }
+      }
+      mesh->_setSubMeshLodFaceList(i, level, idata);
+    }
+  }
+}
+
+void OgreCollada::lodIndexBytes(const MeshData& md, const LodData& lods, std::vector<size_t>& bytes) {
+  bytes.assign(md.submeshes.size(), 0);
+  for (size_t level = 0; level < lods.indices.size(); ++level) {
+    for (size_t i = 0; (i < md.submeshes.size()) && (i < lods.indices[level].size()); ++i) {
+      bytes[i] += lods.indices[level][i].size() * lodIndexSize(md, i);
+    }
+  }
+}
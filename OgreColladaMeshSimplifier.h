@@ -0,0 +1,52 @@
+// OgreColladaMeshSimplifier.h, generation of reduced levels of detail for flattened meshes
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef OGRE_COLLADA_MESHSIMPLIFIER_H
+#define OGRE_COLLADA_MESHSIMPLIFIER_H
+
+#include <vector>
+
+#include <OgreMesh.h>
+
+#include "OgreColladaMeshData.h"
+
+namespace OgreCollada {
+
+// Reduce a triangle list to (at most) the target number of triangles, if possible, by collapsing
+// edges in order of increasing quadric error.  Vertices are never moved or created, so the result
+// indexes the same vertex array.  Vertices on open edges - including the seams where a position was
+// split because of differing normals or texture coordinates - are left in place
+void simplifyIndices(const VertexArray&, const std::vector<Ogre::uint32>& indices,
+                     size_t targetTriangles, std::vector<Ogre::uint32>& result);
+
+// Reduced index lists for each submesh of a mesh
+struct LodData {
+  std::vector<size_t> triangleCounts;                        // per level, starting with level 1
+  std::vector<std::vector<std::vector<Ogre::uint32> > > indices;   // [level - 1][submesh]
+};
+
+// Produce the given number of reduced levels, each with "reduction" times the triangles of the last.
+// A level keeps at least one triangle of each (non-empty) submesh: where simplifying would remove them
+// all, the previous level is repeated.  Submeshes are divided among up to "threads" threads
+LodData generateLods(const MeshData&, size_t levels, Ogre::Real reduction, unsigned threads = 1);
+
+// Attach generated levels to a mesh made from the same MeshData, switching to each level when
+// the mesh covers fewer than pixelsPerTriangle screen pixels per triangle of that level
+void applyLods(Ogre::MeshPtr, const MeshData&, const LodData&, Ogre::Real pixelsPerTriangle);
+
+// The index buffer space applyLods gives each submesh, over all the levels
+void lodIndexBytes(const MeshData&, const LodData&, std::vector<size_t>& bytes);
+
+} // end namespace OgreCollada
+
+#endif // OGRE_COLLADA_MESHSIMPLIFIER_H
@@ -0,0 +1,312 @@
+// Implementation of out-of-core mesh accumulation and .mesh output
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+#include <boost/filesystem.hpp>
+
+#include <OgreLogManager.h>
+#include <OgreStringConverter.h>
+#include <OgreHardwareVertexBuffer.h>
+#include <OgreMeshFileFormat.h>
+
+#include "OgreColladaOutOfCoreMesh.h"
+#include "OgreColladaLog.h"
+
+namespace {
+
+// The pieces of the Ogre mesh file format we need.  Every chunk starts with a 16-bit ID and a 32-bit size,
+// which includes this header.  Values are in native byte order; Ogre detects and corrects swapped files
+const char* MESH_VERSION = "[MeshSerializer_v1.8]";
+const size_t CHUNK_OVERHEAD = sizeof(Ogre::uint16) + sizeof(Ogre::uint32);
+
+// how many values to move between spill files and the output at once
+const size_t COPY_BLOCK = 65536;
+
+template<typename T>
+void writeValue(std::ostream& os, const T& value) {
+  os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void writeBool(std::ostream& os, bool value) {
+  writeValue(os, char(value ? 1 : 0));
+}
+
+void writeString(std::ostream& os, const Ogre::String& s) {
+  os.write(s.data(), s.size());
+  os.put('\n');
+}
+
+void writeChunkHeader(std::ostream& os, Ogre::MeshChunkID id, size_t size) {
+  writeValue(os, Ogre::uint16(id));
+  writeValue(os, Ogre::uint32(size));
+}
+
+template<typename T>
+bool appendToFile(const Ogre::String& fileName, const std::vector<T>& data) {
+  std::ofstream file(fileName.c_str(), std::ios::binary | std::ios::app);
+  file.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(T));
+  return bool(file);
+}
+
+// copy "count" values of type T from a spill file to the output
+template<typename T>
+bool copyFromFile(std::ostream& os, const Ogre::String& fileName, size_t count) {
+  if (count == 0) {
+    return true;
+  }
+  std::ifstream file(fileName.c_str(), std::ios::binary);
+  std::vector<T> block;
+  while (count > 0) {
+    block.resize(std::min(count, COPY_BLOCK));
+    if (!file.read(reinterpret_cast<char*>(block.data()), block.size() * sizeof(T))) {
+      return false;
+    }
+    os.write(reinterpret_cast<const char*>(block.data()), block.size() * sizeof(T));
+    count -= block.size();
+  }
+  return true;
+}
+
+// the same for indices, which may get narrowed to 16 bits on the way
+bool copyIndicesFromFile(std::ostream& os, const Ogre::String& fileName, size_t count, bool wide) {
+  if (wide || (count == 0)) {
+    return copyFromFile<Ogre::uint32>(os, fileName, count);
+  }
+  std::ifstream file(fileName.c_str(), std::ios::binary);
+  std::vector<Ogre::uint32> block;
+  std::vector<Ogre::uint16> narrow;
+  while (count > 0) {
+    block.resize(std::min(count, COPY_BLOCK));
+    if (!file.read(reinterpret_cast<char*>(block.data()), block.size() * sizeof(Ogre::uint32))) {
+      return false;
+    }
+    narrow.assign(block.begin(), block.end());
+    os.write(reinterpret_cast<const char*>(narrow.data()), narrow.size() * sizeof(Ogre::uint16));
+    count -= block.size();
+  }
+  return true;
+}
+
+void writeIndices(std::ostream& os, const std::vector<Ogre::uint32>& indices, bool wide) {
+  if (wide) {
+    os.write(reinterpret_cast<const char*>(indices.data()), indices.size() * sizeof(Ogre::uint32));
+  } else {
+    std::vector<Ogre::uint16> narrow(indices.begin(), indices.end());
+    os.write(reinterpret_cast<const char*>(narrow.data()), narrow.size() * sizeof(Ogre::uint16));
+  }
+}
+
+}
+
+OgreCollada::OutOfCoreMesh::OutOfCoreMesh(const Ogre::String& spillDir, size_t memoryBudget)
+  : m_spillDir(spillDir), m_memoryBudget(memoryBudget), m_bufferedBytes(0), m_peakBufferedBytes(0), m_spilledBytes(0) {}
+
+OgreCollada::OutOfCoreMesh::~OutOfCoreMesh() {
+  for (size_t i = 0; i < m_buckets.size(); ++i) {
+    boost::system::error_code ec;
+    boost::filesystem::remove(m_buckets[i].vertexFile, ec);
+    boost::filesystem::remove(m_buckets[i].indexFile, ec);
+  }
+}
+
+bool OgreCollada::OutOfCoreMesh::add(const MeshData& md) {
+  for (size_t i = 0; i < md.submeshes.size(); ++i) {
+    const SubmeshData& smd = md.submeshes[i];
+    if (smd.indices.empty()) {
+      continue;
+    }
+    const VertexArray& source = smd.useSharedVertices ? md.sharedVertices : smd.vertices;
+
+    BucketKey key(smd.materialName, std::make_pair(int(smd.opType), std::make_pair(source.hasNormals, source.hasUVs)));
+    std::map<BucketKey, size_t>::const_iterator bit = m_bucketIndex.find(key);
+    if (bit == m_bucketIndex.end()) {
+      bit = m_bucketIndex.insert(std::make_pair(key, m_buckets.size())).first;
+      m_buckets.push_back(Bucket());
+      Bucket& bucket = m_buckets.back();
+      bucket.material = smd.materialName;
+      bucket.opType = smd.opType;
+      bucket.hasNormals = source.hasNormals;
+      bucket.hasUVs = source.hasUVs;
+      Ogre::String stem = (boost::filesystem::path(m_spillDir) / boost::filesystem::unique_path("spill-%%%%-%%%%-%%%%")).string();
+      bucket.vertexFile = stem + ".vertices";
+      bucket.indexFile = stem + ".indices";
+    }
+    Bucket& bucket = m_buckets[bit->second];
+
+    // copy the vertices this submesh uses (shared vertex pools hold those of other submeshes too)
+    const Ogre::uint32 UNMAPPED = ~Ogre::uint32(0);
+    std::vector<Ogre::uint32> remap(source.size(), UNMAPPED);
+    size_t stride = source.stride();
+    size_t firstVertex = bucket.vertexCount;
+    if (firstVertex + source.size() > size_t(UNMAPPED)) {
+      LOG_DEBUG("COLLADA ERROR: too many vertices for 32-bit indices in submesh with material " + bucket.material);
+      return false;
+    }
+    for (size_t j = 0; j < smd.indices.size(); ++j) {
+      Ogre::uint32 idx = smd.indices[j];
+      if (remap[idx] == UNMAPPED) {
+	remap[idx] = Ogre::uint32(bucket.vertexCount++);
+	const Ogre::Real* v = source.vertex(idx);
+	bucket.vertices.insert(bucket.vertices.end(), v, v + stride);
+	m_bounds.merge(Ogre::Vector3(v[0], v[1], v[2]));
+      }
+      bucket.indices.push_back(remap[idx]);
+    }
+    bucket.indexCount += smd.indices.size();
+    m_bufferedBytes += (bucket.vertexCount - firstVertex) * stride * sizeof(float) + smd.indices.size() * sizeof(Ogre::uint32);
+    m_peakBufferedBytes = std::max(m_peakBufferedBytes, m_bufferedBytes);
+
+    // check after every submesh, so one large geometry can't take us far past the budget
+    if ((m_bufferedBytes > m_memoryBudget) && !spillAll()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool OgreCollada::OutOfCoreMesh::spill(Bucket& bucket) {
+  if (!appendToFile(bucket.vertexFile, bucket.vertices) || !appendToFile(bucket.indexFile, bucket.indices)) {
+    LOG_DEBUG("COLLADA ERROR: could not write to spill file " + bucket.vertexFile);
+    return false;
+  }
+  bucket.spilledVertices += bucket.vertices.size();
+  bucket.spilledIndices += bucket.indices.size();
+  size_t bytes = bucket.vertices.size() * sizeof(float) + bucket.indices.size() * sizeof(Ogre::uint32);
+  m_spilledBytes += bytes;
+  m_bufferedBytes -= bytes;
+  // release the memory, not just the contents
+  std::vector<float>().swap(bucket.vertices);
+  std::vector<Ogre::uint32>().swap(bucket.indices);
+  return true;
+}
+
+bool OgreCollada::OutOfCoreMesh::spillAll() {
+  for (size_t i = 0; i < m_buckets.size(); ++i) {
+    if (!spill(m_buckets[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool OgreCollada::OutOfCoreMesh::write(const Ogre::String& fileName) {
+  std::ofstream out(fileName.c_str(), std::ios::binary);
+  if (!out) {
+    LOG_DEBUG("COLLADA ERROR: could not open " + fileName + " for writing");
+    return false;
+  }
+
+  // Chunk sizes come first, so work them all out from the counts before writing anything
+  std::vector<size_t> submeshSizes(m_buckets.size());
+  size_t meshSize = CHUNK_OVERHEAD + 1;       // skeletally animated flag
+  for (size_t i = 0; i < m_buckets.size(); ++i) {
+    const Bucket& bucket = m_buckets[i];
+    size_t elements = 1 + (bucket.hasNormals ? 1 : 0) + (bucket.hasUVs ? 1 : 0);
+    size_t vertexSize = (3 + (bucket.hasNormals ? 3 : 0) + (bucket.hasUVs ? 2 : 0)) * sizeof(float);
+    size_t indexSize = (bucket.vertexCount > MAX_16BIT_VERTICES) ? sizeof(Ogre::uint32) : sizeof(Ogre::uint16);
+    size_t geometrySize = CHUNK_OVERHEAD + sizeof(Ogre::uint32) +
+      CHUNK_OVERHEAD + elements * (CHUNK_OVERHEAD + 5 * sizeof(Ogre::uint16)) +
+      CHUNK_OVERHEAD + 2 * sizeof(Ogre::uint16) + CHUNK_OVERHEAD + bucket.vertexCount * vertexSize;
+    submeshSizes[i] = CHUNK_OVERHEAD + bucket.material.size() + 1 + 1 + sizeof(Ogre::uint32) + 1 +
+      bucket.indexCount * indexSize + geometrySize + CHUNK_OVERHEAD + sizeof(Ogre::uint16);
+    meshSize += submeshSizes[i];
+  }
+  meshSize += CHUNK_OVERHEAD + 7 * sizeof(float);
+  if (meshSize > size_t(~Ogre::uint32(0))) {
+    // Ogre reads the top level chunks in sequence without consulting their sizes, so this still loads
+    LOG_DEBUG("COLLADA WARNING: mesh data exceeds 4GB; chunk sizes in " + fileName + " will be truncated");
+  }
+
+  writeValue(out, Ogre::uint16(Ogre::M_HEADER));
+  writeString(out, MESH_VERSION);
+  writeChunkHeader(out, Ogre::M_MESH, meshSize);
+  writeBool(out, false);
+
+  for (size_t i = 0; i < m_buckets.size(); ++i) {
+    const Bucket& bucket = m_buckets[i];
+    bool wide = bucket.vertexCount > MAX_16BIT_VERTICES;
+    writeChunkHeader(out, Ogre::M_SUBMESH, submeshSizes[i]);
+    writeString(out, bucket.material);
+    writeBool(out, false);                    // own vertices
+    writeValue(out, Ogre::uint32(bucket.indexCount));
+    writeBool(out, wide);
+    if (!copyIndicesFromFile(out, bucket.indexFile, bucket.spilledIndices, wide)) {
+      LOG_DEBUG("COLLADA ERROR: could not read spill file " + bucket.indexFile);
+      return false;
+    }
+    writeIndices(out, bucket.indices, wide);
+
+    // a single interleaved vertex buffer laid out as in VertexArray
+    size_t elements = 1 + (bucket.hasNormals ? 1 : 0) + (bucket.hasUVs ? 1 : 0);
+    size_t floats = 3 + (bucket.hasNormals ? 3 : 0) + (bucket.hasUVs ? 2 : 0);
+    writeChunkHeader(out, Ogre::M_GEOMETRY,
+		     CHUNK_OVERHEAD + sizeof(Ogre::uint32) +
+		     CHUNK_OVERHEAD + elements * (CHUNK_OVERHEAD + 5 * sizeof(Ogre::uint16)) +
+		     CHUNK_OVERHEAD + 2 * sizeof(Ogre::uint16) + CHUNK_OVERHEAD + bucket.vertexCount * floats * sizeof(float));
+    writeValue(out, Ogre::uint32(bucket.vertexCount));
+    writeChunkHeader(out, Ogre::M_GEOMETRY_VERTEX_DECLARATION,
+		     CHUNK_OVERHEAD + elements * (CHUNK_OVERHEAD + 5 * sizeof(Ogre::uint16)));
+    Ogre::uint16 offset = 0;
+    Ogre::VertexElementSemantic semantics[] = { Ogre::VES_POSITION, Ogre::VES_NORMAL, Ogre::VES_TEXTURE_COORDINATES };
+    Ogre::VertexElementType types[] = { Ogre::VET_FLOAT3, Ogre::VET_FLOAT3, Ogre::VET_FLOAT2 };
+    bool present[] = { true, bucket.hasNormals, bucket.hasUVs };
+    for (int e = 0; e < 3; ++e) {
+      if (!present[e]) {
+	continue;
+      }
+      writeChunkHeader(out, Ogre::M_GEOMETRY_VERTEX_ELEMENT, CHUNK_OVERHEAD + 5 * sizeof(Ogre::uint16));
+      writeValue(out, Ogre::uint16(0));             // source
+      writeValue(out, Ogre::uint16(types[e]));
+      writeValue(out, Ogre::uint16(semantics[e]));
+      writeValue(out, offset);
+      writeValue(out, Ogre::uint16(0));             // index
+      offset += Ogre::uint16(((types[e] == Ogre::VET_FLOAT3) ? 3 : 2) * sizeof(float));
+    }
+    writeChunkHeader(out, Ogre::M_GEOMETRY_VERTEX_BUFFER,
+		     CHUNK_OVERHEAD + 2 * sizeof(Ogre::uint16) + CHUNK_OVERHEAD + bucket.vertexCount * floats * sizeof(float));
+    writeValue(out, Ogre::uint16(0));               // bind index
+    writeValue(out, Ogre::uint16(floats * sizeof(float)));
+    writeChunkHeader(out, Ogre::M_GEOMETRY_VERTEX_BUFFER_DATA, CHUNK_OVERHEAD + bucket.vertexCount * floats * sizeof(float));
+    if (!copyFromFile<float>(out, bucket.vertexFile, bucket.spilledVertices)) {
+      LOG_DEBUG("COLLADA ERROR: could not read spill file " + bucket.vertexFile);
+      return false;
+    }
+    out.write(reinterpret_cast<const char*>(bucket.vertices.data()), bucket.vertices.size() * sizeof(float));
+
+    writeChunkHeader(out, Ogre::M_SUBMESH_OPERATION, CHUNK_OVERHEAD + sizeof(Ogre::uint16));
+    writeValue(out, Ogre::uint16(bucket.opType));
+  }
+
+  // bounds, and the radius of a sphere about the origin enclosing them
+  writeChunkHeader(out, Ogre::M_MESH_BOUNDS, CHUNK_OVERHEAD + 7 * sizeof(float));
+  Ogre::Vector3 minimum = m_bounds.isNull() ? Ogre::Vector3::ZERO : m_bounds.getMinimum();
+  Ogre::Vector3 maximum = m_bounds.isNull() ? Ogre::Vector3::ZERO : m_bounds.getMaximum();
+  Ogre::Vector3 farthest(std::max(std::abs(minimum.x), std::abs(maximum.x)),
+			 std::max(std::abs(minimum.y), std::abs(maximum.y)),
+			 std::max(std::abs(minimum.z), std::abs(maximum.z)));
+  float bounds[] = { float(minimum.x), float(minimum.y), float(minimum.z),
+		     float(maximum.x), float(maximum.y), float(maximum.z), float(farthest.length()) };
+  out.write(reinterpret_cast<const char*>(bounds), sizeof(bounds));
+
+  if (!out) {
+    LOG_DEBUG("COLLADA ERROR: could not write " + fileName);
+    return false;
+  }
+  LOG_DEBUG("wrote " + Ogre::StringConverter::toString(m_buckets.size()) + " submeshes to " + fileName + " with " +
+	    Ogre::StringConverter::toString(m_spilledBytes) + " bytes passing through spill files (at most " +
+	    Ogre::StringConverter::toString(m_peakBufferedBytes) + " buffered)");
+  return true;
+}
@@ -0,0 +1,84 @@
+// OgreColladaOutOfCoreMesh.h, accumulation of mesh data in temporary files, for meshes too big to keep in memory
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef OGRE_COLLADA_OUTOFCOREMESH_H
+#define OGRE_COLLADA_OUTOFCOREMESH_H
+
+#include <map>
+#include <vector>
+
+#include <OgreString.h>
+#include <OgreAxisAlignedBox.h>
+#include <OgreRenderOperation.h>
+
+#include "OgreColladaMeshData.h"
+
+namespace OgreCollada {
+
+// Collects submeshes by material, primitive type, and vertex attributes, keeping at most a fixed amount of
+// vertex and index data in memory; the rest is appended to "spill" files.  The result is written as an
+// Ogre .mesh file with sequential I/O, one submesh per collection, without creating the mesh in Ogre.
+// Vertices are stored as floats and indices are 32 bits wide only where the vertex count requires it
+class OutOfCoreMesh {
+ public:
+  OutOfCoreMesh(const Ogre::String& spillDir,    // where to put temporary files
+		size_t memoryBudget);            // bytes of vertex and index data to buffer
+  ~OutOfCoreMesh();                              // removes the spill files
+
+  // Append the submeshes of md.  Returns false if spill files could not be written
+  bool add(const MeshData& md);
+
+  bool write(const Ogre::String& fileName);
+
+  size_t getSubmeshCount() const { return m_buckets.size(); }
+  size_t getSpilledBytes() const { return m_spilledBytes; }
+  // the most vertex and index data held at once; over the budget by no more than one submesh
+  size_t getPeakBufferedBytes() const { return m_peakBufferedBytes; }
+
+ private:
+  // hide default xtor and compiler-generated copy and assignment operators
+  OutOfCoreMesh();
+  OutOfCoreMesh(const OutOfCoreMesh&);
+  const OutOfCoreMesh& operator=(const OutOfCoreMesh&);
+
+  struct Bucket {
+    Bucket() : opType(Ogre::RenderOperation::OT_TRIANGLE_LIST), hasNormals(false), hasUVs(false),
+	       vertexCount(0), indexCount(0), spilledVertices(0), spilledIndices(0) {}
+
+    Ogre::String material;
+    Ogre::RenderOperation::OperationType opType;
+    bool hasNormals, hasUVs;
+    size_t vertexCount, indexCount;              // in total, including what has been spilled
+    std::vector<float> vertices;                 // not yet spilled
+    std::vector<Ogre::uint32> indices;
+    size_t spilledVertices, spilledIndices;
+    Ogre::String vertexFile, indexFile;
+  };
+  typedef std::pair<Ogre::String, std::pair<int, std::pair<bool, bool> > > BucketKey;
+  std::map<BucketKey, size_t> m_bucketIndex;
+  std::vector<Bucket> m_buckets;
+
+  bool spill(Bucket&);
+  bool spillAll();
+
+  Ogre::String m_spillDir;
+  size_t m_memoryBudget;
+  size_t m_bufferedBytes;
+  size_t m_peakBufferedBytes;
+  size_t m_spilledBytes;
+  Ogre::AxisAlignedBox m_bounds;
+};
+
+} // end namespace OgreCollada
+
+#endif // OGRE_COLLADA_OUTOFCOREMESH_H
@@ -0,0 +1,244 @@
+// Implementation of the import profiler
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "OgreColladaProfiler.h"
+#include "OgreColladaJson.h"
+
+#include <algorithm>
+#include <iomanip>
+
+const size_t OgreCollada::Profiler::NO_PARENT;
+
+OgreCollada::Profiler::Profiler() : m_origin(Clock::now()) {}
+
+size_t OgreCollada::Profiler::threadNumber(std::thread::id id) {
+  std::map<std::thread::id, std::pair<size_t, std::vector<size_t> > >::iterator it = m_threads.find(id);
+  if (it == m_threads.end()) {
+    it = m_threads.insert(std::make_pair(id, std::make_pair(m_threads.size(), std::vector<size_t>()))).first;
+  }
+  return it->second.first;
+}
+
+void OgreCollada::Profiler::begin(const char* name, const Ogre::String& detail) {
+  Clock::time_point now = Clock::now();
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Scope scope;
+  scope.name = name;
+  scope.detail = detail;
+  scope.thread = threadNumber(std::this_thread::get_id());
+  std::vector<size_t>& open = m_threads[std::this_thread::get_id()].second;
+  scope.parent = open.empty() ? NO_PARENT : open.back();
+  scope.start = now;
+  scope.end = Clock::time_point();   // still open
+  open.push_back(m_scopes.size());
+  m_scopes.push_back(scope);
+}
+
+void OgreCollada::Profiler::end() {
+  Clock::time_point now = Clock::now();
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::map<std::thread::id, std::pair<size_t, std::vector<size_t> > >::iterator it = m_threads.find(std::this_thread::get_id());
+  if ((it == m_threads.end()) || it->second.second.empty()) {
+    return;     // unbalanced; ignore rather than corrupt another scope
+  }
+  m_scopes[it->second.second.back()].end = now;
+  it->second.second.pop_back();
+}
+
+void OgreCollada::Profiler::count(const char* name, double amount) {
+  Clock::time_point now = Clock::now();
+  std::lock_guard<std::mutex> lock(m_mutex);
+  double& total = m_counters[name];
+  total += amount;
+  CounterSample sample = { name, threadNumber(std::this_thread::get_id()), now, total };
+  m_samples.push_back(sample);
+}
+
+double OgreCollada::Profiler::getCount(const char* name) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::map<Ogre::String, double>::const_iterator it = m_counters.find(name);
+  return (it == m_counters.end()) ? 0 : it->second;
+}
+
+void OgreCollada::Profiler::clear() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_origin = Clock::now();
+  m_scopes.clear();
+  m_samples.clear();
+  m_counters.clear();
+  m_threads.clear();
+}
+
+Ogre::String OgreCollada::Profiler::path(size_t scope) const {
+  Ogre::String result = m_scopes[scope].name;
+  for (size_t p = m_scopes[scope].parent; p != NO_PARENT; p = m_scopes[p].parent) {
+    result = Ogre::String(m_scopes[p].name) + "/" + result;
+  }
+  return result;
+}
+
+void OgreCollada::Profiler::writeChromeTrace(std::ostream& os) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::ios::fmtflags flags = os.flags();
+  std::streamsize precision = os.precision();
+  os << std::fixed << std::setprecision(3);
+
+  os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  bool first = true;
+  for (std::map<std::thread::id, std::pair<size_t, std::vector<size_t> > >::const_iterator it = m_threads.begin();
+       it != m_threads.end(); ++it) {
+    os << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << it->second.first
+       << ",\"args\":{\"name\":\"" << ((it->second.first == 0) ? "import" : "worker ") ;
+    if (it->second.first != 0) {
+      os << it->second.first;
+    }
+    os << "\"}}";
+    first = false;
+  }
+  for (size_t i = 0; i < m_scopes.size(); ++i) {
+    const Scope& scope = m_scopes[i];
+    if (scope.end == Clock::time_point()) {
+      continue;   // never ended
+    }
+    os << (first ? "" : ",\n") << "{\"name\":";
+    writeJsonString(os, scope.name);
+    os << ",\"cat\":\"import\",\"ph\":\"X\",\"pid\":1,\"tid\":" << scope.thread
+       << ",\"ts\":" << microseconds(scope.start)
+       << ",\"dur\":" << std::chrono::duration<double, std::micro>(scope.end - scope.start).count();
+    if (!scope.detail.empty()) {
+      os << ",\"args\":{\"detail\":";
+      writeJsonString(os, scope.detail);
+      os << "}";
+    }
+    os << "}";
+    first = false;
+  }
+  for (size_t i = 0; i < m_samples.size(); ++i) {
+    const CounterSample& sample = m_samples[i];
+    os << (first ? "" : ",\n") << "{\"name\":";
+    writeJsonString(os, sample.name);
+    os << ",\"ph\":\"C\",\"pid\":1,\"tid\":" << sample.thread << ",\"ts\":" << microseconds(sample.time)
+       << ",\"args\":{\"value\":" << sample.total << "}}";
+    first = false;
+  }
+  os << "\n]}\n";
+
+  os.flags(flags);
+  os.precision(precision);
+}
+
+void OgreCollada::Profiler::writeSummary(std::ostream& os, size_t slowest) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  // combine the scopes with the same path, keeping the paths in the order they first began
+  struct Phase {
+    Ogre::String name;
+    size_t parent;
+    std::vector<size_t> children;
+    size_t calls;
+    double total, self, longest;     // milliseconds
+  };
+  std::vector<Phase> phases;
+  std::map<Ogre::String, size_t> phaseOfPath;
+  std::vector<size_t> scopePhase(m_scopes.size(), NO_PARENT);
+  std::vector<size_t> finished;
+  for (size_t i = 0; i < m_scopes.size(); ++i) {
+    const Scope& scope = m_scopes[i];
+    Ogre::String p = path(i);
+    std::map<Ogre::String, size_t>::const_iterator it = phaseOfPath.find(p);
+    if (it == phaseOfPath.end()) {
+      Phase phase;
+      phase.name = scope.name;
+      phase.parent = (scope.parent == NO_PARENT) ? NO_PARENT : scopePhase[scope.parent];
+      phase.calls = 0;
+      phase.total = phase.self = phase.longest = 0;
+      if (phase.parent != NO_PARENT) {
+	phases[phase.parent].children.push_back(phases.size());
+      }
+      it = phaseOfPath.insert(std::make_pair(p, phases.size())).first;
+      phases.push_back(phase);
+    }
+    scopePhase[i] = it->second;
+    if (scope.end == Clock::time_point()) {
+      continue;
+    }
+    finished.push_back(i);
+    double ms = std::chrono::duration<double, std::milli>(scope.end - scope.start).count();
+    Phase& phase = phases[it->second];
+    ++phase.calls;
+    phase.total += ms;
+    phase.self += ms;
+    phase.longest = std::max(phase.longest, ms);
+    if (scope.parent != NO_PARENT) {
+      phases[scopePhase[scope.parent]].self -= ms;
+    }
+  }
+
+  std::ios::fmtflags flags = os.flags();
+  std::streamsize precision = os.precision();
+  os << std::fixed << std::setprecision(2);
+
+  os << std::setw(12) << "total ms" << std::setw(12) << "self ms" << std::setw(10) << "calls"
+     << std::setw(12) << "longest ms" << "  phase\n";
+  // depth-first, children in the order they began
+  std::vector<std::pair<size_t, size_t> > stack;    // (phase, depth)
+  for (size_t i = phases.size(); i-- > 0; ) {
+    if (phases[i].parent == NO_PARENT) {
+      stack.push_back(std::make_pair(i, 0));
+    }
+  }
+  while (!stack.empty()) {
+    const Phase& phase = phases[stack.back().first];
+    size_t depth = stack.back().second;
+    stack.pop_back();
+    os << std::setw(12) << phase.total << std::setw(12) << phase.self << std::setw(10) << phase.calls
+       << std::setw(12) << phase.longest << "  " << Ogre::String(2 * depth, ' ') << phase.name << "\n";
+    for (size_t i = phase.children.size(); i-- > 0; ) {
+      stack.push_back(std::make_pair(phase.children[i], depth + 1));
+    }
+  }
+
+  // the individual scopes that took longest, among those with details to tell them apart
+  std::vector<std::pair<double, size_t> > detailed;
+  for (size_t i = 0; i < finished.size(); ++i) {
+    const Scope& scope = m_scopes[finished[i]];
+    if (!scope.detail.empty()) {
+      detailed.push_back(std::make_pair(std::chrono::duration<double, std::milli>(scope.end - scope.start).count(),
+					finished[i]));
+    }
+  }
+  if (!detailed.empty() && (slowest > 0)) {
+    size_t n = std::min(slowest, detailed.size());
+    std::partial_sort(detailed.begin(), detailed.begin() + n, detailed.end(),
+		      [](const std::pair<double, size_t>& a, const std::pair<double, size_t>& b) {
+			return (a.first > b.first) || ((a.first == b.first) && (a.second < b.second));
+		      });
+    os << "\nslowest:\n";
+    for (size_t i = 0; i < n; ++i) {
+      const Scope& scope = m_scopes[detailed[i].second];
+      os << std::setw(12) << detailed[i].first << "  " << scope.name << " " << scope.detail << "\n";
+    }
+  }
+
+  if (!m_counters.empty()) {
+    os << "\ncounters:\n";
+    os.unsetf(std::ios::floatfield);
+    os << std::setprecision(12);
+    for (std::map<Ogre::String, double>::const_iterator it = m_counters.begin(); it != m_counters.end(); ++it) {
+      os << std::setw(12) << it->second << "  " << it->first << "\n";
+    }
+  }
+
+  os.flags(flags);
+  os.precision(precision);
+}
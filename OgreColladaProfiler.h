@@ -0,0 +1,127 @@
+// OgreColladaProfiler.h, timing of import phases and counting of what they produce, for finding
+// where import time goes.  Results can be viewed in Chrome's about:tracing or summarized as a table
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef OGRE_COLLADA_PROFILER_H
+#define OGRE_COLLADA_PROFILER_H
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include <OgreString.h>
+
+namespace OgreCollada {
+
+// Records nested spans of time ("scopes") on any number of threads, and running totals of named counters.
+// Importers report to one if it is supplied via Writer::setProfiler and the library was built with
+// OGRECOLLADA_PROFILING defined; otherwise the instrumentation compiles to nothing
+class Profiler {
+ public:
+  Profiler();
+
+  // Start and end a span of time on the calling thread.  Spans on one thread must nest.
+  // The detail (a geometry ID, say) distinguishes instances of a phase in the trace
+  void begin(const char* name, const Ogre::String& detail = Ogre::String());
+  void end();
+
+  // add to the running total of a counter (triangles emitted, say)
+  void count(const char* name, double amount = 1);
+  double getCount(const char* name) const;
+
+  // Chrome trace event format: a complete ("X") event per scope, and a counter ("C") event per change
+  void writeChromeTrace(std::ostream&) const;
+
+  // Time per phase, with phases nested as they were called, followed by the slowest individual
+  // scopes (the geometries taking the longest to convert, for example) and the counter totals
+  void writeSummary(std::ostream&, size_t slowest = 10) const;
+
+  void clear();
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Scope {
+    const char* name;
+    Ogre::String detail;
+    size_t thread;              // in order of first appearance
+    size_t parent;              // enclosing scope on the same thread, or NO_PARENT
+    Clock::time_point start, end;
+  };
+  static const size_t NO_PARENT = ~size_t(0);
+
+  struct CounterSample {
+    const char* name;
+    size_t thread;
+    Clock::time_point time;
+    double total;
+  };
+
+  mutable std::mutex m_mutex;
+  Clock::time_point m_origin;
+  std::vector<Scope> m_scopes;
+  std::vector<CounterSample> m_samples;
+  std::map<Ogre::String, double> m_counters;
+  // per thread, its number and the scopes it has open, innermost last
+  std::map<std::thread::id, std::pair<size_t, std::vector<size_t> > > m_threads;
+
+  size_t threadNumber(std::thread::id);     // call with m_mutex held
+  double microseconds(Clock::time_point t) const {
+    return std::chrono::duration<double, std::micro>(t - m_origin).count();
+  }
+  // scope names from the outermost down to this one, separated by "/"
+  Ogre::String path(size_t scope) const;
+};
+
+// Times its own lifetime, if given a profiler
+class ProfileScope {
+ public:
+  ProfileScope(Profiler* profiler, const char* name, const Ogre::String& detail = Ogre::String())
+    : m_profiler(profiler) {
+    if (m_profiler) {
+      m_profiler->begin(name, detail);
+    }
+  }
+  ~ProfileScope() {
+    if (m_profiler) {
+      m_profiler->end();
+    }
+  }
+
+ private:
+  Profiler* m_profiler;
+  ProfileScope(const ProfileScope&);
+  const ProfileScope& operator=(const ProfileScope&);
+};
+
+} // end namespace OgreCollada
+
+// Instrumentation for the library's own code.  One scope per block; the profiler may be null.
+// The detail expression is evaluated only when profiling
+#ifdef OGRECOLLADA_PROFILING
+#define OGRECOLLADA_PROFILE_SCOPE(profiler, name) \
+  OgreCollada::ProfileScope ogreColladaProfileScope((profiler), (name))
+#define OGRECOLLADA_PROFILE_SCOPE_DETAIL(profiler, name, detail) \
+  OgreCollada::ProfileScope ogreColladaProfileScope((profiler), (name), (profiler) ? Ogre::String(detail) : Ogre::String())
+#define OGRECOLLADA_PROFILE_COUNT(profiler, name, amount) \
+  { if (profiler) { (profiler)->count((name), (amount)); } }
+#else
+#define OGRECOLLADA_PROFILE_SCOPE(profiler, name)
+#define OGRECOLLADA_PROFILE_SCOPE_DETAIL(profiler, name, detail)
+#define OGRECOLLADA_PROFILE_COUNT(profiler, name, amount)
+#endif
+
+#endif // OGRE_COLLADA_PROFILER_H
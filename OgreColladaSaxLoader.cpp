@@ -19,7 +19,7 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 #include "OgreColladaWriter.h"
 
 OgreCollada::SaxLoader::ExtraDataHandler::ExtraDataHandler()
-  : COLLADASaxFWL::IExtraDataCallbackHandler(), m_latestEffect(0) {}
+  : COLLADASaxFWL::IExtraDataCallbackHandler(), m_latestEffect(0), m_writer(0) {}
 
 OgreCollada::SaxLoader::ExtraDataHandler::~ExtraDataHandler() {}
 
@@ -34,6 +34,9 @@ bool OgreCollada::SaxLoader::ExtraDataHandler::elementEnd(const ParserChar* elem
 }
 
 bool OgreCollada::SaxLoader::ExtraDataHandler::textData(const ParserChar* text, size_t textLength) {
+   if (!m_writer || !m_latestEffect) {
+     return true;   // no writer to tell, or not within an effect
+   }
    if (std::string(text, textLength) == "1") {
      // a single value of 1 indicates we should disable backside culling (so the material is visible from both sides)
      m_writer->disableCulling(m_latestEffect->getUniqueId());
@@ -55,25 +58,42 @@ void OgreCollada::SaxLoader::ExtraDataHandler::setWriter(OgreCollada::Writer* w)
   m_writer = w;
 }
 
+OgreCollada::Profiler* OgreCollada::SaxLoader::profiler() const {
+  Writer* w = m_extraDataHandler.getWriter();
+  return w ? w->getProfiler() : 0;
+}
+
 OgreCollada::SaxLoader::SaxLoader()
   : COLLADASaxFWL::Loader() {
   // add our private callback for <extra> tags
   registerExtraDataCallbackHandler(&m_extraDataHandler);
+  setObjectFlags(USED_OBJECTS_MASK);
 }
 
-OgreCollada::SaxLoader::~SaxLoader() {}
+OgreCollada::SaxLoader::~SaxLoader() {
+  // the Collada objects the writer refers to go with us
+  if (Writer* w = m_extraDataHandler.getWriter()) {
+    w->releaseDocument();
+  }
+}
 
 bool OgreCollada::SaxLoader::loadDocument(const COLLADAFW::String& fileName,
                                         COLLADAFW::IWriter* writer) {
   // give the <extra> handler access to the writer to communicate special
   // information (initially, which materials should be double-sided)
-  m_extraDataHandler.setWriter(dynamic_cast<Writer*>(writer));
+  if (Writer* w = dynamic_cast<Writer*>(writer)) {
+    m_extraDataHandler.setWriter(w);
+  }
+  OGRECOLLADA_PROFILE_SCOPE_DETAIL(profiler(), "loadDocument", fileName);
   return COLLADASaxFWL::Loader::loadDocument(fileName, writer);
 }
 
 bool OgreCollada::SaxLoader::loadDocument(const COLLADAFW::String& uri,
                                         const char* buffer, int length,
                                         COLLADAFW::IWriter* writer) {
-  m_extraDataHandler.setWriter(dynamic_cast<Writer*>(writer));
+  if (Writer* w = dynamic_cast<Writer*>(writer)) {
+    m_extraDataHandler.setWriter(w);
+  }
+  OGRECOLLADA_PROFILE_SCOPE_DETAIL(profiler(), "loadDocument", uri);
   return COLLADASaxFWL::Loader::loadDocument(uri, buffer, length, writer);
 }
@@ -25,6 +25,7 @@ namespace COLLADAFW {
 namespace OgreCollada {
 
 class Writer;
+class Profiler;
 
 class SaxLoader : public COLLADASaxFWL::Loader {
   // private class implementing the callback handler interface
@@ -46,6 +47,7 @@ class SaxLoader : public COLLADASaxFWL::Loader {
       COLLADAFW::Object* object );
 
     void setWriter(Writer* writer);
+    Writer* getWriter() const { return m_writer; }
 
   private:
     COLLADAFW::Effect* m_latestEffect;
@@ -53,10 +55,21 @@ class SaxLoader : public COLLADASaxFWL::Loader {
   };
 
   ExtraDataHandler m_extraDataHandler;
+  // the profiler of the writer we are working for, if any, to time the parse
+  Profiler* profiler() const;
 
 public:
+  // The kinds of objects our writers make use of.  A SaxLoader asks the parser for only these by default
+  // (see Loader::setObjectFlags), so it passes over the libraries holding anything else - animations,
+  // skin controllers, lights, formulas, and kinematics - without building framework objects for them
+  static const int USED_OBJECTS_MASK = ASSET_FLAG | SCENE_FLAG | VISUAL_SCENES_FLAG | LIBRARY_NODES_FLAG |
+                                       GEOMETRY_FLAG | MATERIAL_FLAG | EFFECT_FLAG | CAMERA_FLAG | IMAGE_FLAG;
+
   SaxLoader();
   ~SaxLoader();
+  // The writer to receive information from <extra> elements, if the one passed to loadDocument
+  // is not itself a Writer (a proxy forwarding to one, for example)
+  void setExtraDataWriter(Writer* writer) { m_extraDataHandler.setWriter(writer); }
   // override loadDocument methods so we can access "extra" params from the writer
   virtual bool loadDocument(const COLLADAFW::String& fileName, COLLADAFW::IWriter* writer);
   virtual bool loadDocument(const COLLADAFW::String& uri, const char* buffer, int length,
@@ -0,0 +1,243 @@
+// Implementation of the scene pager
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include <boost/filesystem.hpp>
+
+#include <OgreDataStream.h>
+#include <OgreEntity.h>
+#include <OgreException.h>
+#include <OgreLogManager.h>
+#include <OgreMeshManager.h>
+#include <OgreMeshSerializer.h>
+#include <OgreResourceGroupManager.h>
+#include <OgreSceneNode.h>
+#include <OgreStringConverter.h>
+
+#include "OgreColladaScenePager.h"
+#include "OgreColladaLog.h"
+
+namespace {
+
+Ogre::Real squaredDistance(const Ogre::AxisAlignedBox& box, const Ogre::Vector3& p) {
+  Ogre::Vector3 d(std::max(std::max(box.getMinimum().x - p.x, p.x - box.getMaximum().x), Ogre::Real(0)),
+		  std::max(std::max(box.getMinimum().y - p.y, p.y - box.getMaximum().y), Ogre::Real(0)),
+		  std::max(std::max(box.getMinimum().z - p.z, p.z - box.getMaximum().z), Ogre::Real(0)));
+  return d.squaredLength();
+}
+
+}
+
+OgreCollada::ScenePager::ScenePager(Ogre::SceneManager* mgr, Ogre::SceneNode* parent, size_t memoryBudget)
+  : m_sceneMgr(mgr), m_node(parent->createChildSceneNode()), m_memoryBudget(memoryBudget), m_memoryUsed(0),
+    m_reading(NO_PAGE), m_stopping(false) {
+  m_reader = std::thread([this]() { readPages(); });
+}
+
+OgreCollada::ScenePager::~ScenePager() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+  m_wake.notify_one();
+  m_reader.join();
+  for (size_t i = 0; i < m_pages.size(); ++i) {
+    if (m_pages[i].state == PAGE_LOADED) {
+      unloadPage(Ogre::uint32(i));
+    }
+  }
+  m_sceneMgr->destroySceneNode(m_node);
+}
+
+bool OgreCollada::ScenePager::loadManifest(const Ogre::String& fileName) {
+  std::ifstream manifest(fileName.c_str());
+  if (!manifest.is_open()) {
+    LOG_DEBUG("could not open page manifest " + fileName);
+    return false;
+  }
+  m_manifest = fileName;
+  m_dir = boost::filesystem::path(fileName).parent_path().string();
+
+  std::string line;
+  while (std::getline(manifest, line)) {
+    if (line.empty() || (line[0] == '#')) {
+      continue;
+    }
+    std::istringstream fields(line);
+    Page page;
+    Ogre::Vector3 minimum, maximum;
+    if (!(fields >> page.file >> page.triangles >> minimum.x >> minimum.y >> minimum.z >> maximum.x >> maximum.y >> maximum.z)) {
+      LOG_DEBUG("malformed line in page manifest " + fileName + ": " + line);
+      return false;
+    }
+    page.bounds.setExtents(minimum, maximum);
+    boost::system::error_code ec;
+    page.size = size_t(boost::filesystem::file_size(boost::filesystem::path(m_dir) / page.file, ec));
+    page.state = ec ? PAGE_FAILED : PAGE_UNLOADED;
+    if (ec) {
+      LOG_DEBUG("page file " + page.file + " is missing");
+      page.size = 0;
+    }
+    page.entity = 0;
+    m_pages.push_back(page);
+  }
+  LOG_DEBUG("page manifest " + fileName + " lists " + Ogre::StringConverter::toString(m_pages.size()) + " pages");
+  return true;
+}
+
+size_t OgreCollada::ScenePager::getLoadedPageCount() const {
+  size_t count = 0;
+  for (size_t i = 0; i < m_pages.size(); ++i) {
+    if (m_pages[i].state == PAGE_LOADED) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+void OgreCollada::ScenePager::update(const Ogre::Vector3& viewpoint) {
+  // the pages we want are the nearest ones that fit in the budget
+  std::vector<std::pair<Ogre::Real, Ogre::uint32> > byDistance;
+  for (size_t i = 0; i < m_pages.size(); ++i) {
+    if (m_pages[i].state != PAGE_FAILED) {
+      byDistance.push_back(std::make_pair(squaredDistance(m_pages[i].bounds, viewpoint), Ogre::uint32(i)));
+    }
+  }
+  std::sort(byDistance.begin(), byDistance.end());
+  std::vector<bool> wanted(m_pages.size(), false);
+  size_t total = 0;
+  for (size_t i = 0; i < byDistance.size(); ++i) {
+    const Page& page = m_pages[byDistance[i].second];
+    if (total + page.size > m_memoryBudget) {
+      break;
+    }
+    total += page.size;
+    wanted[byDistance[i].second] = true;
+  }
+
+  std::vector<std::pair<Ogre::uint32, std::vector<char> > > read;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    read.swap(m_read);
+
+    // drop what is no longer wanted, then ask for what is, nearest first
+    for (size_t i = 0; i < m_pages.size(); ++i) {
+      if (!wanted[i] && (m_pages[i].state == PAGE_REQUESTED)) {
+	m_pages[i].state = PAGE_UNLOADED;      // its data will be discarded if it arrives
+	m_memoryUsed -= m_pages[i].size;
+      }
+    }
+    m_requests.clear();
+    for (size_t i = 0; i < byDistance.size(); ++i) {
+      Ogre::uint32 p = byDistance[i].second;
+      if (!wanted[p]) {
+	break;
+      }
+      if (m_pages[p].state == PAGE_UNLOADED) {
+	m_pages[p].state = PAGE_REQUESTED;
+	m_memoryUsed += m_pages[p].size;
+      }
+      if ((m_pages[p].state == PAGE_REQUESTED) && (p != m_reading)) {
+	m_requests.push_back(p);
+      }
+    }
+    if (!m_requests.empty()) {
+      m_wake.notify_one();
+    }
+  }
+
+  for (size_t i = 0; i < m_pages.size(); ++i) {
+    if (!wanted[i] && (m_pages[i].state == PAGE_LOADED)) {
+      unloadPage(Ogre::uint32(i));
+    }
+  }
+
+  // Pages requested more than once (dropped and wanted again while being read) can arrive twice
+  for (size_t i = 0; i < read.size(); ++i) {
+    Page& page = m_pages[read[i].first];
+    if (page.state != PAGE_REQUESTED) {
+      continue;
+    }
+    if (read[i].second.empty()) {
+      LOG_DEBUG("could not read page file " + page.file);
+      page.state = PAGE_FAILED;
+      m_memoryUsed -= page.size;
+      continue;
+    }
+    if (!createPage(read[i].first, read[i].second)) {
+      page.state = PAGE_FAILED;     // don't ask for it again
+      m_memoryUsed -= page.size;
+    }
+  }
+}
+
+bool OgreCollada::ScenePager::createPage(Ogre::uint32 p, const std::vector<char>& data) {
+  Page& page = m_pages[p];
+  page.mesh = Ogre::MeshManager::getSingleton().createManual(m_manifest + ":" + page.file,
+							      Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+  Ogre::DataStreamPtr stream(new Ogre::MemoryDataStream(const_cast<char*>(&data[0]), data.size(), false, true));
+  Ogre::MeshSerializer serializer;
+  try {
+    serializer.importMesh(stream, page.mesh.get());
+  } catch (const Ogre::Exception& e) {
+    // a damaged or foreign file; the rest of the pages are still good
+    LOG_DEBUG("could not load page file " + page.file + ": " + e.getDescription());
+    Ogre::MeshManager::getSingleton().remove(page.mesh->getHandle());
+    page.mesh.setNull();
+    return false;
+  }
+  page.entity = m_sceneMgr->createEntity(page.mesh);
+  m_node->attachObject(page.entity);
+  page.state = PAGE_LOADED;
+  return true;
+}
+
+void OgreCollada::ScenePager::unloadPage(Ogre::uint32 p) {
+  Page& page = m_pages[p];
+  m_node->detachObject(page.entity);
+  m_sceneMgr->destroyEntity(page.entity);
+  page.entity = 0;
+  Ogre::MeshManager::getSingleton().remove(page.mesh->getHandle());
+  page.mesh.setNull();
+  page.state = PAGE_UNLOADED;
+  m_memoryUsed -= page.size;
+}
+
+void OgreCollada::ScenePager::readPages() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (;;) {
+    m_wake.wait(lock, [this]() { return m_stopping || !m_requests.empty(); });
+    if (m_stopping) {
+      return;
+    }
+    m_reading = m_requests.front();
+    m_requests.pop_front();
+    boost::filesystem::path path = boost::filesystem::path(m_dir) / m_pages[m_reading].file;
+    size_t size = m_pages[m_reading].size;
+    lock.unlock();
+
+    std::vector<char> data(size);
+    std::ifstream file(path.string().c_str(), std::ios::binary);
+    if (!file.read(data.data(), data.size())) {
+      data.clear();
+    }
+
+    lock.lock();
+    m_read.push_back(std::make_pair(m_reading, std::vector<char>()));
+    m_read.back().second.swap(data);
+    m_reading = NO_PAGE;
+  }
+}
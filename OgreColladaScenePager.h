@@ -0,0 +1,93 @@
+// OgreColladaScenePager.h, loading and unloading spatial pages of a converted scene as the viewer moves
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef OGRE_COLLADA_SCENEPAGER_H
+#define OGRE_COLLADA_SCENEPAGER_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <OgreAxisAlignedBox.h>
+#include <OgreMesh.h>
+#include <OgreSceneManager.h>
+
+namespace OgreCollada {
+
+// Keeps the pages nearest a viewpoint in the scene, as many as fit in a memory budget.  Pages are read
+// from disk on a background thread; only turning the data into meshes and entities happens in update(),
+// which the application calls from the render thread (in a FrameListener, say).
+// The pages and their bounds come from the index written by "collada2ogre --tile=N": one line per page,
+// giving its mesh file (relative to the index), triangle count, and bounds.  Their materials must be
+// available to Ogre already
+class ScenePager {
+ public:
+  ScenePager(Ogre::SceneManager*,
+	     Ogre::SceneNode*,       // pages are attached beneath this node
+	     size_t memoryBudget);   // bytes, estimated from the size of the page files
+  ~ScenePager();
+
+  bool loadManifest(const Ogre::String& fileName);
+
+  // Bring the pages in line with the viewpoint (in the parent node's space)
+  void update(const Ogre::Vector3& viewpoint);
+
+  void setMemoryBudget(size_t bytes) { m_memoryBudget = bytes; }
+  size_t getPageCount() const { return m_pages.size(); }
+  size_t getLoadedPageCount() const;
+  size_t getMemoryUsed() const { return m_memoryUsed; }   // by pages loaded and on their way
+
+ private:
+  // hide default xtor and compiler-generated copy and assignment operators
+  ScenePager();
+  ScenePager(const ScenePager&);
+  const ScenePager& operator=(const ScenePager&);
+
+  enum PageState { PAGE_UNLOADED, PAGE_REQUESTED, PAGE_LOADED, PAGE_FAILED };
+  struct Page {
+    Ogre::String file;
+    size_t triangles;
+    Ogre::AxisAlignedBox bounds;
+    size_t size;
+    PageState state;
+    Ogre::MeshPtr mesh;
+    Ogre::Entity* entity;
+  };
+  bool createPage(Ogre::uint32 page, const std::vector<char>& data);   // false if the data isn't a mesh
+  void unloadPage(Ogre::uint32 page);
+  void readPages();      // the background thread
+
+  Ogre::SceneManager* m_sceneMgr;
+  Ogre::SceneNode* m_node;
+  size_t m_memoryBudget;
+  size_t m_memoryUsed;
+  Ogre::String m_dir;
+  Ogre::String m_manifest;
+  std::vector<Page> m_pages;
+
+  // shared with the background thread
+  static const Ogre::uint32 NO_PAGE = ~Ogre::uint32(0);
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::deque<Ogre::uint32> m_requests;                  // nearest first
+  Ogre::uint32 m_reading;                               // page being read, or NO_PAGE
+  std::vector<std::pair<Ogre::uint32, std::vector<char> > > m_read;   // empty data for failures
+  bool m_stopping;
+  std::thread m_reader;
+};
+
+} // end namespace OgreCollada
+
+#endif // OGRE_COLLADA_SCENEPAGER_H
@@ -0,0 +1,37 @@
+// OgreColladaUniqueIdHash.h, hashing of Collada unique IDs for use as unordered container keys
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef OGRE_COLLADA_UNIQUEIDHASH_H
+#define OGRE_COLLADA_UNIQUEIDHASH_H
+
+#include <cstddef>
+#include <functional>
+
+#include <COLLADAFWUniqueId.h>
+
+namespace std {
+
+// Object IDs are small and sequential within each class, and most files have only one file ID,
+// so all three parts get multiplied through to spread them over the whole word
+template<>
+struct hash<COLLADAFW::UniqueId> {
+  size_t operator()(const COLLADAFW::UniqueId& id) const {
+    unsigned long long h = (unsigned long long)id.getObjectId() * 0x9E3779B97F4A7C15ull;
+    h ^= ((unsigned long long)id.getClassId() + ((unsigned long long)id.getFileId() << 20)) * 0xC2B2AE3D27D4EB4Full;
+    return size_t(h ^ (h >> 29));
+  }
+};
+
+} // end namespace std
+
+#endif // OGRE_COLLADA_UNIQUEIDHASH_H
@@ -53,13 +53,13 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 typedef COLLADAFW::FileInfo FileInfo;
 typedef COLLADAFW::FileInfo::Unit Unit;
 
-// copied out of OgreCollada
-#define LOG_DEBUG(msg) { Ogre::LogManager::getSingleton().logMessage( Ogre::String((msg)) ); }
-
 OgreCollada::Writer::Writer(const Ogre::String& dir, const char* dotfn,
 				     bool checkNormals, bool calculateGeometryStats) :
   m_dir(dir), m_dotfn(dotfn),
-  m_checkNormals(checkNormals), m_calculateGeometryStats(calculateGeometryStats),
+  m_checkNormals(checkNormals), m_documentReleased(false), m_cancelled(false), m_splitLargeSubmeshes(false),
+  m_optimizeVertexCache(false), m_shareVertices(false), m_weldVertices(false),
+  m_lodLevels(0), m_lodReduction(0.5f), m_lodPixelsPerTriangle(32), m_deferResourceCreation(false),
+  m_calculateGeometryStats(calculateGeometryStats), m_profiler(0), m_accountMemory(false),
   m_transparencyWorkarounds(false) {
   // prepare to load textures from the specified directory
   if (boost::filesystem::exists(m_dir)) {
@@ -72,9 +72,40 @@ OgreCollada::Writer::Writer(const Ogre::String& dir, const char* dotfn,
 
 OgreCollada::WriterBase::~WriterBase() {}
 
-void OgreCollada::Writer::cancel(const COLLADAFW::String&) {}
+void OgreCollada::Writer::cancel(const COLLADAFW::String& errorMessage) {
+  // the loader has hit an error it can't recover from.  Refuse whatever it still hands us
+  LOG_DEBUG("COLLADA ERROR: loading cancelled: " + errorMessage);
+  m_cancelled = true;
+}
 
 void OgreCollada::Writer::start() {
+  m_documentReleased = false;
+  m_cancelled = false;
+}
+
+void OgreCollada::Writer::discardDocumentData() {
+  releaseDocument();
+  m_materials.clear();
+  m_effects.clear();
+  m_images.clear();
+  m_unculledEffects.clear();
+  m_meshMap.clear();
+  m_meshmatids.clear();
+  m_triangleOrders.clear();
+  m_geometryNames.clear();
+  m_geometryInstanceCounts.clear();
+  m_geometryTriangleCounts.clear();
+  m_geometryLineCounts.clear();
+  m_geometryCacheMisses.clear();
+  m_geometryCleanupCounts.clear();
+}
+
+void OgreCollada::Writer::releaseDocument() {
+  m_vsRootNodes.clear();
+  m_libNodes.clear();
+  m_filterMatchBelow.clear();
+  m_localTransforms.clear();
+  m_documentReleased = true;
 }
 
 // each type of color (ambient, specular, diffuse, etc.) gets handled very similarly
@@ -107,9 +138,19 @@ void OgreCollada::Writer::handleColorOrTexture(const COLLADAFW::EffectCommon& ce
 }
 
 void OgreCollada::Writer::createMaterials() {
+  OGRECOLLADA_PROFILE_SCOPE(m_profiler, "createMaterials");
   // At this point we have both the materials and their referenced effects.  Let's create them in Ogre so we can assign
-  // them to submeshes when we instantiate the scene graph
+  // them to submeshes when we instantiate the scene graph.
+  // Go in ID order so materials get created (and exported) in the same order every time
+  std::vector<MaterialMapIterator> materials;
+  materials.reserve(m_materials.size());
   for (MaterialMapIterator matit = m_materials.begin(); matit != m_materials.end(); ++matit) {
+    materials.push_back(matit);
+  }
+  std::sort(materials.begin(), materials.end(),
+	    [](const MaterialMapIterator& a, const MaterialMapIterator& b) { return a->first < b->first; });
+  for (size_t m = 0; m < materials.size(); ++m) {
+    MaterialMapIterator matit = materials[m];
     Ogre::String matname = matit->second.first;
     COLLADAFW::UniqueId effid = matit->second.second;
     EffectMapIterator effit = m_effects.find(effid);
@@ -194,6 +235,14 @@ void OgreCollada::Writer::createMaterials() {
 	  LOG_DEBUG("effect " + Ogre::StringConverter::toString(effid) + " has an opacity texture, which is presently unsupported");
 	}
       }
+      if (m_accountMemory) {
+	for (unsigned short p = 0; p < mat->getTechnique(0)->getNumPasses(); ++p) {
+	  Ogre::Pass* mpass = mat->getTechnique(0)->getPass(p);
+	  for (unsigned short t = 0; t < mpass->getNumTextureUnitStates(); ++t) {
+	    m_memoryAccount.addMaterialTexture(matname, mpass->getTextureUnitState(t)->getTextureName());
+	  }
+	}
+      }
       m_ogreMaterials.push_back(mat);
     }
   }
@@ -203,6 +252,12 @@ void OgreCollada::Writer::disableCulling(COLLADAFW::UniqueId const& uid) {
   m_unculledEffects.push_back(uid);
 }
 
+void OgreCollada::Writer::setCompactVertices(bool compact, bool quantizePositions) {
+  m_vertexFormat.packNormals = compact;
+  m_vertexFormat.packUVs = compact;
+  m_vertexFormat.quantizePositions = compact && quantizePositions;
+}
+
 bool OgreCollada::Writer::writeGlobalAsset(const FileInfo* fi) {
   enum FileInfo::UpAxisType up = fi->getUpAxisType();
   // set transform of entire imported scene to match Ogre (Y-up)
@@ -269,11 +324,65 @@ bool OgreCollada::Writer::addGeometry(const COLLADAFW::Geometry* g,       // inp
 				    Ogre::ManualObject* manobj,           // object under construction
 				    const Ogre::Matrix4& xform,           // transform within the object
 				    const COLLADAFW::MaterialBindingArray* mba) {
+  OGRECOLLADA_PROFILE_SCOPE(m_profiler, "addGeometry");
+  MeshData md;
+  if (!flattenGeometry(g, md, xform, mba)) {
+    return false;
+  }
+  unshareVertices(md);    // ManualObject sections can't share
+  if (m_accountMemory) {
+    // the ManualObject holds a copy of this until it is converted to a mesh
+    m_memoryAccount.stage(dataBytes(md));
+    accountBuffers(g->getOriginalId(), md, 0, 0, true);
+  }
+  addSubmeshes(md, manobj);
+  return true;
+}
+
+void OgreCollada::Writer::addSubmeshes(const MeshData& md, Ogre::ManualObject* manobj) {
+  for (size_t i = 0; i < md.submeshes.size(); ++i) {
+    const SubmeshData& smd = md.submeshes[i];
+    manobj->begin(smd.materialName, smd.opType);
+
+    // output vertex buffers
+    // this will only be the ones used by this submesh, because we accumulated the list of submesh vertices from
+    // the master list (mesh-global) list as we built the list of indices
+    const VertexArray& vertices = smd.vertices;
+    for (size_t v = 0, vcount = vertices.size(); v < vcount; ++v) {
+      const Ogre::Real* vval = vertices.vertex(v);
+      // position always
+      manobj->position(vval[0], vval[1], vval[2]);
+      if (vertices.hasNormals) {
+	const Ogre::Real* nval = vval + vertices.normalOffset();
+	manobj->normal(nval[0], nval[1], nval[2]);
+      }
+      if (vertices.hasUVs) {
+	const Ogre::Real* uvval = vval + vertices.uvOffset();
+	manobj->textureCoord(uvval[0], uvval[1]);
+      }
+    }
+
+    // now the indices
+    for (size_t j = 0, icount = smd.indices.size(); j < icount; ++j) {
+      manobj->index(smd.indices[j]);
+    }
+    manobj->end();
+  }
+}
+
+bool OgreCollada::Writer::flattenGeometry(const COLLADAFW::Geometry* g,       // input geometry from Collada
+					  MeshData& md,                       // resulting submeshes are appended here
+					  const Ogre::Matrix4& xform,         // transform within the object
+					  const COLLADAFW::MaterialBindingArray* mba) {
+  OGRECOLLADA_PROFILE_SCOPE_DETAIL(m_profiler, "flattenGeometry", g->getOriginalId());
 
   const COLLADAFW::Mesh* cmesh = dynamic_cast<const COLLADAFW::Mesh*>(g);
   Ogre::Matrix3 rotscale; xform.extract3x3Matrix(rotscale);   // normals don't get translation
 
-  int triangles = 0, lines = 0;   // for geometry stats
+  int triangles = 0, lines = 0;
+  // where this geometry's data starts, since we may be appending to earlier results
+  size_t firstSubmesh = md.submeshes.size();
+  size_t firstSharedVertex = md.sharedVertices.size();
 
   // iterate over mesh primitives and output
   const COLLADAFW::MeshVertexData& posvdata = cmesh->getPositions();
@@ -284,6 +393,41 @@ bool OgreCollada::Writer::addGeometry(const COLLADAFW::Geometry* g,       // inp
   if (cmesh->getMeshPrimitives().getCount() == 0) {
     LOG_DEBUG("Mesh primitive count for geometry " + boost::lexical_cast<Ogre::String>(g->getOriginalId()) + " is zero; I won't produce a valid mesh...");
   }
+
+  // The index tuples of all primitives reference the same Collada sources, so when the primitives
+  // agree on which attributes they have we can map tuples to a single vertex array for all of them
+  typedef std::map<std::vector<unsigned int>, Ogre::uint32> Collada2OgreIndexMap;
+  typedef Collada2OgreIndexMap::const_iterator Collada2OgreIndexMapIter;
+  Collada2OgreIndexMap sharedIdx;
+  bool share = m_shareVertices;
+  for (int i = 0, count = cmesh->getMeshPrimitives().getCount(); (i < count) && share; ++i) {
+    const COLLADAFW::MeshPrimitive& prim = *(cmesh->getMeshPrimitives()[i]);
+    if (md.sharedVertices.data.empty() && (i == 0)) {
+      md.sharedVertices.hasNormals = prim.hasNormalIndices();
+      md.sharedVertices.hasUVs = prim.hasUVCoordIndices();
+    }
+    share = (prim.hasNormalIndices() == md.sharedVertices.hasNormals) &&
+            (prim.hasUVCoordIndices() == md.sharedVertices.hasUVs);
+  }
+  if (m_shareVertices && !share) {
+    LOG_DEBUG("vertex attributes of geometry " + g->getOriginalId() + " differ among primitives; not sharing its vertices");
+  }
+
+  // resolve this instance's material bindings once, instead of searching them for every primitive.
+  // If a material ID is bound more than once, the last binding wins
+  std::unordered_map<COLLADAFW::MaterialId, const Ogre::String*> boundMaterials;
+  for (size_t j = 0; mba && (j < mba->getCount()); ++j) {
+    const COLLADAFW::MaterialBinding& mb = (*mba)[j];
+    MaterialMapIterator matit = m_materials.find(mb.getReferencedMaterial());
+    if (matit == m_materials.end()) {
+      LOG_DEBUG("COLLADA WARNING: geometry " + g->getOriginalId() + " refers to material " +
+		boost::lexical_cast<Ogre::String>(mb.getReferencedMaterial()) + " as material " +
+		boost::lexical_cast<Ogre::String>(mb.getMaterialId()) +
+		" but it cannot be found in the materials map");
+    } else {
+      boundMaterials[mb.getMaterialId()] = &matit->second.first;
+    }
+  }
   for (int i = 0, count = cmesh->getMeshPrimitives().getCount(); i < count; ++i) {
     const COLLADAFW::MeshPrimitive& prim = *(cmesh->getMeshPrimitives()[i]);
     if ((prim.getPrimitiveType() != COLLADAFW::MeshPrimitive::TRIANGLES) &&
@@ -315,26 +459,12 @@ bool OgreCollada::Writer::addGeometry(const COLLADAFW::Geometry* g,       // inp
 
     Ogre::String matname("BaseWhiteNoLighting");
     if (mba) {
-      // try to use the supplied material binding array to identify the material to apply to this submesh
-      COLLADAFW::MaterialId matid = prim.getMaterialId();
-      // find any matching entry in the binding array for this instance
-      bool found_mat_match = false;
-      for (size_t j = 0; j < mba->getCount(); ++j) {
-	const COLLADAFW::MaterialBinding mb = (*mba)[j];
-	if (mb.getMaterialId() == matid) {
-	  MaterialMapIterator matit = m_materials.find(mb.getReferencedMaterial());
-	  if (matit == m_materials.end()) {
-	    LOG_DEBUG("COLLADA WARNING: geometry " + g->getOriginalId() + " refers to material " +
-		      boost::lexical_cast<Ogre::String>(mb.getReferencedMaterial()) + " as material " +
-		      boost::lexical_cast<Ogre::String>(mb.getMaterialId()) +
-		      " but it cannot be found in the materials map");
-	  } else {
-	    found_mat_match = true;
-	    matname = matit->second.first;
-	  }
-	}
-      }
-      if (!found_mat_match) {
+      // use the supplied material binding array to identify the material to apply to this submesh
+      std::unordered_map<COLLADAFW::MaterialId, const Ogre::String*>::const_iterator bit =
+	boundMaterials.find(prim.getMaterialId());
+      if (bit != boundMaterials.end()) {
+	matname = *bit->second;
+      } else {
 	LOG_DEBUG("COLLADA WARNING: geometry  " + g->getOriginalId() + " refers to material Id " +
 		  boost::lexical_cast<Ogre::String>(prim.getMaterialId()) +
 		  " but it cannot be found in the supplied material bindings.  Using BaseWhiteNoLighting");
@@ -342,12 +472,16 @@ bool OgreCollada::Writer::addGeometry(const COLLADAFW::Geometry* g,       // inp
     }
 
 
+    md.submeshes.push_back(SubmeshData());
+    SubmeshData& smd = md.submeshes.back();
+    smd.materialId = prim.getMaterialId();
+    smd.materialName = matname;
     if ((prim.getPrimitiveType() == COLLADAFW::MeshPrimitive::TRIANGLES) ||
         (prim.getPrimitiveType() == COLLADAFW::MeshPrimitive::POLYLIST)) {
-      manobj->begin(matname, Ogre::RenderOperation::OT_TRIANGLE_LIST);
+      smd.opType = Ogre::RenderOperation::OT_TRIANGLE_LIST;
     }
     else {
-      manobj->begin(matname, Ogre::RenderOperation::OT_LINE_LIST);
+      smd.opType = Ogre::RenderOperation::OT_LINE_LIST;
     }
  
     // Reorder the vertex buffer for this submesh
@@ -361,9 +495,8 @@ bool OgreCollada::Writer::addGeometry(const COLLADAFW::Geometry* g,       // inp
     // though slow, is the safest and quickest way to get this going.
 
     std::vector<const COLLADAFW::UIntValuesArray*> collada_indices;
-    typedef std::map<std::vector<unsigned int>, Ogre::uint32> Collada2OgreIndexMap;
-    typedef Collada2OgreIndexMap::const_iterator Collada2OgreIndexMapIter;
-    Collada2OgreIndexMap collada2ogreidx;
+    Collada2OgreIndexMap localIdx;
+    Collada2OgreIndexMap& collada2ogreidx = share ? sharedIdx : localIdx;
 
     bool hasNormals = prim.hasNormalIndices();
     bool hasUVs = prim.hasUVCoordIndices();
@@ -389,8 +522,11 @@ bool OgreCollada::Writer::addGeometry(const COLLADAFW::Geometry* g,       // inp
     }
 
     // now build vertex data while creating new indices
-    std::vector<std::vector<Ogre::Real> > vertices;  // data for resulting vertex buffer
-    std::vector<Ogre::uint32> indices;               // resultant indices
+    smd.useSharedVertices = share;
+    VertexArray& vertices = share ? md.sharedVertices : smd.vertices;   // data for resulting vertex buffer
+    vertices.hasNormals = hasNormals;
+    vertices.hasUVs = hasUVs;
+    std::vector<Ogre::uint32>& indices = smd.indices; // resultant indices
     for (size_t ci = 0; ci < idxsize; ++ci) {           // loop over current (N-tuple) indices
       // construct map key
       std::vector<unsigned int> multi_idx_key;
@@ -406,7 +542,7 @@ bool OgreCollada::Writer::addGeometry(const COLLADAFW::Geometry* g,       // inp
 	collada2ogreidx.insert(std::make_pair(multi_idx_key, idx));
 
 	// assemble and add new vertex value
-	std::vector<Ogre::Real> vval;
+	std::vector<Ogre::Real>& vval = vertices.data;
 	// position (always).  Assuming 3 floats per usual
 	int voffset = 0;   // offset of data item within keys. moves as we go through data types
 	Ogre::Vector3 pos_xformed = xform * Ogre::Vector3(pvals[3*multi_idx_key[voffset]+0],
@@ -434,7 +570,6 @@ bool OgreCollada::Writer::addGeometry(const COLLADAFW::Geometry* g,       // inp
 	  vval.push_back(1.f - (*cmesh->getUVCoords().getFloatValues())[2*multi_idx_key[voffset]+1]);  // Y needs to be flipped for Ogre
 	  ++voffset;
 	}
-	vertices.push_back(vval);
       } else {
 	// we already have this one; just reference it
 	idx = it->second;
@@ -442,42 +577,22 @@ bool OgreCollada::Writer::addGeometry(const COLLADAFW::Geometry* g,       // inp
       indices.push_back(idx);
     }
 
-    // output vertex buffers
-    // this will only be the ones used by this submesh, because we accumulated the list of submesh vertices from
-    // the master list (mesh-global) list as we built the list of indices
-
-    for (int v = 0, vcount = vertices.size(); v < vcount; ++v) {
-      int voffset = 0;
-      // position always
-      manobj->position(vertices[v][voffset+0], vertices[v][voffset+1], vertices[v][voffset+2]);
-      voffset += 3;
-      if (hasNormals) {
-	manobj->normal(vertices[v][voffset+0], vertices[v][voffset+1], vertices[v][voffset+2]);
-	voffset += 3;
-      }
-      if (hasUVs) {
-	manobj->textureCoord(vertices[v][voffset+0], vertices[v][voffset+1]);
-	voffset += 2;
-      }
-    }
-
-    // now the indices
+    // check the winding order of the triangles against the supplied normals
     if (((prim.getPrimitiveType() == COLLADAFW::MeshPrimitive::TRIANGLES) ||
          (prim.getPrimitiveType() == COLLADAFW::MeshPrimitive::POLYLIST))
-         && hasNormals) {
-      // output indices with a possibility of correcting winding order
+         && hasNormals && m_checkNormals) {
       for (int tri = 0, tcount = indices.size() / 3; tri < tcount; ++tri) {
 	// get the three vertices defining this triangle
-	const std::vector<Ogre::Real>& v1 = vertices[indices[3*tri+0]];
-	const std::vector<Ogre::Real>& v2 = vertices[indices[3*tri+1]];
-	const std::vector<Ogre::Real>& v3 = vertices[indices[3*tri+2]];
+	const Ogre::Real* v1 = vertices.vertex(indices[3*tri+0]);
+	const Ogre::Real* v2 = vertices.vertex(indices[3*tri+1]);
+	const Ogre::Real* v3 = vertices.vertex(indices[3*tri+2]);
 	// extract the vertex normals
 	Ogre::Vector3 n1(v1[3], v1[4], v1[5]);    // normals always come right after positions
 	Ogre::Vector3 n2(v2[3], v2[4], v2[5]);
 	Ogre::Vector3 n3(v3[3], v3[4], v3[5]);
 
 	// check that the vertex normals are all the same (may not be required?)
-	if (m_checkNormals && ((n1 == n2) && (n2 == n3))) {
+	if ((n1 == n2) && (n2 == n3)) {
 	  // can only check these against the CCW winding normal if they are consistent
 	  // calculate the surface normal assuming CCW winding
 	  // following the description here: http://www.opengl.org/wiki/Calculating_a_Surface_Normal
@@ -498,15 +613,6 @@ bool OgreCollada::Writer::addGeometry(const COLLADAFW::Geometry* g,       // inp
 		      " points in the opposite direction of the Collada-supplied vertex normals " + Ogre::StringConverter::toString(n1));
 	  }
 	}
-	// output triangle vertex indices in the supplied order
-	manobj->index(indices[3*tri+0]);
-	manobj->index(indices[3*tri+1]);
-	manobj->index(indices[3*tri+2]);
-      }
-    } else {
-      // simply output the indices as we see them
-      for (int j = 0, icount = indices.size(); j < icount; ++j) {
-	manobj->index(indices[j]);
       }
     }
     if (m_calculateGeometryStats) {
@@ -519,7 +625,6 @@ bool OgreCollada::Writer::addGeometry(const COLLADAFW::Geometry* g,       // inp
 	lines += (indices.size() / 2);
       }
     }
-    manobj->end();
     valid_submesh = true;
   }
 
@@ -529,11 +634,193 @@ bool OgreCollada::Writer::addGeometry(const COLLADAFW::Geometry* g,       // inp
     m_geometryLineCounts[g->getUniqueId()] = lines;
   }
 
+  postProcessSubmeshes(g, md, firstSubmesh, firstSharedVertex);
+  if (valid_submesh && (md.submeshes.size() == firstSubmesh)) {
+    LOG_DEBUG("cleanup removed every primitive of geometry " + g->getOriginalId());
+    valid_submesh = false;
+  }
+
   if (!valid_submesh)
     LOG_DEBUG("not returning a valid submesh for geometry " + boost::lexical_cast<Ogre::String>(g->getOriginalId()));
   return valid_submesh;
 }
 
+// the optional processing steps for the submeshes flattenGeometry just produced
+void OgreCollada::Writer::postProcessSubmeshes(const COLLADAFW::Geometry* g, MeshData& md,
+					       size_t firstSubmesh, size_t firstSharedVertex) {
+  OGRECOLLADA_PROFILE_SCOPE(m_profiler, "postProcessSubmeshes");
+  if (m_weldVertices) {
+    // weld first, so triangles collapsed by welding get removed too
+    CleanupCounts cleanup;
+    std::vector<std::vector<Ogre::uint32>*> sharedIndices;
+    for (size_t i = firstSubmesh; i < md.submeshes.size(); ++i) {
+      SubmeshData& smd = md.submeshes[i];
+      if (smd.useSharedVertices) {
+	sharedIndices.push_back(&smd.indices);
+      } else {
+	cleanup.weldedVertices += weldVertices(smd.vertices, 0, std::vector<std::vector<Ogre::uint32>*>(1, &smd.indices),
+					       m_weldTolerance);
+      }
+    }
+    if (!sharedIndices.empty()) {
+      cleanup.weldedVertices += weldVertices(md.sharedVertices, firstSharedVertex, sharedIndices, m_weldTolerance);
+    }
+
+    for (size_t i = firstSubmesh; i < md.submeshes.size(); ++i) {
+      SubmeshData& smd = md.submeshes[i];
+      if (smd.opType != Ogre::RenderOperation::OT_TRIANGLE_LIST) {
+	continue;
+      }
+      const VertexArray& vertices = smd.useSharedVertices ? md.sharedVertices : smd.vertices;
+      cleanup.degenerateTriangles += removeDegenerateTriangles(smd.indices, vertices,
+							       m_weldTolerance.position * m_weldTolerance.position);
+      cleanup.duplicateTriangles += removeDuplicateTriangles(smd.indices);
+      if (!smd.useSharedVertices) {
+	// drop vertices only the removed triangles used
+	VertexArray all;
+	std::swap(all, smd.vertices);
+	extractVertices(all, smd);
+      }
+    }
+
+    // submeshes with nothing left to draw are not worth keeping
+    for (size_t i = md.submeshes.size(); i > firstSubmesh; --i) {
+      if (md.submeshes[i-1].indices.empty()) {
+	md.submeshes.erase(md.submeshes.begin() + (i-1));
+      }
+    }
+    // and shared vertices only the removed triangles used aren't either
+    removeUnusedSharedVertices(md, firstSharedVertex);
+
+    if (m_calculateGeometryStats) {
+      m_geometryCleanupCounts[g->getUniqueId()] = cleanup;
+    }
+  }
+
+  if (m_optimizeVertexCache) {
+    size_t missesBefore = 0, missesAfter = 0;
+    std::vector<TriangleOrder>& orders = m_triangleOrders[g->getUniqueId()];
+    orders.resize(md.submeshes.size() - firstSubmesh);
+    for (size_t i = firstSubmesh; i < md.submeshes.size(); ++i) {
+      SubmeshData& smd = md.submeshes[i];
+      if (smd.opType != Ogre::RenderOperation::OT_TRIANGLE_LIST) {
+	continue;
+      }
+      size_t vcount = smd.useSharedVertices ? md.sharedVertices.size() : smd.vertices.size();
+      if (m_calculateGeometryStats) {
+	missesBefore += countCacheMisses(smd.indices, vcount);
+      }
+      // FNV-1a over the indices, relative to where this geometry's vertices start
+      Ogre::uint32 base = smd.useSharedVertices ? firstSharedVertex : 0;
+      Ogre::uint64 hash = 14695981039346656037ULL;
+      for (size_t j = 0; j < smd.indices.size(); ++j) {
+	hash = (hash ^ (smd.indices[j] - base)) * 1099511628211ULL;
+      }
+      TriangleOrder& cached = orders[i - firstSubmesh];
+      if ((cached.order.size() * 3 != smd.indices.size()) || (cached.indexHash != hash)) {
+	vertexCacheOrder(smd.indices, vcount, cached.order);
+	cached.indexHash = hash;
+      }
+      reorderTriangles(smd.indices, cached.order);
+      if (!smd.useSharedVertices) {
+	optimizeVertexFetch(smd);       // shared vertex order has to suit every submesh, so leave it alone
+      }
+      if (m_calculateGeometryStats) {
+	missesAfter += countCacheMisses(smd.indices, vcount);
+      }
+    }
+    if (m_calculateGeometryStats) {
+      m_geometryCacheMisses[g->getUniqueId()] = std::make_pair(missesBefore, missesAfter);
+    }
+  }
+
+#ifdef OGRECOLLADA_PROFILING
+  // what we finally produce: welding may have removed some primitives, and splitting won't change the count
+  if (m_profiler) {
+    size_t triangles = 0, lines = 0;
+    for (size_t i = firstSubmesh; i < md.submeshes.size(); ++i) {
+      const SubmeshData& smd = md.submeshes[i];
+      if (smd.opType == Ogre::RenderOperation::OT_LINE_LIST) {
+	lines += smd.indices.size() / 2;
+      } else {
+	triangles += smd.indices.size() / 3;
+      }
+    }
+    m_profiler->count("triangles emitted", triangles);
+    m_profiler->count("lines emitted", lines);
+  }
+#endif
+
+  if (m_splitLargeSubmeshes) {
+    if (md.sharedVertices.size() > MAX_16BIT_VERTICES) {
+      // too many to share with 16-bit indices; fall back to per-submesh vertices, split below
+      LOG_DEBUG("shared vertices exceed the 16-bit index limit at geometry " + g->getOriginalId() + "; unsharing");
+      unshareVertices(md);
+      firstSubmesh = 0;
+    }
+    std::vector<SubmeshData> submeshes(std::make_move_iterator(md.submeshes.begin() + firstSubmesh),
+				       std::make_move_iterator(md.submeshes.end()));
+    md.submeshes.resize(firstSubmesh);
+    for (size_t i = 0; i < submeshes.size(); ++i) {
+      if (submeshes[i].vertices.size() > MAX_16BIT_VERTICES) {
+	LOG_DEBUG("splitting submesh of " + Ogre::StringConverter::toString(submeshes[i].vertices.size()) +
+		  " vertices in geometry " + g->getOriginalId() + " to allow 16-bit indices");
+	splitSubmesh(submeshes[i], MAX_16BIT_VERTICES, md.submeshes);
+      } else {
+	md.submeshes.push_back(std::move(submeshes[i]));
+      }
+    }
+  }
+}
+
+void OgreCollada::Writer::accountBuffers(const Ogre::String& geometry, const MeshData& md,
+					 size_t firstSubmesh, size_t firstSharedVertex, bool byMaterial) {
+  std::vector<BufferSize> sizes;
+  bufferSizes(md, bufferFormat(), firstSubmesh, firstSharedVertex, sizes);
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    m_memoryAccount.addGeometryBuffers(geometry, sizes[i].vertexBytes, sizes[i].indexBytes);
+    if (byMaterial) {
+      m_memoryAccount.addMaterialBuffers(md.submeshes[firstSubmesh + i].materialName,
+					 sizes[i].vertexBytes, sizes[i].indexBytes);
+    }
+  }
+}
+
+void OgreCollada::Writer::logGeometryStats() {
+  std::vector<COLLADAFW::UniqueId> geometries;
+  // BOZO should use some type of function object magic here instead
+  for (std::unordered_map<COLLADAFW::UniqueId, int>::const_iterator icit = m_geometryInstanceCounts.begin();
+       icit != m_geometryInstanceCounts.end(); ++icit) {
+    geometries.push_back(icit->first);
+  }
+  std::sort(geometries.begin(), geometries.end(),
+	    TriangleCountComparator(m_geometryInstanceCounts, m_geometryTriangleCounts));
+
+  LOG_DEBUG(Ogre::String("loaded geometry data as follows (name, triangles, lines, instances") +
+	    (m_weldVertices ? ", welded vertices, degenerate and duplicate triangles removed" : "") +
+	    (m_optimizeVertexCache ? ", ACMR before and after optimization" : "") + "):");
+  for (std::vector<COLLADAFW::UniqueId>::const_iterator git = geometries.begin();
+       git != geometries.end(); ++git) {
+    Ogre::String line = m_geometryNames[*git] +
+      "\t" + Ogre::StringConverter::toString(m_geometryTriangleCounts[*git]) +
+      "\t" + Ogre::StringConverter::toString(m_geometryLineCounts[*git]) +
+      "\t" + Ogre::StringConverter::toString(m_geometryInstanceCounts[*git]);
+    if (m_weldVertices) {
+      const CleanupCounts& cleanup = m_geometryCleanupCounts[*git];
+      line += "\t" + Ogre::StringConverter::toString(cleanup.weldedVertices) +
+	"\t" + Ogre::StringConverter::toString(cleanup.degenerateTriangles) +
+	"\t" + Ogre::StringConverter::toString(cleanup.duplicateTriangles);
+    }
+    int triangles = m_geometryTriangleCounts[*git];
+    if (m_optimizeVertexCache && (triangles > 0)) {
+      const std::pair<size_t, size_t>& misses = m_geometryCacheMisses[*git];
+      line += "\t" + Ogre::StringConverter::toString(Ogre::Real(misses.first) / triangles) +
+	"\t" + Ogre::StringConverter::toString(Ogre::Real(misses.second) / triangles);
+    }
+    LOG_DEBUG(line);
+  }
+}
+
 bool OgreCollada::Writer::writeMaterial(const COLLADAFW::Material* m) {
 
   m_materials.insert(std::make_pair(m->getUniqueId(), std::make_pair(m->getName(), m->getInstantiatedEffect())));
@@ -554,7 +841,28 @@ bool OgreCollada::Writer::writeEffect(const COLLADAFW::Effect* e) {
 bool OgreCollada::Writer::writeCamera(const COLLADAFW::Camera*) {
   return true;
 }
+void OgreCollada::Writer::loadImage(const COLLADAFW::UniqueId& id, const Ogre::String& path) {
+  OGRECOLLADA_PROFILE_SCOPE_DETAIL(m_profiler, "loadImage", path);
+  Ogre::TexturePtr texture = Ogre::TextureManager::getSingleton().load(path, "General");
+  if (texture.isNull()) {
+    LOG_DEBUG("COLLADA WARNING: Failed to load texture from file " + path);
+  } else {
+    m_images.insert(std::make_pair(id, texture->getName()));
+    if (m_accountMemory) {
+      m_memoryAccount.addTexture(texture->getName(), texture->getSize());
+    }
+  }
+}
+
+void OgreCollada::Writer::loadDeferredImages() {
+  for (size_t i = 0; i < m_deferredImages.size(); ++i) {
+    loadImage(m_deferredImages[i].first, m_deferredImages[i].second);
+  }
+  m_deferredImages.clear();
+}
+
 bool OgreCollada::Writer::writeImage(const COLLADAFW::Image* i) {
+  OGRECOLLADA_PROFILE_SCOPE_DETAIL(m_profiler, "writeImage", i->getOriginalId());
   // these are basically texture jpegs... they contain a file path
   if (i->getSourceType() == COLLADAFW::Image::SOURCE_TYPE_URI) {
     Ogre::String image_rel_path = COLLADABU::URI::uriDecode(i->getImageURI().getURIString());
@@ -562,11 +870,10 @@ bool OgreCollada::Writer::writeImage(const COLLADAFW::Image* i) {
     // this is the only type we currently support
     // Ogre wants to load base name files (without paths) from directories that have already been registered.
     // We normally see our textures in subdirectories.  Trim off the path
-    Ogre::TexturePtr texture = Ogre::TextureManager::getSingleton().load(image_rel_path, "General");
-    if (texture.isNull()) {
-      LOG_DEBUG("COLLADA WARNING: Failed to load texture from file " + image_rel_path);
+    if (m_deferResourceCreation) {
+      m_deferredImages.push_back(std::make_pair(i->getUniqueId(), image_rel_path));
     } else {
-      m_images.insert(std::make_pair(i->getUniqueId(), texture->getName()));
+      loadImage(i->getUniqueId(), image_rel_path);
     }
   } else {
     LOG_DEBUG("OgreCollada::Writer::writeImage called on OID " + i->getOriginalId() + " uniqueid " + Ogre::StringConverter::toString(i->getUniqueId()) + " name " + i->getName() + " source type ");
@@ -689,11 +996,11 @@ void OgreCollada::Writer::node_dfs_geocheck(const COLLADAFW::Node* n) {
   for (int i = 0, count = gnodes.getCount(); i < count; ++i) {
     const COLLADAFW::InstanceGeometry* gn = gnodes[i];
     // look this thing up in our geometry uniqueid to mesh ptr map
-    std::map<COLLADAFW::UniqueId, Ogre::MeshPtr>::iterator it = m_meshMap.find(gn->getInstanciatedObjectId());
+    std::unordered_map<COLLADAFW::UniqueId, Ogre::MeshPtr>::iterator it = m_meshMap.find(gn->getInstanciatedObjectId());
     if (it == m_meshMap.end()) {
       // even if we don't have a mesh constructed (or loaded) for this, we should still have recorded its geometry
       // when it originally appeared in the input.  Use this information to make a nicer error message
-      std::map<COLLADAFW::UniqueId, Ogre::String>::const_iterator git = m_geometryNames.find(gn->getInstanciatedObjectId());
+      std::unordered_map<COLLADAFW::UniqueId, Ogre::String>::const_iterator git = m_geometryNames.find(gn->getInstanciatedObjectId());
       if (git != m_geometryNames.end()) {
 	LOG_DEBUG("geometry check: could not find geometry " + git->second + ", a child of OID " + n->getOriginalId() + " name " + n->getName() + " in our geometry map");
       } else {
@@ -793,3 +1100,128 @@ OgreCollada::Writer::computeTransformation(const COLLADAFW::Transformation* tran
   }
 }
 
+const OgreCollada::Writer::LocalTransform&
+OgreCollada::Writer::localTransform(const COLLADAFW::Node* n) {
+  std::unordered_map<COLLADAFW::UniqueId, LocalTransform>::iterator it = m_localTransforms.find(n->getUniqueId());
+  if (it != m_localTransforms.end()) {
+    return it->second;
+  }
+
+  LocalTransform& lt = m_localTransforms[n->getUniqueId()];
+  const COLLADAFW::TransformationPointerArray& tarr = n->getTransformations();
+  lt.identity = (tarr.getCount() == 0);
+  // COLLADA spec says multiple transformations are "postmultiplied in the order in which
+  // they are specified", which I think means like this:
+  lt.matrix = Ogre::Matrix4::IDENTITY;
+  for (size_t i = 0; i < tarr.getCount(); ++i) {
+    lt.matrix = lt.matrix * computeTransformation(tarr[i]);
+  }
+  // have to split this up into components b/c Ogre::SceneNode has no direct way to set 4x4 transform
+  lt.matrix.decomposition(lt.position, lt.scale, lt.orientation);
+  return lt;
+}
+
+
+bool OgreCollada::Writer::nodeMatchesFilter(const COLLADAFW::Node* n) const {
+  const std::vector<Ogre::String>& patterns = m_importFilter.nodeNames;
+  for (size_t i = 0; i < patterns.size(); ++i) {
+    if (Ogre::StringUtil::match(n->getName(), patterns[i]) || Ogre::StringUtil::match(n->getOriginalId(), patterns[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool OgreCollada::Writer::libraryMatchesFilter(const COLLADAFW::Node* lib) const {
+  const std::vector<Ogre::String>& patterns = m_importFilter.libNodeTypes;
+  for (size_t i = 0; i < patterns.size(); ++i) {
+    if (Ogre::StringUtil::match(lib->getName(), patterns[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool OgreCollada::Writer::enterFilteredNode(const COLLADAFW::Node* n, bool parentSelected) const {
+  if (parentSelected || !filteringByName()) {
+    return true;
+  }
+  std::unordered_map<const COLLADAFW::Node*, bool>::const_iterator it = m_filterMatchBelow.find(n);
+  return (it != m_filterMatchBelow.end()) && it->second;
+}
+
+bool OgreCollada::Writer::enterFilteredLibrary(const COLLADAFW::Node* lib, bool parentSelected) const {
+  return libraryMatchesFilter(lib) || enterFilteredNode(lib, parentSelected);
+}
+
+void OgreCollada::Writer::findFilterMatches() {
+  m_filterMatchBelow.clear();
+  if (!filteringByName()) {
+    return;
+  }
+  // A post-order pass, visiting each library node once however often it is instantiated.
+  // A node seen again while in progress is part of an instance cycle and counts as no match
+  std::vector<std::pair<const COLLADAFW::Node*, bool> > stack;   // (node, children done)
+  for (size_t i = 0; i < m_vsRootNodes.size(); ++i) {
+    stack.push_back(std::make_pair(m_vsRootNodes[i], false));
+  }
+  while (!stack.empty()) {
+    const COLLADAFW::Node* n = stack.back().first;
+    bool childrenDone = stack.back().second;
+    stack.pop_back();
+
+    const COLLADAFW::NodePointerArray& cnodes = n->getChildNodes();
+    const COLLADAFW::InstanceNodePointerArray& inodes = n->getInstanceNodes();
+    if (!childrenDone) {
+      if (!m_filterMatchBelow.insert(std::make_pair(n, false)).second) {
+	continue;     // done already, or in progress
+      }
+      stack.push_back(std::make_pair(n, true));
+      for (int i = 0, count = cnodes.getCount(); i < count; ++i) {
+	stack.push_back(std::make_pair(cnodes[i], false));
+      }
+      for (int i = 0, count = inodes.getCount(); i < count; ++i) {
+	LibNodesIterator lit = m_libNodes.find(inodes[i]->getInstanciatedObjectId());
+	if (lit != m_libNodes.end()) {
+	  stack.push_back(std::make_pair(lit->second, false));
+	}
+      }
+      continue;
+    }
+
+    bool match = nodeMatchesFilter(n);
+    for (int i = 0, count = cnodes.getCount(); (i < count) && !match; ++i) {
+      match = m_filterMatchBelow[cnodes[i]];
+    }
+    for (int i = 0, count = inodes.getCount(); (i < count) && !match; ++i) {
+      LibNodesIterator lit = m_libNodes.find(inodes[i]->getInstanciatedObjectId());
+      match = (lit != m_libNodes.end()) && (libraryMatchesFilter(lit->second) || m_filterMatchBelow[lit->second]);
+    }
+    m_filterMatchBelow[n] = match;
+  }
+}
+
+Ogre::AxisAlignedBox OgreCollada::Writer::geometryBounds(const COLLADAFW::Geometry* g) {
+  Ogre::AxisAlignedBox box;
+  const COLLADAFW::Mesh* cmesh = dynamic_cast<const COLLADAFW::Mesh*>(g);
+  const COLLADAFW::FloatArray* pvals = cmesh ? cmesh->getPositions().getFloatValues() : 0;
+  if (!pvals) {
+    return box;
+  }
+  for (size_t i = 0; i + 2 < pvals->getCount(); i += 3) {
+    box.merge(Ogre::Vector3((*pvals)[i], (*pvals)[i+1], (*pvals)[i+2]));
+  }
+  return box;
+}
+
+bool OgreCollada::Writer::meetsFilterRegion(Ogre::AxisAlignedBox bounds, const Ogre::Matrix4& xform) const {
+  if (!filteringByRegion()) {
+    return true;
+  }
+  if (xform.isAffine()) {
+    bounds.transformAffine(xform);
+  } else {
+    bounds.transform(xform);
+  }
+  return bounds.intersects(m_importFilter.region);
+}
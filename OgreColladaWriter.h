@@ -20,12 +20,22 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 #include <OgreVector3.h>
 #include <OgreMatrix4.h>
 #include <OgreCommon.h>
+#include <OgreAxisAlignedBox.h>
 
 #include <COLLADAFWIWriter.h>
 #include <COLLADAFWMaterialBinding.h>
 #include <COLLADAFWTransformation.h>
 
+#include <unordered_map>
+
 #include "OgreColladaWriterBase.h"
+#include "OgreColladaUniqueIdHash.h"
+#include "OgreColladaMeshData.h"
+#include "OgreColladaMeshOptimizer.h"
+#include "OgreColladaMeshSimplifier.h"
+#include "OgreColladaProfiler.h"
+#include "OgreColladaMemoryAccount.h"
+#include "OgreColladaLog.h"
 
 namespace COLLADAFW {
    class Node;
@@ -33,8 +43,6 @@ namespace COLLADAFW {
    class ColorOrTexture;
 }
 
-#define LOG_DEBUG(msg) { Ogre::LogManager::getSingleton().logMessage( Ogre::String((msg)) ); }
-
 namespace OgreCollada {
 
 // This class contains implementations shared by Scene (online) and Mesh writers
@@ -59,8 +67,76 @@ class Writer : public WriterBase {
 
   void setGraphOutput(const char* filename) { m_dotfn = filename; }
 
+  // store vertex attributes in packed form (normals and texture coordinates as normalized shorts)
+  // and optionally quantize positions.  Meshes are then built directly instead of via ManualObject
+  void setCompactVertices(bool compact, bool quantizePositions = false);
+
+  // break up submeshes with too many vertices for 16-bit indices, instead of using 32-bit indices
+  void setSplitLargeSubmeshes(bool split) { m_splitLargeSubmeshes = split; }
+
+  // reorder triangles and vertices of each submesh for better post-transform cache and fetch behavior
+  void setOptimizeVertexCache(bool optimize) { m_optimizeVertexCache = optimize; }
+
+  // let all the primitives of a geometry share one vertex buffer, instead of one buffer per primitive.
+  // Meshes are then built directly instead of via ManualObject
+  void setShareVertices(bool share) { m_shareVertices = share; }
+
+  // merge vertices that match within a tolerance, and drop degenerate and duplicate triangles
+  void setWeldVertices(bool weld, const WeldTolerance& tol = WeldTolerance()) {
+    m_weldVertices = weld;
+    m_weldTolerance = tol;
+  }
+
+  // generate simplified levels of detail for each mesh, each with "reduction" times the triangles of
+  // the previous one, used once the mesh covers fewer than pixelsPerTriangle pixels per triangle
+  void setGenerateLods(unsigned levels, Ogre::Real reduction = 0.5f, Ogre::Real pixelsPerTriangle = 32) {
+    m_lodLevels = levels;
+    m_lodReduction = reduction;
+    m_lodPixelsPerTriangle = pixelsPerTriangle;
+  }
+
+  // Import only part of the scene: the subtrees under nodes whose names (or IDs) match one of nodeNames
+  // and under instances of the library nodes (the "LibNodeType") matching one of libNodeTypes, or
+  // everything if both are empty.  Patterns may use "*" as a wildcard.  Geometry instances are further
+  // limited to those whose bounds meet the region.  It is given in the converted coordinates of the
+  // import (Y up, in meters), relative to the mesh a MeshWriter builds, or to the top node of a
+  // SceneWriter's scene wherever that node is placed.  The rest of the scene is skipped as it is traversed
+  struct ImportFilter {
+    ImportFilter() : region(Ogre::AxisAlignedBox::EXTENT_INFINITE) {}
+
+    std::vector<Ogre::String> nodeNames;
+    std::vector<Ogre::String> libNodeTypes;
+    Ogre::AxisAlignedBox region;
+  };
+  void setImportFilter(const ImportFilter& filter) { m_importFilter = filter; }
+
+  // log per-geometry triangle/line/instance counts (and cache efficiency, if optimizing) when done
+  void setCalculateGeometryStats(bool calc) { m_calculateGeometryStats = calc; }
+
+  // time the phases of import (per geometry, where there is one) and count what they produce.
+  // Only has an effect if the library was built with OGRECOLLADA_PROFILING; the caller owns the profiler
+  void setProfiler(Profiler* profiler) { m_profiler = profiler; }
+  Profiler* getProfiler() const { return m_profiler; }
+
+  // keep a tally of the memory taken by vertex and index buffers, textures, and intermediate data,
+  // by geometry, material and texture
+  void setMemoryAccounting(bool account) { m_accountMemory = account; }
+  const MemoryAccount& getMemoryAccount() const { return m_memoryAccount; }
+
   std::vector<Ogre::MaterialPtr> const& getMaterials() const { return m_ogreMaterials; }
 
+  // The writer keeps pointers to the scene and library nodes (and the material bindings in them) instead of
+  // copying them, so they are only valid while the loader that built them exists.  Call this before destroying
+  // the loader if the writer will still be used - to step() an incremental scene, say.  SaxLoader does so for
+  // the Writer it loaded into.  Work that still needed the nodes is abandoned, and the writer keeps only what
+  // it has already converted
+  virtual void releaseDocument();
+  bool isDocumentReleased() const { return m_documentReleased; }
+
+  // whether the loader gave up on the document (see cancel()).  The writer then converts no more geometry,
+  // and finish() builds nothing
+  bool isCancelled() const { return m_cancelled; }
+
   // a separate method to disable culling for materials marked "double sided"
   // this is out-of-band information supplied by some converters and not an official
   // part of the standard, so it takes this route
@@ -78,6 +154,8 @@ class Writer : public WriterBase {
 
   // starting points for final processing
   std::vector<const COLLADAFW::Node*> m_vsRootNodes;                 // top-level nodes
+  bool m_documentReleased;                   // the nodes above (and m_libNodes) are gone; see releaseDocument()
+  bool m_cancelled;                          // by the loader, until the next start()
   Ogre::Quaternion m_ColladaRotation;        // how to rotate Collada input to match Ogre's Y-up coordinates
   Ogre::Vector3 m_ColladaScale;              // how to scale Collada input into meters
   
@@ -87,28 +165,122 @@ class Writer : public WriterBase {
 		   const Ogre::Matrix4& xform = Ogre::Matrix4::IDENTITY, // transform to this point
 		   const COLLADAFW::MaterialBindingArray* mba = 0);      // materials to attach
 
+  // the two halves of addGeometry: convert Collada primitives into vertex and index data,
+  // then output that data as ManualObject sections
+  bool flattenGeometry(const COLLADAFW::Geometry* g,
+		       MeshData& md,
+		       const Ogre::Matrix4& xform = Ogre::Matrix4::IDENTITY,
+		       const COLLADAFW::MaterialBindingArray* mba = 0);
+  void addSubmeshes(const MeshData& md, Ogre::ManualObject* manobj);
+  // cleanup, optimization, and splitting, as enabled, of the submeshes starting at firstSubmesh
+  void postProcessSubmeshes(const COLLADAFW::Geometry* g, MeshData& md,
+			    size_t firstSubmesh, size_t firstSharedVertex);
+
+  VertexFormat m_vertexFormat;   // layout for meshes we build directly
+  bool m_splitLargeSubmeshes;    // keep submeshes 16-bit addressable
+  bool m_optimizeVertexCache;    // run the vertex cache/fetch optimizer on flattened submeshes
+  // The triangle order the optimizer chose for each submesh of a geometry, with a hash of the (relative)
+  // indices it was computed from.  Instances of a geometry usually flatten to the same indices, so they
+  // can reuse it instead of optimizing again.  Entries stay until removed with forgetTriangleOrder
+  struct TriangleOrder {
+    TriangleOrder() : indexHash(0) {}
+    Ogre::uint64 indexHash;
+    std::vector<Ogre::uint32> order;
+  };
+  std::unordered_map<COLLADAFW::UniqueId, std::vector<TriangleOrder> > m_triangleOrders;
+  void forgetTriangleOrder(const COLLADAFW::UniqueId& geometry) { m_triangleOrders.erase(geometry); }
+  bool m_shareVertices;          // pool vertices among the primitives of each geometry
+  bool m_weldVertices;           // clean up vertices and triangles of flattened submeshes
+  WeldTolerance m_weldTolerance;
+  unsigned m_lodLevels;          // how many reduced levels of detail to generate per mesh
+  Ogre::Real m_lodReduction;
+  Ogre::Real m_lodPixelsPerTriangle;
+  // Defer creation of Ogre resources (textures, for this class) so loading can happen off the render thread
+  bool m_deferResourceCreation;
+  std::vector<std::pair<COLLADAFW::UniqueId, Ogre::String> > m_deferredImages;   // (image, path)
+  void loadImage(const COLLADAFW::UniqueId&, const Ogre::String& path);
+  void loadDeferredImages();
+  // whether the options in effect require building meshes ourselves instead of with ManualObject
+  bool buildMeshesDirectly() const { return m_vertexFormat.isCompact() || m_shareVertices || (m_lodLevels > 0); }
+
   void createMaterials();
   static Ogre::Matrix4 computeTransformation(const COLLADAFW::Transformation*);
+  // forget everything recorded from the document (materials, effects, images, geometries, and nodes),
+  // as after a failed or cancelled load.  Ogre resources already created are left alone
+  void discardDocumentData();
+
+  // The composed transformations of a node.  Library nodes may be instantiated many times, so these
+  // are computed on first use and cached by node ID
+  struct LocalTransform {
+    bool identity;                     // node has no transformations
+    Ogre::Matrix4 matrix;
+    Ogre::Vector3 position, scale;     // decomposed, for SceneNodes
+    Ogre::Quaternion orientation;
+  };
+  const LocalTransform& localTransform(const COLLADAFW::Node*);
+  std::unordered_map<COLLADAFW::UniqueId, LocalTransform> m_localTransforms;
+
+  // Applying the import filter during traversal.  A node is "selected" if it or an ancestor matched the
+  // name patterns, or it lies within a matching library instance; only selected nodes produce geometry.
+  // Unselected subtrees are entered only if they contain a match, as recorded by findFilterMatches()
+  ImportFilter m_importFilter;
+  bool filteringByName() const { return !m_importFilter.nodeNames.empty() || !m_importFilter.libNodeTypes.empty(); }
+  bool filteringByRegion() const { return !m_importFilter.region.isInfinite(); }
+  bool nodeMatchesFilter(const COLLADAFW::Node*) const;
+  bool libraryMatchesFilter(const COLLADAFW::Node*) const;
+  bool nodeSelected(const COLLADAFW::Node* n, bool parentSelected) const {
+    return parentSelected || !filteringByName() || nodeMatchesFilter(n);
+  }
+  // whether a subtree should be entered, given whether its parent is selected
+  bool enterFilteredNode(const COLLADAFW::Node*, bool parentSelected) const;
+  bool enterFilteredLibrary(const COLLADAFW::Node*, bool parentSelected) const;
+  void findFilterMatches();                                          // call once the scene is known
+  std::unordered_map<const COLLADAFW::Node*, bool> m_filterMatchBelow;  // subtree contains a match
+  // bounds of a Collada mesh's positions, untransformed
+  static Ogre::AxisAlignedBox geometryBounds(const COLLADAFW::Geometry*);
+  bool meetsFilterRegion(Ogre::AxisAlignedBox bounds, const Ogre::Matrix4&) const;
 
   // stats
   bool m_calculateGeometryStats; // whether to calculate and log statistics on geometries (meshes) and their usages
-  std::map<COLLADAFW::UniqueId, Ogre::String> m_geometryNames; // geometries in input
-  std::map<COLLADAFW::UniqueId, int> m_geometryInstanceCounts; // how often it gets used
-  std::map<COLLADAFW::UniqueId, int> m_geometryTriangleCounts; // how many triangles it contains
-  std::map<COLLADAFW::UniqueId, int> m_geometryLineCounts;     // how many lines it contains
+  std::unordered_map<COLLADAFW::UniqueId, Ogre::String> m_geometryNames; // geometries in input
+  std::unordered_map<COLLADAFW::UniqueId, int> m_geometryInstanceCounts; // how often it gets used
+  std::unordered_map<COLLADAFW::UniqueId, int> m_geometryTriangleCounts; // how many triangles it contains
+  std::unordered_map<COLLADAFW::UniqueId, int> m_geometryLineCounts;     // how many lines it contains
+  // vertex cache misses (simulated) before and after optimization, for computing ACMR
+  std::unordered_map<COLLADAFW::UniqueId, std::pair<size_t, size_t> > m_geometryCacheMisses;
+  // what vertex welding removed
+  struct CleanupCounts {
+    CleanupCounts() : weldedVertices(0), degenerateTriangles(0), duplicateTriangles(0) {}
+    size_t weldedVertices, degenerateTriangles, duplicateTriangles;
+  };
+  std::unordered_map<COLLADAFW::UniqueId, CleanupCounts> m_geometryCleanupCounts;
+  void logGeometryStats();
+  Profiler* m_profiler;
+
+  // memory accounting
+  bool m_accountMemory;
+  MemoryAccount m_memoryAccount;
+  // the layout vertex buffers will really have
+  virtual VertexFormat bufferFormat() const { return buildMeshesDirectly() ? m_vertexFormat : VertexFormat(); }
+  // charge the buffers for md's submeshes from firstSubmesh on, and its shared vertices from firstSharedVertex on,
+  // to a geometry and (if byMaterial) to the submeshes' materials
+  void accountBuffers(const Ogre::String& geometry, const MeshData& md,
+		      size_t firstSubmesh, size_t firstSharedVertex, bool byMaterial);
 
   // internal class to do sorting of triangle counts
   class TriangleCountComparator {
   public:
-  TriangleCountComparator(const std::map<COLLADAFW::UniqueId, int>& instCount,
-			  const std::map<COLLADAFW::UniqueId, int>& triCount) : m_icount(instCount), m_tcount(triCount) {}
+  TriangleCountComparator(const std::unordered_map<COLLADAFW::UniqueId, int>& instCount,
+			  const std::unordered_map<COLLADAFW::UniqueId, int>& triCount) : m_icount(instCount), m_tcount(triCount) {}
     bool operator() (const COLLADAFW::UniqueId& a,
 		     const COLLADAFW::UniqueId& b) {
-      // biggest first
-      return m_icount.find(a)->second * m_tcount.find(a)->second > m_icount.find(b)->second * m_tcount.find(b)->second;
+      // biggest first, and in ID order among equals so the log is the same every time
+      int atotal = m_icount.find(a)->second * m_tcount.find(a)->second;
+      int btotal = m_icount.find(b)->second * m_tcount.find(b)->second;
+      return (atotal > btotal) || ((atotal == btotal) && (a < b));
     }
   private:
-    const std::map<COLLADAFW::UniqueId, int> &m_icount, &m_tcount;
+    const std::unordered_map<COLLADAFW::UniqueId, int> &m_icount, &m_tcount;
 
   };
 
@@ -119,24 +291,24 @@ class Writer : public WriterBase {
   MeshMaterialIdMap m_meshmatids;
 
   // library geometries
-  std::map<COLLADAFW::UniqueId, Ogre::MeshPtr> m_meshMap;  // loaded or generated meshes here
+  std::unordered_map<COLLADAFW::UniqueId, Ogre::MeshPtr> m_meshMap;  // loaded or generated meshes here
 
  protected:
   // data storage - stuff collected during callbacks from Collada
-  typedef std::map<COLLADAFW::UniqueId, const COLLADAFW::Node*> LibNodesContainer;
+  typedef std::unordered_map<COLLADAFW::UniqueId, const COLLADAFW::Node*> LibNodesContainer;
   typedef LibNodesContainer::const_iterator LibNodesIterator;
   LibNodesContainer m_libNodes; // tree roots for library nodes
 
   // names and effect IDs for each material, searchable by material ID (referenced by geometry instances)
-  typedef std::map<COLLADAFW::UniqueId, std::pair<Ogre::String, COLLADAFW::UniqueId> > MaterialMap;
+  typedef std::unordered_map<COLLADAFW::UniqueId, std::pair<Ogre::String, COLLADAFW::UniqueId> > MaterialMap;
   typedef MaterialMap::const_iterator MaterialMapIterator;
   MaterialMap m_materials;
 
-  typedef std::map<COLLADAFW::UniqueId, std::vector<COLLADAFW::EffectCommon> > EffectMap;
+  typedef std::unordered_map<COLLADAFW::UniqueId, std::vector<COLLADAFW::EffectCommon> > EffectMap;
   typedef EffectMap::const_iterator EffectMapIterator;
   EffectMap m_effects;
   
-  typedef std::map<COLLADAFW::UniqueId, Ogre::String> ImageMap;
+  typedef std::unordered_map<COLLADAFW::UniqueId, Ogre::String> ImageMap;
   typedef ImageMap::const_iterator ImageMapIterator;
   ImageMap m_images;
 
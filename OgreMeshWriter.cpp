@@ -19,36 +19,101 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 #include <COLLADAFWEffectCommon.h>
 #include <COLLADAFWScale.h>
 #include <COLLADAFWRotate.h>
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <set>
+#include <thread>
 #include <OgreManualObject.h>
 #include <OgreLogManager.h>
 #include "OgreMeshWriter.h"
+#include "OgreColladaMeshEncoder.h"
 
 OgreCollada::MeshWriter::MeshWriter(const Ogre::String& dir) : Writer(dir, 0, false, false),
-                                                               m_manobj(0)
+                                                               m_manobj(0), m_compressOutput(false), m_tileSize(0),
+                                                               m_outOfCore(0)
 {
   // create proxy writer objects we will supply to the Collada loader
   m_pass1Writer = new OgreMeshDispatchPass1(this);
   m_pass2Writer = new OgreMeshDispatchPass2(this);
 }
 
-OgreCollada::MeshWriter::~MeshWriter() {}
+OgreCollada::MeshWriter::~MeshWriter() {
+  delete m_outOfCore;
+}
+
+void OgreCollada::MeshWriter::setOutOfCore(const Ogre::String& spillDir, size_t memoryBudget) {
+  delete m_outOfCore;
+  m_outOfCore = new OutOfCoreMesh(spillDir, memoryBudget);
+}
+
+bool OgreCollada::MeshWriter::writeOutOfCoreMesh(const Ogre::String& fileName) {
+  if (!m_outOfCore) {
+    LOG_DEBUG("COLLADA ERROR: out-of-core output was not requested");
+    return false;
+  }
+  return m_outOfCore->write(fileName);
+}
 
 bool OgreCollada::MeshWriter::writeGeometry(const COLLADAFW::Geometry* g) {
+  OGRECOLLADA_PROFILE_SCOPE_DETAIL(m_profiler, "writeGeometry", g->getOriginalId());
+  if (m_cancelled) {
+    return false;
+  }
   // find where this geometry gets instantiated
   GeoUsageMapIter mit = m_geometryUsage.find(g->getUniqueId());
   if (mit == m_geometryUsage.end()) {
     LOG_DEBUG("the geometry with unique ID " + boost::lexical_cast<Ogre::String>(g->getUniqueId()) + " and original ID " + boost::lexical_cast<Ogre::String>(g->getOriginalId()) + " and name " + g->getName() + " has no recorded usage");
     return true;
   }
+  if (m_calculateGeometryStats) {
+    m_geometryNames[g->getUniqueId()] = g->getOriginalId();
+    m_geometryInstanceCounts[g->getUniqueId()] = mit->second.size();
+  }
+  Ogre::AxisAlignedBox bounds = filteringByRegion() ? geometryBounds(g) : Ogre::AxisAlignedBox();
   for (GeoInstUsageListIter git = mit->second.begin(); git != mit->second.end(); ++git) {
-    // add an instance of this geometry to the ManualObject with the specified transform
-    if (!addGeometry(g, m_manobj, git->second, git->first))
-      return false;
+    if (!meetsFilterRegion(bounds, git->second)) {
+      continue;     // outside the region of interest
+    }
+    if (m_outOfCore) {
+      // only one instance at a time stays in memory; the rest goes to the spill files
+      MeshData md;
+      if (!flattenGeometry(g, md, git->second, git->first))
+        return false;
+      if (m_accountMemory) {
+        m_memoryAccount.stage(dataBytes(md));
+        accountBuffers(g->getOriginalId(), md, 0, 0, true);
+        m_memoryAccount.unstage(dataBytes(md));
+      }
+      if (!m_outOfCore->add(md))
+        return false;
+    } else if (accumulateMeshData()) {
+      // accumulate vertex data for the mesh we will build directly in finish().  Each instance is flattened
+      // (and cleaned up and optimized) with shared vertices of its own, then added to the mesh's
+      MeshData instance;
+      if (!flattenGeometry(g, instance, git->second, git->first))
+        return false;
+      size_t firstSubmesh = m_meshData.submeshes.size();
+      size_t firstSharedVertex = m_meshData.sharedVertices.size();
+      // with 16-bit indices requested, the mesh can share only so many vertices; the rest keep their own
+      appendMeshData(instance, m_meshData,
+                     m_splitLargeSubmeshes ? MAX_16BIT_VERTICES : std::numeric_limits<size_t>::max());
+      if (m_accountMemory) {
+        m_memoryAccount.stage(dataBytes(m_meshData, firstSubmesh, firstSharedVertex));
+        accountBuffers(g->getOriginalId(), m_meshData, firstSubmesh, firstSharedVertex, true);
+      }
+    } else {
+      // add an instance of this geometry to the ManualObject with the specified transform
+      if (!addGeometry(g, m_manobj, git->second, git->first))
+        return false;
+    }
   }
+  forgetTriangleOrder(g->getUniqueId());     // the instances all came together
   return true;
 }
 
 void OgreCollada::MeshWriter::pass1Finish() {
+  OGRECOLLADA_PROFILE_SCOPE(m_profiler, "pass1Finish");
   // build scene graph and record transformations for each geometry instantiation
 
   // determine initial transformation
@@ -57,66 +122,287 @@ void OgreCollada::MeshWriter::pass1Finish() {
                       Ogre::Vector3(m_ColladaScale.x, m_ColladaScale.y, m_ColladaScale.z),
                       Ogre::Quaternion(m_ColladaRotation.w, m_ColladaRotation.x, m_ColladaRotation.y, m_ColladaRotation.z));
 
-  // recursively find geometry instances and their transforms
+  // find geometry instances and their transforms, leaving library instances for worker threads
+  findFilterMatches();
+  std::vector<UsageSegment> segments(1);
   for (size_t i = 0; i < m_vsRootNodes.size(); ++i) {
-    createSceneDFS(m_vsRootNodes[i], xform);
+    size_t first = segments.size() - 1;
+    if (enterFilteredNode(m_vsRootNodes[i], false)) {
+      createSceneDFS(m_vsRootNodes[i], xform, false, false, segments, true);
+    }
+    for (size_t j = first; j < segments.size(); ++j) {
+      segments[j].root = i;
+    }
+    segments.push_back(UsageSegment());   // so the next root's usages are kept apart
+  }
+  if (!expandLibrarySegments(segments)) {
+    LOG_DEBUG("COLLADA ERROR: some library instances could not be fully expanded");
   }
 
-  // create manualobject for use by pass2 writeGeometry calls
-  m_manobj = new Ogre::ManualObject(m_vsRootNodes[0]->getName() + "_mobj");
+  // merge in order, so the mesh comes out the same as it would from a serial walk.  That includes
+  // abandoning the rest of a root's traversal where an instance cycle was found
+  for (size_t i = 0; i < segments.size(); ++i) {
+    const UsageSequence& usages = segments[i].usages;
+    for (size_t j = 0; j < usages.size(); ++j) {
+      m_geometryUsage[usages[j].first].push_back(usages[j].second);
+    }
+    while (!segments[i].complete && (i + 1 < segments.size()) && (segments[i + 1].root == segments[i].root)) {
+      segments[i + 1].complete = false;
+      ++i;
+    }
+  }
+
+  // create manualobject for use by pass2 writeGeometry calls.  Out-of-core output never touches it
+  if (!m_outOfCore) {
+    m_manobj = new Ogre::ManualObject(m_vsRootNodes[0]->getName() + "_mobj");
+  }
 }
 
 void OgreCollada::MeshWriter::finish() {
+  OGRECOLLADA_PROFILE_SCOPE(m_profiler, "finish");
+  if (m_cancelled) {
+    LOG_DEBUG("COLLADA ERROR: not building the mesh of a cancelled load");
+    return;
+  }
   createMaterials();
 
-  // close manualobject and convert to mesh
-  m_mesh = m_manobj->convertToMesh(m_vsRootNodes[0]->getName() + "_mesh");
+  if (m_outOfCore) {
+    // the data waits in m_outOfCore for writeOutOfCoreMesh
+    if ((m_tileSize > 0) || m_compressOutput || (m_lodLevels > 0)) {
+      LOG_DEBUG("tiling, compression and LODs are not supported for out-of-core output; ignoring them");
+    }
+  } else if (accumulateMeshData()) {
+    VertexFormat fmt = m_vertexFormat;
+    if (fmt.quantizePositions) {
+      // nothing in a .mesh file can carry the dequantization transform
+      LOG_DEBUG("position quantization is not supported for single mesh output; storing full precision positions");
+      fmt.quantizePositions = false;
+    }
+    if (m_tileSize > 0) {
+      std::vector<MeshData> tiles;
+      tileMesh(m_meshData, m_tileSize, tiles);
+      if (m_accountMemory) {
+        // briefly, the tiles and the whole exist together
+        for (size_t i = 0; i < tiles.size(); ++i) {
+          m_memoryAccount.stage(dataBytes(tiles[i]));
+        }
+      }
+      m_meshData = MeshData();
+      for (size_t i = 0; i < tiles.size(); ++i) {
+	m_tiles.push_back(Tile());
+	Tile& tile = m_tiles.back();
+	tile.mesh = buildMesh(m_vsRootNodes[0]->getName() + "_tile" + Ogre::StringConverter::toString(i),
+			      tiles[i], fmt, tile.compressed);
+	tile.triangles = 0;
+	for (size_t j = 0; j < tiles[i].submeshes.size(); ++j) {
+	  const SubmeshData& smd = tiles[i].submeshes[j];
+	  tile.triangles += smd.indices.size() / ((smd.opType == Ogre::RenderOperation::OT_LINE_LIST) ? 2 : 3);
+	}
+	tiles[i] = MeshData();
+      }
+      LOG_DEBUG("divided the mesh into " + Ogre::StringConverter::toString(m_tiles.size()) + " tiles");
+    } else {
+      m_mesh = buildMesh(m_vsRootNodes[0]->getName() + "_mesh", m_meshData, fmt, m_compressedMesh);
+      m_meshData = MeshData();   // release the memory
+    }
+  } else {
+    // close manualobject and convert to mesh
+    m_mesh = m_manobj->convertToMesh(m_vsRootNodes[0]->getName() + "_mesh");
+  }
+  if (m_accountMemory) {
+    // the flattened data (or the ManualObject's copy of it) has all become buffers
+    m_memoryAccount.unstage(m_memoryAccount.getStagingBytes());
+  }
+
+  if (m_calculateGeometryStats) {
+    logGeometryStats();
+  }
 }
 
 // utility functions
 
+OgreCollada::VertexFormat OgreCollada::MeshWriter::bufferFormat() const {
+  VertexFormat fmt = Writer::bufferFormat();
+  fmt.quantizePositions = false;     // see finish()
+  return fmt;
+}
+
+Ogre::MeshPtr OgreCollada::MeshWriter::buildMesh(const Ogre::String& name, const MeshData& md, const VertexFormat& fmt,
+						 std::vector<unsigned char>& compressed) {
+  OGRECOLLADA_PROFILE_SCOPE_DETAIL(m_profiler, "buildMesh", name);
+  Ogre::MeshPtr mesh = createMesh(name, md, fmt);
+  if (m_lodLevels > 0) {
+    OGRECOLLADA_PROFILE_SCOPE(m_profiler, "generateLods");
+    // one big mesh, so divide its submeshes among the available cores instead
+    LodData lods = generateLods(md, m_lodLevels, m_lodReduction,
+				std::max(1u, std::thread::hardware_concurrency()));
+    applyLods(mesh, md, lods, m_lodPixelsPerTriangle);
+    if (m_accountMemory) {
+      // the reduced index buffers belong to the merged mesh rather than to any one geometry
+      std::vector<size_t> lodBytes;
+      lodIndexBytes(md, lods, lodBytes);
+      for (size_t i = 0; i < lodBytes.size(); ++i) {
+	m_memoryAccount.addGeometryBuffers(name, 0, lodBytes[i]);
+	m_memoryAccount.addMaterialBuffers(md.submeshes[i].materialName, 0, lodBytes[i]);
+      }
+    }
+    if (m_calculateGeometryStats) {
+      Ogre::String counts;
+      for (size_t level = 0; level < lods.triangleCounts.size(); ++level) {
+	counts += " " + Ogre::StringConverter::toString(lods.triangleCounts[level]);
+      }
+      LOG_DEBUG(name + " LOD triangle counts:" + counts);
+    }
+  }
+  if (m_compressOutput) {
+    OGRECOLLADA_PROFILE_SCOPE(m_profiler, "encodeMesh");
+    if (!encodeMesh(md, compressed)) {
+      LOG_DEBUG(name + " is too large for the compressed mesh format; no compressed copy made");
+    } else if (m_calculateGeometryStats) {
+      LOG_DEBUG(name + " compressed size: " + Ogre::StringConverter::toString(compressed.size()) + " bytes");
+    }
+  }
+  return mesh;
+}
+
 // recursively build a table of geometry instances with ID and transform
 // to be accessed when geometries are read in the second pass
-bool OgreCollada::MeshWriter::createSceneDFS(const COLLADAFW::Node* cn,  // node to instantiate
-				             Ogre::Matrix4 xn)           // accumulated transform
+bool OgreCollada::MeshWriter::expandLibrarySegments(std::vector<UsageSegment>& segments) {
+  std::vector<size_t> tasks;
+  for (size_t i = 0; i < segments.size(); ++i) {
+    if (segments[i].library) {
+      tasks.push_back(i);
+    }
+  }
+  if (tasks.empty()) {
+    return true;
+  }
+
+  // The transform cache isn't safe to fill from several threads, so fill it now for every
+  // node the tasks can reach: library nodes and their descendants
+  for (LibNodesIterator lit = m_libNodes.begin(); lit != m_libNodes.end(); ++lit) {
+    std::vector<const COLLADAFW::Node*> nodes(1, lit->second);
+    while (!nodes.empty()) {
+      const COLLADAFW::Node* n = nodes.back();
+      nodes.pop_back();
+      localTransform(n);
+      const COLLADAFW::NodePointerArray& cnodes = n->getChildNodes();
+      for (size_t i = 0; i < cnodes.getCount(); ++i) {
+	nodes.push_back(cnodes[i]);
+      }
+    }
+  }
+
+  // each worker claims the next unexpanded segment until they run out
+  std::atomic<size_t> next(0);
+  std::atomic<bool> ok(true);
+  auto worker = [&]() {
+    for (size_t t = next++; t < tasks.size(); t = next++) {
+      UsageSegment& segment = segments[tasks[t]];
+      std::vector<UsageSegment> local(1);
+      if (!createSceneDFS(segment.library, segment.xform, true, segment.selected, local, false)) {
+	segment.complete = false;    // each worker writes only its own segments
+	ok = false;
+      }
+      segment.usages.swap(local[0].usages);
+    }
+  };
+  size_t threadCount = std::min(tasks.size(), size_t(std::max(1u, std::thread::hardware_concurrency())));
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < threadCount; ++i) {
+    threads.push_back(std::thread(worker));
+  }
+  worker();
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i].join();
+  }
+  return ok;
+}
+
+bool OgreCollada::MeshWriter::createSceneDFS(const COLLADAFW::Node* root,   // node to instantiate
+				             const Ogre::Matrix4& xform,    // accumulated transform
+					     bool rootIsLibrary,
+					     bool rootSelected,
+					     std::vector<UsageSegment>& segments,
+					     bool deferLibraries)
 {
-  // apply this node's transformation matrix to the one inherited from its parent
-  const COLLADAFW::TransformationPointerArray& tarr = cn->getTransformations();
-  // COLLADA spec says multiple transformations are "postmultiplied in the order in which
-  // they are specified", which I think means like this:
-  for (size_t i = 0; i < tarr.getCount(); ++i) {
-    xn = xn * computeTransformation(tarr[i]);
-  }
-
-  // record any geometry instances present in this node, along with their attached materials
-  // and cumulative transform
-  const COLLADAFW::InstanceGeometryPointerArray& ginodes = cn->getInstanceGeometries();
-  for (int i = 0, count = ginodes.getCount(); i < count; ++i) {
-    COLLADAFW::InstanceGeometry* gi = ginodes[i];
-    if (m_geometryUsage.find(gi->getInstanciatedObjectId()) == m_geometryUsage.end()) {
-      // create empty usage list for this geometry
-      m_geometryUsage.insert(std::make_pair(gi->getInstanciatedObjectId(), GeoInstUsageList()));
-    }
-    m_geometryUsage[gi->getInstanciatedObjectId()].push_back(std::make_pair(&(gi->getMaterialBindings()), xn));
-  }
-
-  // recursively follow child nodes and library instances
-  const COLLADAFW::NodePointerArray& cnodes = cn->getChildNodes();
-  for (int i = 0, count = cnodes.getCount(); i < count; ++i) {
-    if (!createSceneDFS(cnodes[i], xn))
-      return false;
-  }
-
-  const COLLADAFW::InstanceNodePointerArray& inodes = cn->getInstanceNodes();
-  for (int i = 0, count = inodes.getCount(); i < count; ++i) {
-    LibNodesIterator lit = m_libNodes.find(inodes[i]->getInstanciatedObjectId());
-    if (lit == m_libNodes.end()) {
-      LOG_DEBUG("COLLADA WARNING: could not find library node with unique ID " +
-		boost::lexical_cast<Ogre::String>(inodes[i]->getInstanciatedObjectId()));
+  // An explicit stack instead of recursion, so deep hierarchies can't overflow the call stack.
+  // Library nodes are marked while their subtrees are expanded, to catch instance cycles
+  enum VisitType { VISIT_NODE, VISIT_LIBRARY_NODE, LEAVE_LIBRARY_NODE };
+  struct Visit {
+    const COLLADAFW::Node* node;
+    Ogre::Matrix4 xform;        // accumulated transform of the parent
+    VisitType type;
+    bool selected;              // by the import filter, above this node
+  };
+  std::vector<Visit> stack;
+  std::set<COLLADAFW::UniqueId> expanding;
+  Visit rootVisit = { root, xform, rootIsLibrary ? VISIT_LIBRARY_NODE : VISIT_NODE, rootSelected };
+  stack.push_back(rootVisit);
+
+  while (!stack.empty()) {
+    Visit v = stack.back();
+    stack.pop_back();
+    const COLLADAFW::Node* cn = v.node;
+    if (v.type == LEAVE_LIBRARY_NODE) {
+      expanding.erase(cn->getUniqueId());
+      continue;
+    }
+    if ((v.type == VISIT_LIBRARY_NODE) && deferLibraries) {
+      // start a new segment for this subtree, and another for whatever follows it
+      segments.push_back(UsageSegment());
+      segments.back().library = cn;
+      segments.back().xform = v.xform;
+      segments.back().selected = v.selected;
+      segments.push_back(UsageSegment());
       continue;
     }
-    if (!createSceneDFS(lit->second, xn))
-      return false;
+    if (v.type == VISIT_LIBRARY_NODE) {
+      if (!expanding.insert(cn->getUniqueId()).second) {
+	LOG_DEBUG("COLLADA ERROR: library node " + cn->getOriginalId() + " instantiates itself; abandoning traversal");
+	return false;
+      }
+      Visit leave = { cn, v.xform, LEAVE_LIBRARY_NODE, false };
+      stack.push_back(leave);
+    }
+
+    // apply this node's transformation matrix to the one inherited from its parent
+    const LocalTransform& lt = localTransform(cn);
+    Ogre::Matrix4 xn = lt.identity ? v.xform : v.xform * lt.matrix;
+
+    // record any geometry instances present in this node, along with their attached materials
+    // and cumulative transform.  Only selected nodes have any, so filtered out geometries are never read
+    bool selected = nodeSelected(cn, v.selected);
+    const COLLADAFW::InstanceGeometryPointerArray& ginodes = cn->getInstanceGeometries();
+    for (int i = 0, count = selected ? ginodes.getCount() : 0; i < count; ++i) {
+      COLLADAFW::InstanceGeometry* gi = ginodes[i];
+      segments.back().usages.push_back(std::make_pair(gi->getInstanciatedObjectId(),
+						      std::make_pair(&(gi->getMaterialBindings()), xn)));
+    }
+
+    // follow child nodes, then library instances.  Pushed in reverse so they are visited in order
+    const COLLADAFW::InstanceNodePointerArray& inodes = cn->getInstanceNodes();
+    for (int i = inodes.getCount() - 1; i >= 0; --i) {
+      LibNodesIterator lit = m_libNodes.find(inodes[i]->getInstanciatedObjectId());
+      if (lit == m_libNodes.end()) {
+	LOG_DEBUG("COLLADA WARNING: could not find library node with unique ID " +
+		  boost::lexical_cast<Ogre::String>(inodes[i]->getInstanciatedObjectId()));
+	continue;
+      }
+      if (!enterFilteredLibrary(lit->second, selected)) {
+	continue;
+      }
+      Visit lib = { lit->second, xn, VISIT_LIBRARY_NODE, selected || libraryMatchesFilter(lit->second) };
+      stack.push_back(lib);
+    }
+    const COLLADAFW::NodePointerArray& cnodes = cn->getChildNodes();
+    for (int i = cnodes.getCount() - 1; i >= 0; --i) {
+      if (!enterFilteredNode(cnodes[i], selected)) {
+	continue;
+      }
+      Visit child = { cnodes[i], xn, VISIT_NODE, selected };
+      stack.push_back(child);
+    }
   }
 
   return true;
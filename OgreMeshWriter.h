@@ -19,6 +19,7 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 namespace COLLADABU { namespace Math { class Matrix4; }  }
 
 #include "OgreColladaWriter.h"
+#include "OgreColladaOutOfCoreMesh.h"
 
 namespace OgreCollada {
 
@@ -30,6 +31,29 @@ class MeshWriter : public Writer {
 
   // user access to generated data
   Ogre::MeshPtr getMesh() { return m_mesh; }
+  // the mesh in the compressed format read by decodeMesh, if requested (empty if too large for the format)
+  const std::vector<unsigned char>& getCompressedMesh() const { return m_compressedMesh; }
+
+  // also produce a compressed copy of the mesh (without LODs) during finish()
+  void setCompressedOutput(bool compress) { m_compressOutput = compress; }
+
+  // Divide the output among meshes of no more than maxTriangles each, by recursively splitting space
+  // into octants, so each has tight bounds and can be culled (or paged) on its own.  Zero (the default)
+  // makes one mesh.  With tiling getMesh() returns null; the tiles are here instead
+  void setTileSize(size_t maxTriangles) { m_tileSize = maxTriangles; }
+  struct Tile {
+    Ogre::MeshPtr mesh;
+    size_t triangles;                       // or lines
+    std::vector<unsigned char> compressed;  // if compressed output was requested and the tile fit the format
+  };
+  const std::vector<Tile>& getTiles() const { return m_tiles; }
+
+  // Keep no more than memoryBudget bytes of vertex and index data in memory, spilling the rest to temporary
+  // files in spillDir, and write the result with writeOutOfCoreMesh() instead of creating a mesh.  Submeshes
+  // with the same material, primitive type and vertex attributes are merged.  Vertices are stored unpacked,
+  // and tiling, compression and LODs are not available in this mode
+  void setOutOfCore(const Ogre::String& spillDir, size_t memoryBudget);
+  bool writeOutOfCoreMesh(const Ogre::String& fileName);
 
   // ColladaWriter methods we will implement
   virtual bool writeGeometry(const COLLADAFW::Geometry*);
@@ -47,16 +71,51 @@ class MeshWriter : public Writer {
   // record, for every library geometry, all the places where it's used, and their transforms
   typedef std::vector<std::pair<const COLLADAFW::MaterialBindingArray*, Ogre::Matrix4> > GeoInstUsageList;
   typedef GeoInstUsageList::const_iterator GeoInstUsageListIter;
-  typedef std::map<COLLADAFW::UniqueId, GeoInstUsageList> GeoUsageMap;
+  typedef std::unordered_map<COLLADAFW::UniqueId, GeoInstUsageList> GeoUsageMap;
   typedef GeoUsageMap::const_iterator GeoUsageMapIter;
   GeoUsageMap m_geometryUsage;
 
   Ogre::ManualObject* m_manobj;
+  MeshData m_meshData;          // used instead of the ManualObject when building meshes directly
   Ogre::MeshPtr m_mesh;
+  bool m_compressOutput;
+  std::vector<unsigned char> m_compressedMesh;
+  size_t m_tileSize;
+  std::vector<Tile> m_tiles;
+  OutOfCoreMesh* m_outOfCore;   // if out-of-core output was requested
+
+  // the encoder and the tiling work from MeshData, so both require building the mesh directly
+  bool accumulateMeshData() const { return buildMeshesDirectly() || m_compressOutput || (m_tileSize > 0); }
+  // positions are never quantized in our output
+  virtual VertexFormat bufferFormat() const;
+  // make one output mesh (with its LODs and compressed copy, as requested)
+  Ogre::MeshPtr buildMesh(const Ogre::String& name, const MeshData&, const VertexFormat&,
+			  std::vector<unsigned char>& compressed);
+
+  // Geometry usages in traversal order, collected separately for each library instance at the top
+  // of the hierarchy so those subtrees can be walked in parallel.  Concatenating the segments in
+  // order gives exactly what a single serial walk would
+  typedef std::vector<std::pair<COLLADAFW::UniqueId, GeoInstUsageList::value_type> > UsageSequence;
+  struct UsageSegment {
+    UsageSegment() : library(0), selected(false), root(0), complete(true) {}
+    const COLLADAFW::Node* library;    // library node to expand (with the parent transform below), or 0
+    Ogre::Matrix4 xform;
+    bool selected;                     // by the import filter
+    size_t root;                       // which visual scene root it came from
+    bool complete;                     // false if expansion stopped at an instance cycle
+    UsageSequence usages;
+  };
 
-  // scene graph traversal function
+  // scene graph traversal function.  Usages go into the last segment; with deferLibraries set,
+  // library instances are left as segments of their own for later expansion
   bool createSceneDFS(const COLLADAFW::Node*,   // node to instantiate
-		      Ogre::Matrix4);           // accumulated transform
+		      const Ogre::Matrix4&,     // accumulated transform
+		      bool rootIsLibrary,
+		      bool rootSelected,        // by the import filter
+		      std::vector<UsageSegment>&,
+		      bool deferLibraries);
+  // returns false if any library instance could not be fully expanded
+  bool expandLibrarySegments(std::vector<UsageSegment>&);
 
   // dispatch classes.  Instead of defining a single writer that checks to see what mode it's in,
   // define two proxy writers, one for each pass, that either forward the write method to its
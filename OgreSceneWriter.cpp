@@ -13,6 +13,11 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 
 #include <boost/filesystem.hpp>
 #include <boost/lexical_cast.hpp>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <thread>
+#include <unordered_set>
 
 #include <COLLADABUURI.h>
 #include <COLLADAFWCamera.h>
@@ -22,21 +27,41 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 
 #include <OgreLogManager.h>
 #include <OgreManualObject.h>
+#include <OgreMath.h>
 #include <OgreMatrix4.h>
 #include <OgreEntity.h>
 #include <OgreSubEntity.h>
 #include <OgreMesh.h>
+#include <OgreMeshManager.h>
 #include <OgreSceneNode.h>
 #include <OgreCamera.h>
+#include <OgreWireBoundingBox.h>
 
 #include "OgreSceneWriter.h"
 
 OgreCollada::SceneWriter::SceneWriter(Ogre::SceneManager* mgr,
                                       Ogre::SceneNode* topnode,
                                       const Ogre::String& dir) : Writer(dir, 0, false, false),
+                                                                 m_mergeDuplicateGeometries(false), m_lodsWaited(0),
+                                                                 m_instantiationOrder(DEPTH_FIRST), m_viewpoint(Ogre::Vector3::ZERO),
+                                                                 m_incremental(false), m_sceneStarted(false), m_sceneAbandoned(false),
+                                                                 m_instantiatedNodes(0),
+                                                                 m_progressive(false), m_viewpointFromCamera(false),
+                                                                 m_buildSpatialIndex(false),
+                                                                 m_compactNames(false),
                                                                  m_topNode(topnode), m_sceneMgr(mgr) {}
 
-OgreCollada::SceneWriter::~SceneWriter() {}
+OgreCollada::SceneWriter::~SceneWriter() {
+  abandonScene();
+}
+
+void OgreCollada::SceneWriter::setProgressiveLoading(bool progressive) {
+  m_progressive = progressive;
+  if (progressive) {
+    m_instantiationOrder = NEAREST_FIRST;
+    m_incremental = true;
+  }
+}
 
 bool OgreCollada::SceneWriter::writeCamera(const COLLADAFW::Camera* camera) {
   m_cameras.insert(std::make_pair(camera->getUniqueId(), *camera));
@@ -44,6 +69,10 @@ bool OgreCollada::SceneWriter::writeCamera(const COLLADAFW::Camera* camera) {
 }
 
 bool OgreCollada::SceneWriter::writeGeometry(const COLLADAFW::Geometry* g) {
+  OGRECOLLADA_PROFILE_SCOPE_DETAIL(m_profiler, "writeGeometry", g->getOriginalId());
+  if (m_cancelled) {
+    return false;
+  }
 
   if (m_calculateGeometryStats) {
     // remember this for later use
@@ -67,7 +96,152 @@ bool OgreCollada::SceneWriter::writeGeometry(const COLLADAFW::Geometry* g) {
   }
 
   // create a mesh object out of this Geometry
+  std::shared_ptr<MeshData> md = std::make_shared<MeshData>();
+  bool flattened = flattenGeometry(g, *md);
+  forgetTriangleOrder(g->getUniqueId());     // each geometry is flattened only once here
+  if (!flattened) {
+    LOG_DEBUG("Could not find valid submesh to create, so not creating the parent mesh");
+    return true;  // make this harmless - for now
+  }
+  if (m_accountMemory) {
+    m_memoryAccount.stage(dataBytes(*md));     // until it becomes a mesh
+  }
+
+  // exporters often write out the same geometry more than once; reuse the mesh we already made
+  MeshFingerprint fp;
+  if (m_mergeDuplicateGeometries) {
+    fp = fingerprint(*md);
+  }
+
+  if (m_deferResourceCreation) {
+    // keep the flattened data until createResources(), which makes the mesh on the render thread
+    DeferredMesh dm = { g->getUniqueId(), g->getOriginalId(), md, false, fp, NO_LODS };
+    if (m_mergeDuplicateGeometries) {
+      typedef std::multimap<MeshFingerprint, std::shared_ptr<MeshData> >::const_iterator ContentIter;
+      std::pair<ContentIter, ContentIter> same = m_deferredContents.equal_range(fp);
+      for (ContentIter cit = same.first; (cit != same.second) && !dm.duplicate; ++cit) {
+	if (sameContents(*cit->second, *md)) {
+	  dm.md = cit->second;    // will share the mesh of the first geometry with this content
+	  dm.duplicate = true;
+	}
+      }
+      if (!dm.duplicate) {
+	m_deferredContents.insert(std::make_pair(fp, md));
+      }
+    }
+    if (dm.duplicate) {
+      if (m_accountMemory) {
+	m_memoryAccount.unstage(dataBytes(*md));
+      }
+    } else if (m_lodLevels > 0) {
+      // simplification needs no Ogre objects, so start it now
+      dm.lods = m_pendingLods.size();
+      queueLods(Ogre::MeshPtr(), md);
+    }
+    m_deferredMeshes.push_back(dm);
+    return true;
+  }
+
+  addMesh(g->getUniqueId(), g->getOriginalId(), md, fp, NO_LODS);
+  if (m_accountMemory) {
+    m_memoryAccount.unstage(dataBytes(*md));
+  }
+  return true;
+}
+
+void OgreCollada::SceneWriter::addMesh(const COLLADAFW::UniqueId& id, const Ogre::String& name,
+				       const std::shared_ptr<MeshData>& md, const MeshFingerprint& fp,
+				       size_t lods) {
+  OGRECOLLADA_PROFILE_SCOPE_DETAIL(m_profiler, "addMesh", name);
+  if (m_mergeDuplicateGeometries) {
+    // a fingerprint match is all but certain to be a duplicate; make sure
+    typedef std::multimap<MeshFingerprint, ContentMesh>::const_iterator ContentIter;
+    std::pair<ContentIter, ContentIter> same = m_meshesByContent.equal_range(fp);
+    for (ContentIter dupit = same.first; dupit != same.second; ++dupit) {
+      if ((dupit->second.md == md) || sameContents(*dupit->second.md, *md)) {
+	m_meshMap.insert(std::make_pair(id, dupit->second.mesh));
+	m_mergedGeometryNames.insert(std::make_pair(id, name));
+	OGRECOLLADA_PROFILE_COUNT(m_profiler, "duplicate geometries merged", 1);
+	return;
+      }
+    }
+  }
+  OGRECOLLADA_PROFILE_COUNT(m_profiler, "meshes created", 1);
+
+  Ogre::MeshPtr mesh;
+  if (buildMeshesDirectly()) {
+    // build the mesh ourselves so we can choose the vertex declaration and share vertices
+    Dequantization dq;
+    mesh = createMesh(name, *md, m_vertexFormat, &dq);
+    if (m_vertexFormat.quantizePositions) {
+      m_meshDequantization.insert(std::make_pair(mesh, dq));
+    }
+  } else {
+    mesh = createManualMesh(name, *md);
+  }
+
+  // record materials information for later reference
+  for (size_t i = 0; i < md->submeshes.size(); ++i) {
+    m_meshmatids[mesh].push_back(md->submeshes[i].materialId);
+  }
+
+  if (m_accountMemory) {
+    // materials are bound per instance, so they get charged as the mesh is instantiated
+    accountBuffers(name, *md, 0, 0, false);
+    SubmeshBuffers& sb = m_submeshBuffers[mesh];
+    bufferSizes(*md, bufferFormat(), 0, 0, sb.sizes);
+    for (size_t i = 0; i < md->submeshes.size(); ++i) {
+      sb.defaultMaterials.push_back(md->submeshes[i].materialName);
+    }
+    sb.charged.assign(md->submeshes.size(), false);
+  }
+
+  if (!mesh->isManuallyLoaded()) {
+    LOG_DEBUG("mesh " + mesh->getName() + " is not marked manual, for some reason. It is likely we failed to load it");
+  }
+
+  if (m_buildSpatialIndex) {
+    recordTriangles(mesh, *md);
+  }
+
+  if (lods != NO_LODS) {
+    m_pendingLods[lods].mesh = mesh;    // already being generated
+  } else if (m_lodLevels > 0) {
+    queueLods(mesh, md);
+  }
+
+  // store this mesh somewhere we can refer to it later (e.g. from a library instance)
+  m_meshMap.insert(std::make_pair(id, mesh));
+  if (m_mergeDuplicateGeometries) {
+    ContentMesh cm = { mesh, md };
+    m_meshesByContent.insert(std::make_pair(fp, cm));
+  }
+}
+
+void OgreCollada::SceneWriter::queueLods(Ogre::MeshPtr mesh, const std::shared_ptr<MeshData>& md) {
+  // Simplification is by far the slowest part of import, so run it on other cores while we continue
+  // parsing.  Keep no more tasks in flight than we have cores
+  unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+  if (m_pendingLods.size() - m_lodsWaited >= cores) {
+    m_pendingLods[m_lodsWaited++].lods.wait();
+  }
+
+  PendingLods pending;
+  pending.mesh = mesh;
+  pending.md = md;
+  std::shared_ptr<MeshData> data = md;
+  unsigned levels = m_lodLevels;
+  Ogre::Real reduction = m_lodReduction;
+  Profiler* profiler = m_profiler;
+  pending.lods = std::async(std::launch::async,
+			    [data, levels, reduction, profiler]() {
+			      OGRECOLLADA_PROFILE_SCOPE(profiler, "generateLods");
+			      return generateLods(*data, levels, reduction);
+			    }).share();
+  m_pendingLods.push_back(pending);
+}
 
+Ogre::MeshPtr OgreCollada::SceneWriter::createManualMesh(const Ogre::String& name, const MeshData& md) {
   // After a lot of experimenting it seems like the "ManualObject" flow is the way to go.
   // I had initially avoided it because it didn't allow vertex sharing among submeshes.
   // However, I've discovered that such sharing may be impossible anyway, because Collada
@@ -77,48 +251,124 @@ bool OgreCollada::SceneWriter::writeGeometry(const COLLADAFW::Geometry* g) {
   // from the Collada pair (triple, quad...) to the Ogre index, and create a single vertex buffer for it
   // to reference with all the possible combinations expanded, which means NO SHARING.  So let's use the
   // simpler interface for clarity. (we still have to flatten the index tuples)
+  // Later: the expanded combinations *can* be pooled among the primitives of one geometry, since they
+  // all index the same sources.  That's what setShareVertices does, via createMesh instead of this
 
-  Ogre::ManualObject* manobj = new Ogre::ManualObject(g->getOriginalId() + "_mobj");
-  const COLLADAFW::Mesh* cmesh = dynamic_cast<const COLLADAFW::Mesh*>(g);
+  Ogre::ManualObject* manobj = new Ogre::ManualObject(name + "_mobj");
 
-  // do some estimating of ultimate sizes, for performance
-  manobj->estimateVertexCount(cmesh->getPositions().getValuesCount());
-  int index_count = 0;
-  for (int prim = 0, count = cmesh->getMeshPrimitives().getCount(); prim < count; ++prim) {
-    index_count += cmesh->getMeshPrimitives()[prim]->getPositionIndices().getCount();
+  // we know the ultimate sizes exactly, so tell the ManualObject for performance
+  size_t vertex_count = 0, index_count = 0;
+  for (size_t i = 0; i < md.submeshes.size(); ++i) {
+    vertex_count = std::max(vertex_count, md.submeshes[i].vertices.size());
+    index_count = std::max(index_count, md.submeshes[i].indices.size());
   }
-  manobj->estimateIndexCount(index_count);   // probably more than this, actually...
+  manobj->estimateVertexCount(vertex_count);
+  manobj->estimateIndexCount(index_count);
 
-  if (!addGeometry(g, manobj)) {
-    LOG_DEBUG("Could not find valid submesh to create, so not creating the parent mesh");
-    return true;  // make this harmless - for now
-  }
+  addSubmeshes(md, manobj);
 
   // convert manual object to mesh
-  Ogre::MeshPtr mesh = manobj->convertToMesh(g->getOriginalId());
+  return manobj->convertToMesh(name);
+}
 
-  // record materials information for later reference
-  for (int i = 0, count = cmesh->getMeshPrimitives().getCount(); i < count; ++i) {
-    const COLLADAFW::MeshPrimitive& prim = *(cmesh->getMeshPrimitives()[i]);
-    m_meshmatids[mesh].push_back(prim.getMaterialId());
+void OgreCollada::SceneWriter::finish() {
+  OGRECOLLADA_PROFILE_SCOPE(m_profiler, "finish");
+  // this is the only function we're guaranteed will be called after all the others...
+  // so do everything from here
+  if (m_cancelled) {
+    LOG_DEBUG("COLLADA ERROR: not building the scene of a cancelled load");
+    return;
   }
-
-  if (!mesh->isManuallyLoaded()) {
-    LOG_DEBUG("mesh " + mesh->getName() + " is not marked manual, for some reason. It is likely we failed to load it");
+  if (m_deferResourceCreation) {
+    return;     // createResources() will, later
   }
+  buildScene();
+}
 
-  // store this mesh somewhere we can refer to it later (e.g. from a library instance)
-  m_meshMap.insert(std::make_pair(g->getUniqueId(), mesh));
+void OgreCollada::SceneWriter::createResources() {
+  OGRECOLLADA_PROFILE_SCOPE(m_profiler, "createResources");
+  if (m_cancelled) {
+    LOG_DEBUG("COLLADA ERROR: not creating the resources of a cancelled load");
+    discardDeferredResources();
+    return;
+  }
+  for (size_t i = 0; i < m_deferredMeshes.size(); ++i) {
+    const DeferredMesh& dm = m_deferredMeshes[i];
+    addMesh(dm.id, dm.name, dm.md, dm.fp, dm.lods);
+    if (m_accountMemory && !dm.duplicate) {
+      m_memoryAccount.unstage(dataBytes(*dm.md));
+    }
+  }
+  m_deferredMeshes.clear();
+  m_deferredContents.clear();
+  loadDeferredImages();
 
-  return true;
+  buildScene();
 }
 
-void OgreCollada::SceneWriter::finish() {
-  // this is the only function we're guaranteed will be called after all the others...
-  // so do everything from here
+void OgreCollada::SceneWriter::discardDeferredResources() {
+  // the background tasks hold their own references to the data, but must not outlive us
+  for (size_t i = 0; i < m_pendingLods.size(); ++i) {
+    m_pendingLods[i].lods.wait();
+  }
+  m_pendingLods.clear();
+  m_lodsWaited = 0;
+  for (size_t i = 0; m_accountMemory && (i < m_deferredMeshes.size()); ++i) {
+    if (!m_deferredMeshes[i].duplicate) {
+      m_memoryAccount.unstage(dataBytes(*m_deferredMeshes[i].md));
+    }
+  }
+  m_deferredMeshes.clear();
+  m_deferredContents.clear();
+  m_deferredImages.clear();
+
+  discardDocumentData();
+  m_cameras.clear();
+  m_mergedGeometryNames.clear();
+  m_meshesByContent.clear();
+  m_meshDequantization.clear();
+  m_submeshBuffers.clear();
+  m_meshTriangles.clear();
+}
 
+void OgreCollada::SceneWriter::buildScene() {
+  OGRECOLLADA_PROFILE_SCOPE(m_profiler, "buildScene");
+  if (m_documentReleased) {
+    LOG_DEBUG("COLLADA ERROR: the Collada document was released before the scene could be built");
+    m_sceneAbandoned = true;
+    return;
+  }
+  m_sceneAbandoned = false;
   createMaterials();
 
+  // attach generated levels of detail before anything gets instantiated
+  for (size_t i = 0; i < m_pendingLods.size(); ++i) {
+    const LodData& lods = m_pendingLods[i].lods.get();
+    applyLods(m_pendingLods[i].mesh, *m_pendingLods[i].md, lods, m_lodPixelsPerTriangle);
+    if (m_accountMemory) {
+      // charged to the mesh now, and to materials along with the rest of each submesh's buffers
+      const Ogre::MeshPtr& mesh = m_pendingLods[i].mesh;
+      std::vector<size_t> lodBytes;
+      lodIndexBytes(*m_pendingLods[i].md, lods, lodBytes);
+      std::map<Ogre::MeshPtr, SubmeshBuffers>::iterator sbit = m_submeshBuffers.find(mesh);
+      for (size_t j = 0; j < lodBytes.size(); ++j) {
+	m_memoryAccount.addGeometryBuffers(mesh->getName(), 0, lodBytes[j]);
+	if ((sbit != m_submeshBuffers.end()) && (j < sbit->second.sizes.size())) {
+	  sbit->second.sizes[j].indexBytes += lodBytes[j];
+	}
+      }
+    }
+    if (m_calculateGeometryStats) {
+      Ogre::String counts;
+      for (size_t level = 0; level < lods.triangleCounts.size(); ++level) {
+	counts += " " + Ogre::StringConverter::toString(lods.triangleCounts[level]);
+      }
+      LOG_DEBUG("mesh " + m_pendingLods[i].mesh->getName() + " LOD triangle counts:" + counts);
+    }
+  }
+  m_pendingLods.clear();
+  m_lodsWaited = 0;
+
   // GraphViz debug output
   if (m_dotfn) {
     std::ofstream os(m_dotfn);
@@ -135,63 +385,403 @@ void OgreCollada::SceneWriter::finish() {
   transformShimNode->setOrientation(m_ColladaRotation);
   transformShimNode->setScale(m_ColladaScale);
 
-  // next: (recursively) process root node associated with "visual scene" element of input
+  if (m_viewpointFromCamera) {
+    Ogre::Vector3 position;
+    if (findCameraPosition(transformShimNode->_getFullTransform(), position)) {
+      m_viewpoint = position;
+    } else {
+      LOG_DEBUG("no camera in the scene; using the default viewpoint");
+    }
+  }
+  if (m_progressive || filteringByRegion()) {
+    computeSubtreeBounds();
+  }
+  findFilterMatches();
+
+  // next: process root nodes associated with "visual scene" element of input
+  SceneVisit shimVisit = { 0, transformShimNode, "", NO_PATH, NO_LIBRARIES, VISIT_NODE };
+  shimVisit.selected = false;
+  std::vector<SceneVisit> roots;
   for (size_t i = 0; i < m_vsRootNodes.size(); ++i) {
-    createSceneDFS(m_vsRootNodes[i],
-		       transformShimNode->createChildSceneNode(m_vsRootNodes[i]->getName()),
-		       m_vsRootNodes[i]->getName() + ":");
+    if (enterFilteredNode(m_vsRootNodes[i], false)) {
+      roots.push_back(childVisit(shimVisit, m_vsRootNodes[i]->getName(), m_vsRootNodes[i], VISIT_NODE));
+    }
+  }
+  queueVisits(roots);
+  m_sceneStarted = true;
+  if (m_pendingVisits.empty()) {
+    sceneComplete();
+  } else if (!m_incremental) {
+    step(std::numeric_limits<size_t>::max());
   }
+}
 
-  if (m_calculateGeometryStats) {
-    // output geometry stats
-    std::vector<COLLADAFW::UniqueId> geometries;
-    // BOZO should use some type of function object magic here instead
-    for (std::map<COLLADAFW::UniqueId, int>::const_iterator icit = m_geometryInstanceCounts.begin();
-	 icit != m_geometryInstanceCounts.end(); ++icit) {
-      geometries.push_back(icit->first);
+bool OgreCollada::SceneWriter::step(size_t maxNodes, Ogre::Real maxMilliseconds) {
+  if (!m_sceneStarted || m_sceneAbandoned) {
+    return false;   // finish() hasn't happened yet, or the nodes we'd need are gone
+  }
+  if (m_pendingVisits.empty()) {
+    return true;
+  }
+  OGRECOLLADA_PROFILE_SCOPE(m_profiler, "step");
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::vector<SceneVisit> children;
+  for (size_t count = 0; !m_pendingVisits.empty() && (count < maxNodes); ++count) {
+    if ((maxMilliseconds > 0) && (count > 0) &&
+	(std::chrono::duration<Ogre::Real, std::milli>(std::chrono::steady_clock::now() - start).count() >= maxMilliseconds)) {
+      break;
+    }
+    SceneVisit v = nextVisit();
+    removePlaceholder(v);
+    children.clear();
+    if (((v.type == VISIT_LIBRARY_NODE) && !enterLibraryNode(v)) || !instantiateNode(v, children)) {
+      LOG_DEBUG("abandoning scene instantiation");
+      abandonScene();
+      break;
     }
-    std::sort(geometries.begin(), geometries.end(),
-	      TriangleCountComparator(m_geometryInstanceCounts, m_geometryTriangleCounts));
+    queueVisits(children);
+    ++m_instantiatedNodes;
+  }
+
+  if (m_pendingVisits.empty()) {
+    sceneComplete();
+    return true;
+  }
+  return false;
+}
 
-    LOG_DEBUG("loaded geometry data as follows:");
-    for (std::vector<COLLADAFW::UniqueId>::const_iterator git = geometries.begin();
-	 git != geometries.end(); ++git) {
-      LOG_DEBUG(m_geometryNames[*git] +
-		"\t" + Ogre::StringConverter::toString(m_geometryTriangleCounts[*git]) +
-		"\t" + Ogre::StringConverter::toString(m_geometryLineCounts[*git]) +
-		"\t" + Ogre::StringConverter::toString(m_geometryInstanceCounts[*git]));
+void OgreCollada::SceneWriter::sceneComplete() {
+  if (filteringByName() || filteringByRegion()) {
+    releaseUnusedMeshes();
+  }
+  if (m_accountMemory) {
+    // submeshes never bound to a material keep the one they were made with
+    for (std::map<Ogre::MeshPtr, SubmeshBuffers>::const_iterator it = m_submeshBuffers.begin();
+	 it != m_submeshBuffers.end(); ++it) {
+      for (size_t i = 0; i < it->second.charged.size(); ++i) {
+	chargeSubmesh(it->first, i, it->second.defaultMaterials[i]);
+      }
     }
+    m_submeshBuffers.clear();
   }
+  if (m_buildSpatialIndex) {
+    buildSpatialIndex();
+  }
+  if (m_calculateGeometryStats) {
+    logGeometryStats();
+    if (m_mergeDuplicateGeometries) {
+      LOG_DEBUG("merged " + Ogre::StringConverter::toString(m_mergedGeometryNames.size()) +
+		" duplicate geometries into " + Ogre::StringConverter::toString(m_meshesByContent.size()) + " meshes");
+    }
+  }
+  m_meshesByContent.clear();      // no more geometries to compare, so let their data go
+  m_libraryChains.clear();
+  m_subtreeBounds.clear();
 }
 
-bool OgreCollada::SceneWriter::createSceneDFS(const COLLADAFW::Node* cn, Ogre::SceneNode* sn, const Ogre::String& prefix) {
-  // General algorithm (assumes Ogre scene node is already created):
-  // set transformation
-  // for each instance node, build copy of its subtree recursively, with uniquified name
-  // for each attached geometry, create an entity using our name prefix
-  // recursively handle child each node
+void OgreCollada::SceneWriter::chargeSubmesh(const Ogre::MeshPtr& mesh, size_t submesh, const Ogre::String& material) {
+  std::map<Ogre::MeshPtr, SubmeshBuffers>::iterator it = m_submeshBuffers.find(mesh);
+  if ((it == m_submeshBuffers.end()) || (submesh >= it->second.charged.size()) || it->second.charged[submesh]) {
+    return;     // the buffers are charged to the first material they are drawn with
+  }
+  it->second.charged[submesh] = true;
+  m_memoryAccount.addMaterialBuffers(material, it->second.sizes[submesh].vertexBytes,
+				     it->second.sizes[submesh].indexBytes);
+}
+
+void OgreCollada::SceneWriter::releaseDocument() {
+  if (!m_pendingVisits.empty()) {
+    LOG_DEBUG("COLLADA ERROR: the Collada document was released with " +
+	      Ogre::StringConverter::toString(m_pendingVisits.size()) + " nodes still to instantiate; abandoning them");
+    abandonScene();
+    sceneComplete();          // for what was built
+    m_sceneAbandoned = true;
+  }
+  m_subtreeBounds.clear();
+  Writer::releaseDocument();
+}
 
-  // handle this node's transformation matrix
-  const COLLADAFW::TransformationPointerArray& tarr = cn->getTransformations();
-  if (tarr.getCount()) {
-    Ogre::Matrix4 xform = Ogre::Matrix4::IDENTITY;    // begin with an identity transformation
-    for (size_t i = 0; i < tarr.getCount(); ++i) {
-      xform = xform * computeTransformation(tarr[i]);
+void OgreCollada::SceneWriter::abandonScene() {
+  for (size_t i = 0; i < m_pendingVisits.size(); ++i) {
+    removePlaceholder(m_pendingVisits[i]);
+  }
+  m_pendingVisits.clear();
+}
+
+void OgreCollada::SceneWriter::removePlaceholder(SceneVisit& v) {
+  if (v.placeholder) {
+    v.placeholder->detachFromParent();
+    delete v.placeholder;
+    v.placeholder = 0;
+  }
+}
+
+namespace {
+
+Ogre::Real squaredDistance(const Ogre::AxisAlignedBox& box, const Ogre::Vector3& p) {
+  // zero inside the box
+  Ogre::Vector3 d(std::max(std::max(box.getMinimum().x - p.x, p.x - box.getMaximum().x), Ogre::Real(0)),
+		  std::max(std::max(box.getMinimum().y - p.y, p.y - box.getMaximum().y), Ogre::Real(0)),
+		  std::max(std::max(box.getMinimum().z - p.z, p.z - box.getMaximum().z), Ogre::Real(0)));
+  return d.squaredLength();
+}
+
+void transformBox(Ogre::AxisAlignedBox& box, const Ogre::Matrix4& m) {
+  if (m.isAffine()) {
+    box.transformAffine(m);
+  } else {
+    box.transform(m);
+  }
+}
+
+}
+
+void OgreCollada::SceneWriter::computeSubtreeBounds() {
+  // A post-order pass over the node graph.  Library nodes are shared, so each node's bounds are
+  // found once, in its own space, and transformed into each place it appears.  Only the meshes already
+  // made and the cached local transforms are needed, so this is cheap next to building the scene.
+  // A node seen again while still in progress is an instance cycle, and contributes nothing
+  std::vector<std::pair<const COLLADAFW::Node*, bool> > stack;   // (node, children done)
+  for (size_t i = 0; i < m_vsRootNodes.size(); ++i) {
+    stack.push_back(std::make_pair(m_vsRootNodes[i], false));
+  }
+  std::vector<const COLLADAFW::Node*> parts;
+  while (!stack.empty()) {
+    const COLLADAFW::Node* n = stack.back().first;
+    bool childrenDone = stack.back().second;
+    stack.pop_back();
+
+    const COLLADAFW::NodePointerArray& cnodes = n->getChildNodes();
+    const COLLADAFW::InstanceNodePointerArray& inodes = n->getInstanceNodes();
+    parts.clear();
+    for (int i = 0, count = cnodes.getCount(); i < count; ++i) {
+      parts.push_back(cnodes[i]);
+    }
+    for (int i = 0, count = inodes.getCount(); i < count; ++i) {
+      LibNodesIterator lit = m_libNodes.find(inodes[i]->getInstanciatedObjectId());
+      if (lit != m_libNodes.end()) {
+	parts.push_back(lit->second);
+      }
     }
 
-    // have to split this up into components b/c Ogre::SceneNode has no direct way to set 4x4 transform
-    Ogre::Vector3 position, scale;
-    Ogre::Quaternion orientation;
-    xform.decomposition(position, scale, orientation);
+    if (!childrenDone) {
+      if (!m_subtreeBounds.insert(std::make_pair(n, Ogre::AxisAlignedBox())).second) {
+	continue;     // done already, or in progress
+      }
+      stack.push_back(std::make_pair(n, true));
+      for (size_t i = 0; i < parts.size(); ++i) {
+	stack.push_back(std::make_pair(parts[i], false));
+      }
+      continue;
+    }
 
-    if (orientation.isNaN()) {
-      LOG_DEBUG("COLLADA WARNING: the orientation appears to be gibberish!");
+    Ogre::AxisAlignedBox box;
+    const COLLADAFW::InstanceGeometryPointerArray& ginodes = n->getInstanceGeometries();
+    for (int i = 0, count = ginodes.getCount(); i < count; ++i) {
+      std::unordered_map<COLLADAFW::UniqueId, Ogre::MeshPtr>::const_iterator mit = m_meshMap.find(ginodes[i]->getInstanciatedObjectId());
+      if (mit == m_meshMap.end()) {
+	continue;
+      }
+      box.merge(meshBounds(mit->second));
+    }
+    for (size_t i = 0; i < parts.size(); ++i) {
+      Ogre::AxisAlignedBox partBox = m_subtreeBounds[parts[i]];
+      const LocalTransform& lt = localTransform(parts[i]);
+      if (!partBox.isNull() && !lt.identity) {
+	transformBox(partBox, lt.matrix);
+      }
+      box.merge(partBox);
+    }
+    m_subtreeBounds[n] = box;
+  }
+}
+
+Ogre::AxisAlignedBox OgreCollada::SceneWriter::meshBounds(const Ogre::MeshPtr& mesh) const {
+  Ogre::AxisAlignedBox box = mesh->getBounds();
+  std::map<Ogre::MeshPtr, Dequantization>::const_iterator dqit = m_meshDequantization.find(mesh);
+  if (dqit != m_meshDequantization.end()) {
+    Ogre::Matrix4 dq;
+    dq.makeTransform(dqit->second.offset, dqit->second.scale, Ogre::Quaternion::IDENTITY);
+    transformBox(box, dq);
+  }
+  return box;
+}
+
+void OgreCollada::SceneWriter::releaseUnusedMeshes() {
+  std::set<const Ogre::Mesh*> used;
+  for (std::unordered_map<Ogre::String, std::vector<Ogre::Entity*> >::const_iterator eit = m_entitiesByGeometry.begin();
+       eit != m_entitiesByGeometry.end(); ++eit) {
+    for (size_t i = 0; i < eit->second.size(); ++i) {
+      used.insert(eit->second[i]->getMesh().get());
+    }
+  }
+
+  size_t released = 0;
+  for (std::unordered_map<COLLADAFW::UniqueId, Ogre::MeshPtr>::iterator mit = m_meshMap.begin(); mit != m_meshMap.end(); ) {
+    if (used.count(mit->second.get())) {
+      ++mit;
+      continue;
+    }
+    Ogre::MeshPtr mesh = mit->second;
+    mit = m_meshMap.erase(mit);
+    if (m_meshmatids.erase(mesh) == 0) {
+      continue;     // shared with a duplicate geometry, and already gone
+    }
+    m_meshDequantization.erase(mesh);
+    m_meshTriangles.erase(mesh);
+    if (m_accountMemory) {
+      m_memoryAccount.removeGeometry(mesh->getName());
+      m_submeshBuffers.erase(mesh);
+    }
+    Ogre::MeshManager::getSingleton().remove(mesh->getHandle());
+    ++released;
+  }
+  for (std::multimap<MeshFingerprint, ContentMesh>::iterator cit = m_meshesByContent.begin(); cit != m_meshesByContent.end(); ) {
+    if (used.count(cit->second.mesh.get())) {
+      ++cit;
     } else {
-      sn->setOrientation(orientation);
+      m_meshesByContent.erase(cit++);
+    }
+  }
+  LOG_DEBUG("released " + Ogre::StringConverter::toString(released) + " meshes outside the filtered import");
+}
+
+bool OgreCollada::SceneWriter::findCameraPosition(const Ogre::Matrix4& rootTransform, Ogre::Vector3& position) {
+  // the first camera instance in document order, as the depth first traversal would find it.
+  // Each library node is searched only once, which is enough to find a camera and keeps cycles out
+  std::unordered_set<COLLADAFW::UniqueId> searched;
+  std::vector<std::pair<const COLLADAFW::Node*, Ogre::Matrix4> > stack;   // (node, parent's transform)
+  for (size_t i = m_vsRootNodes.size(); i-- > 0; ) {
+    stack.push_back(std::make_pair(m_vsRootNodes[i], rootTransform));
+  }
+  while (!stack.empty()) {
+    const COLLADAFW::Node* n = stack.back().first;
+    Ogre::Matrix4 xform = stack.back().second;
+    stack.pop_back();
+    const LocalTransform& lt = localTransform(n);
+    if (!lt.identity) {
+      xform = xform * lt.matrix;
+    }
+
+    if (n->getInstanceCameras().getCount() > 0) {
+      position = xform.getTrans();
+      return true;
+    }
+
+    // children come off the stack in the order instantiateNode builds them: library instances first
+    const COLLADAFW::NodePointerArray& cnodes = n->getChildNodes();
+    for (int i = cnodes.getCount(); i-- > 0; ) {
+      stack.push_back(std::make_pair(cnodes[i], xform));
+    }
+    const COLLADAFW::InstanceNodePointerArray& inodes = n->getInstanceNodes();
+    for (int i = inodes.getCount(); i-- > 0; ) {
+      LibNodesIterator lit = m_libNodes.find(inodes[i]->getInstanciatedObjectId());
+      if ((lit != m_libNodes.end()) && searched.insert(lit->first).second) {
+	stack.push_back(std::make_pair(lit->second, xform));
+      }
+    }
+  }
+  return false;
+}
+
+void OgreCollada::SceneWriter::queueVisits(std::vector<SceneVisit>& visits) {
+  size_t kept = 0;
+  for (size_t i = 0; i < visits.size(); ++i) {
+    SceneVisit& v = visits[i];
+    // position each node now, so nearest first ordering knows where it is
+    const LocalTransform& lt = localTransform(v.node);
+    if (!lt.identity) {
+      if (lt.orientation.isNaN()) {
+	LOG_DEBUG("COLLADA WARNING: the orientation appears to be gibberish!");
+      } else {
+	v.sn->setOrientation(lt.orientation);
+      }
+      v.sn->setPosition(lt.position);
+      v.sn->setScale(lt.scale);
+    }
+    if (filteringByRegion()) {
+      // skip whole subtrees outside the region of interest, leaving no empty node behind
+      std::unordered_map<const COLLADAFW::Node*, Ogre::AxisAlignedBox>::const_iterator bit = m_subtreeBounds.find(v.node);
+      if ((bit != m_subtreeBounds.end()) && !meetsFilterRegion(bit->second, importTransform(v.sn))) {
+	discardVisit(v);
+	continue;
+      }
+    }
+    v.priority = 0;
+    if (m_instantiationOrder == NEAREST_FIRST) {
+      v.priority = v.sn->_getDerivedPosition().squaredDistance(m_viewpoint);
+    }
+    if (m_progressive) {
+      // order by (and show) everything the node will hold, not just where it is
+      std::unordered_map<const COLLADAFW::Node*, Ogre::AxisAlignedBox>::const_iterator bit = m_subtreeBounds.find(v.node);
+      if ((bit != m_subtreeBounds.end()) && !bit->second.isNull()) {
+	Ogre::AxisAlignedBox worldBox = bit->second;
+	transformBox(worldBox, v.sn->_getFullTransform());
+	v.priority = squaredDistance(worldBox, m_viewpoint);
+	v.placeholder = new Ogre::WireBoundingBox();
+	v.placeholder->setupBoundingBox(bit->second);
+	v.sn->attachObject(v.placeholder);
+      }
+    }
+    visits[kept++] = v;
+  }
+  visits.resize(kept);
+
+  if (m_instantiationOrder == DEPTH_FIRST) {
+    // reversed, so they come off the back in document order
+    m_pendingVisits.insert(m_pendingVisits.end(), visits.rbegin(), visits.rend());
+  } else if (m_instantiationOrder == BREADTH_FIRST) {
+    m_pendingVisits.insert(m_pendingVisits.end(), visits.begin(), visits.end());
+  } else {
+    for (size_t i = 0; i < visits.size(); ++i) {
+      m_pendingVisits.push_back(visits[i]);
+      std::push_heap(m_pendingVisits.begin(), m_pendingVisits.end(),
+		     [](const SceneVisit& a, const SceneVisit& b) { return a.priority > b.priority; });
+    }
+  }
+}
+
+OgreCollada::SceneWriter::SceneVisit OgreCollada::SceneWriter::nextVisit() {
+  SceneVisit v;
+  if (m_instantiationOrder == DEPTH_FIRST) {
+    v = m_pendingVisits.back();
+    m_pendingVisits.pop_back();
+  } else if (m_instantiationOrder == BREADTH_FIRST) {
+    v = m_pendingVisits.front();
+    m_pendingVisits.pop_front();
+  } else {
+    std::pop_heap(m_pendingVisits.begin(), m_pendingVisits.end(),
+		  [](const SceneVisit& a, const SceneVisit& b) { return a.priority > b.priority; });
+    v = m_pendingVisits.back();
+    m_pendingVisits.pop_back();
+  }
+  return v;
+}
+
+bool OgreCollada::SceneWriter::enterLibraryNode(SceneVisit& v) {
+  // a library node already being expanded above this one means the file is recursive
+  for (Ogre::uint32 l = v.libraries; l != NO_LIBRARIES; l = m_libraryChains[l].second) {
+    if (m_libraryChains[l].first == v.node->getUniqueId()) {
+      LOG_DEBUG("COLLADA ERROR: library node " + v.node->getOriginalId() + " instantiates itself");
+      return false;
     }
-    sn->setPosition(position);
-    sn->setScale(scale);
   }
+  m_libraryChains.push_back(std::make_pair(v.node->getUniqueId(), v.libraries));
+  v.libraries = Ogre::uint32(m_libraryChains.size() - 1);
+  return true;
+}
+
+bool OgreCollada::SceneWriter::instantiateNode(const SceneVisit& v, std::vector<SceneVisit>& children) {
+  // General algorithm (assumes Ogre scene node is already created and transformed):
+  // for each attached geometry, create an entity using our name prefix
+  // for each instance node and each regular child node, create a scene node (with uniquified name)
+  // and return it, to be queued and built in turn
+
+  const COLLADAFW::Node* cn = v.node;
+  Ogre::SceneNode* sn = v.sn;
+  const Ogre::String& prefix = v.prefix;
+  bool selected = nodeSelected(cn, v.selected);
 
   // collect the different types of child nodes
   const COLLADAFW::InstanceNodePointerArray& inodes = cn->getInstanceNodes();
@@ -213,28 +803,52 @@ bool OgreCollada::SceneWriter::createSceneDFS(const COLLADAFW::Node* cn, Ogre::S
 	LOG_DEBUG("COLLADA WARNING: could not find library node with unique ID " + Ogre::StringConverter::toString(inodes[0]->getInstanciatedObjectId()));
 	return false;
       }
-      Ogre::String iname = sn->getName() + ":" + lit->second->getOriginalId();
-      return processLibraryInstance(inodes[0], sn, iname + ":");
+      if (!enterFilteredLibrary(lit->second, selected)) {
+	return true;
+      }
+      SceneVisit at = v;
+      at.selected = selected;
+      if (m_compactNames) {
+	at.path = addPath(m_objectPaths[sn], lit->second->getOriginalId());
+      } else {
+	at.prefix = sn->getName() + ":" + lit->second->getOriginalId() + ":";
+      }
+      return processLibraryInstance(inodes[0], at, children);
     }
   }
 
-
   // connect up library instances
   for (int i = 0, count = inodes.getCount(); i < count; ++i) {
-    Ogre::String iname = prefix + "LibraryInstance_" + boost::lexical_cast<Ogre::String>(inodes[i]->getInstanciatedObjectId());
-    Ogre::SceneNode* lsn = sn->createChildSceneNode(iname);
-    processLibraryInstance(inodes[i], lsn, iname + ":");
+    LibNodesIterator lit = m_libNodes.find(inodes[i]->getInstanciatedObjectId());
+    if ((lit != m_libNodes.end()) && !enterFilteredLibrary(lit->second, selected)) {
+      continue;
+    }
+    SceneVisit at = childVisit(v, "LibraryInstance_" + boost::lexical_cast<Ogre::String>(inodes[i]->getInstanciatedObjectId()),
+			       0, VISIT_LIBRARY_NODE);
+    at.selected = selected;
+    processLibraryInstance(inodes[i], at, children);
   }
 
-  // implement geometry instances
-  for (int i = 0, count = ginodes.getCount(); i < count; ++i) {
+  // implement geometry instances, if the import filter selects them
+  for (int i = 0, count = selected ? ginodes.getCount() : 0; i < count; ++i) {
     COLLADAFW::InstanceGeometry* gi = ginodes[i];
-    std::map<COLLADAFW::UniqueId, Ogre::MeshPtr>::const_iterator mit = m_meshMap.find(gi->getInstanciatedObjectId());
+    std::unordered_map<COLLADAFW::UniqueId, Ogre::MeshPtr>::const_iterator mit = m_meshMap.find(gi->getInstanciatedObjectId());
+    if ((mit != m_meshMap.end()) && !meetsFilterRegion(meshBounds(mit->second), importTransform(sn))) {
+      continue;
+    }
     if (mit != m_meshMap.end()) {
       // so load it
       Ogre::MeshPtr m = mit->second;
-      Ogre::String ename = prefix + m->getName();
-      Ogre::Entity* e = m_sceneMgr->createEntity(ename, m->getName());
+      // name entities for the geometry they instantiate, even if its mesh was made for a duplicate
+      std::unordered_map<COLLADAFW::UniqueId, Ogre::String>::const_iterator mergedit = m_mergedGeometryNames.find(mit->first);
+      const Ogre::String& gname = (mergedit != m_mergedGeometryNames.end()) ? mergedit->second : m->getName();
+      Ogre::Entity* e;
+      if (m_compactNames) {
+	e = m_sceneMgr->createEntity(m->getName());
+	m_objectPaths[e] = addPath(v.path, gname);
+      } else {
+	e = m_sceneMgr->createEntity(prefix + gname, m->getName());
+      }
       MeshMaterialIdMapIterator mmapit = m_meshmatids.find(m);
       if (mmapit == m_meshmatids.end()) {
 	LOG_DEBUG("Cannot find mesh material ids for mesh " + m->getName());
@@ -264,6 +878,9 @@ bool OgreCollada::SceneWriter::createSceneDFS(const COLLADAFW::Node* cn, Ogre::S
 	    if (mmapit->second[j] == mb.getMaterialId()) {
 	      e->getSubEntity(j)->setMaterialName(matname);
 	      found_mat_match = true;
+	      if (m_accountMemory) {
+		chargeSubmesh(m, j, matname);
+	      }
 	    }
 	  }
 	  if (!found_mat_match) {
@@ -272,7 +889,29 @@ bool OgreCollada::SceneWriter::createSceneDFS(const COLLADAFW::Node* cn, Ogre::S
 	}
       }
 
-      sn->attachObject(e);
+      std::map<Ogre::MeshPtr, Dequantization>::const_iterator dqit = m_meshDequantization.find(m);
+      if (dqit != m_meshDequantization.end()) {
+        // positions were quantized; an extra node restores their original scale and location
+        Ogre::SceneNode* dqsn = sn->createChildSceneNode(dqit->second.offset);
+        dqsn->setScale(dqit->second.scale);
+        dqsn->attachObject(e);
+      } else {
+        sn->attachObject(e);
+      }
+
+      m_entitiesByGeometry[gname].push_back(e);
+
+      if (m_buildSpatialIndex) {
+	// the triangles we keep are unquantized, so they belong in the space of "sn" in either case
+	IndexedEntity ie = { e, sn, cn->getUniqueId(), internName(cn->getOriginalId()), NO_NAME };
+	if (v.libraries != NO_LIBRARIES) {
+	  LibNodesIterator lit = m_libNodes.find(m_libraryChains[v.libraries].first);
+	  if ((lit != m_libNodes.end()) && !lit->second->getName().empty()) {
+	    ie.libNodeType = internName(lit->second->getName());
+	  }
+	}
+	m_indexedEntities.push_back(ie);
+      }
 
       if (m_calculateGeometryStats) {
 	// stats
@@ -304,20 +943,232 @@ bool OgreCollada::SceneWriter::createSceneDFS(const COLLADAFW::Node* cn, Ogre::S
   }
 
   // for each regular child node:
-  //     create the node, call recursively
+  //     create the node, queue it for processing
 
   for (int i = 0, count = cnodes.getCount(); i < count; ++i) {
-    Ogre::String cname = prefix + cnodes[i]->getOriginalId();
-    if (!createSceneDFS(cnodes[i], sn->createChildSceneNode(cname), cname + ":"))
-      return false;
+    if (enterFilteredNode(cnodes[i], selected)) {
+      children.push_back(childVisit(v, cnodes[i]->getOriginalId(), cnodes[i], VISIT_NODE));
+      children.back().selected = selected;
+    }
   }
 
   return true;
 }
 
+void OgreCollada::SceneWriter::discardVisit(const SceneVisit& v) {
+  // a library instance was recorded by type before its visit was queued
+  if ((v.type == VISIT_LIBRARY_NODE) && !v.node->getName().empty()) {
+    std::vector<Ogre::SceneNode*>& instances = m_instancesByType[v.node->getName()];
+    std::vector<Ogre::SceneNode*>::iterator it = std::find(instances.rbegin(), instances.rend(), v.sn).base();
+    if (it != instances.begin()) {
+      instances.erase(it - 1);
+    }
+  }
+  // Library visits may share the node of the visit that queued them, which can hold other things.
+  // Otherwise the node was created for this visit alone, and nothing is left in it
+  if ((v.sn->numAttachedObjects() == 0) && (v.sn->numChildren() == 0)) {
+    m_objectPaths.erase(v.sn);
+    m_sceneMgr->destroySceneNode(v.sn);
+  }
+}
+
+Ogre::Matrix4 OgreCollada::SceneWriter::importTransform(const Ogre::SceneNode* sn) const {
+  // the region is given relative to the top node, wherever that is
+  return m_topNode->_getFullTransform().inverseAffine() * sn->_getFullTransform();
+}
+
+OgreCollada::SceneWriter::SceneVisit
+OgreCollada::SceneWriter::childVisit(const SceneVisit& parent, const Ogre::String& component,
+				     const COLLADAFW::Node* node, SceneVisitType type) {
+  SceneVisit child = { node, 0, "", NO_PATH, parent.libraries, type };
+  child.selected = parent.selected;
+  if (m_compactNames) {
+    child.sn = parent.sn->createChildSceneNode();
+    child.path = addPath(parent.path, component);
+    m_objectPaths[child.sn] = child.path;
+  } else {
+    Ogre::String name = parent.prefix + component;
+    child.sn = parent.sn->createChildSceneNode(name);
+    child.prefix = name + ":";
+  }
+  return child;
+}
+
+Ogre::uint32 OgreCollada::SceneWriter::internName(const Ogre::String& name) {
+  // the same few names (library node IDs in particular) recur throughout a scene, so store each once
+  std::unordered_map<Ogre::String, Ogre::uint32>::const_iterator cit = m_pathComponentIds.find(name);
+  if (cit == m_pathComponentIds.end()) {
+    cit = m_pathComponentIds.insert(std::make_pair(name, Ogre::uint32(m_pathComponents.size()))).first;
+    m_pathComponents.push_back(name);
+  }
+  return cit->second;
+}
+
+Ogre::uint32 OgreCollada::SceneWriter::addPath(Ogre::uint32 parent, const Ogre::String& component) {
+  PathEntry entry = { parent, internName(component) };
+  m_paths.push_back(entry);
+  return Ogre::uint32(m_paths.size() - 1);
+}
+
+Ogre::String OgreCollada::SceneWriter::pathString(Ogre::uint32 path) const {
+  std::vector<Ogre::uint32> components;
+  for (; path != NO_PATH; path = m_paths[path].parent) {
+    components.push_back(m_paths[path].component);
+  }
+  Ogre::String result;
+  for (size_t i = components.size(); i-- > 0; ) {
+    result += m_pathComponents[components[i]];
+    if (i > 0) {
+      result += ":";
+    }
+  }
+  return result;
+}
+
+Ogre::String OgreCollada::SceneWriter::getColladaPath(const Ogre::SceneNode* sn) const {
+  if (!m_compactNames) {
+    return sn->getName();
+  }
+  std::unordered_map<const void*, Ogre::uint32>::const_iterator pit = m_objectPaths.find(sn);
+  return (pit == m_objectPaths.end()) ? Ogre::String() : pathString(pit->second);
+}
+
+Ogre::String OgreCollada::SceneWriter::getColladaPath(const Ogre::MovableObject* mo) const {
+  if (!m_compactNames) {
+    return mo->getName();
+  }
+  std::unordered_map<const void*, Ogre::uint32>::const_iterator pit = m_objectPaths.find(mo);
+  return (pit == m_objectPaths.end()) ? Ogre::String() : pathString(pit->second);
+}
+
+void OgreCollada::SceneWriter::recordTriangles(Ogre::MeshPtr mesh, const MeshData& md) {
+  MeshTriangles& tris = m_meshTriangles[mesh];
+  // shared vertices go first, where every submesh using them can refer to them
+  for (size_t v = 0; v < md.sharedVertices.size(); ++v) {
+    tris.positions.push_back(Ogre::Vector3(md.sharedVertices.vertex(v)));
+  }
+  for (size_t i = 0; i < md.submeshes.size(); ++i) {
+    const SubmeshData& sm = md.submeshes[i];
+    if (sm.opType != Ogre::RenderOperation::OT_TRIANGLE_LIST) {
+      continue;     // lines can't be hit
+    }
+    size_t base = 0;
+    if (!sm.useSharedVertices) {
+      base = tris.positions.size();
+      for (size_t v = 0; v < sm.vertices.size(); ++v) {
+	tris.positions.push_back(Ogre::Vector3(sm.vertices.vertex(v)));
+      }
+    }
+    for (size_t j = 0; j < sm.indices.size(); ++j) {
+      tris.indices.push_back(Ogre::uint32(base + sm.indices[j]));
+    }
+  }
+}
+
+void OgreCollada::SceneWriter::buildSpatialIndex() {
+  // bound each entity by its actual vertices in world space; transforming the mesh's box would
+  // leave a lot of empty space around rotated objects
+  std::vector<Ogre::AxisAlignedBox> boxes(m_indexedEntities.size());
+  for (size_t i = 0; i < m_indexedEntities.size(); ++i) {
+    const IndexedEntity& ie = m_indexedEntities[i];
+    std::map<Ogre::MeshPtr, MeshTriangles>::const_iterator tit = m_meshTriangles.find(ie.entity->getMesh());
+    if (tit == m_meshTriangles.end() || tit->second.positions.empty()) {
+      boxes[i] = ie.entity->getWorldBoundingBox(true);
+      continue;
+    }
+    const Ogre::Matrix4& xform = ie.frame->_getFullTransform();
+    const std::vector<Ogre::Vector3>& positions = tit->second.positions;
+    for (size_t v = 0; v < positions.size(); ++v) {
+      boxes[i].merge(xform * positions[v]);
+    }
+  }
+  m_bvh.build(boxes);
+  LOG_DEBUG("spatial index built over " + Ogre::StringConverter::toString(m_indexedEntities.size()) + " entities");
+}
+
+bool OgreCollada::SceneWriter::hitEntity(const IndexedEntity& ie, const Ogre::Ray& ray, Ogre::Real& distance) const {
+  if (!ie.entity->isVisible()) {
+    return false;
+  }
+  std::map<Ogre::MeshPtr, MeshTriangles>::const_iterator tit = m_meshTriangles.find(ie.entity->getMesh());
+  if (tit == m_meshTriangles.end()) {
+    return true;    // nothing better than the box to go on
+  }
+
+  // test in the mesh's own space.  The transform is affine, so distances along the ray carry over
+  Ogre::Matrix4 inverse = ie.frame->_getFullTransform().inverseAffine();
+  Ogre::Vector3 origin = inverse.transformAffine(ray.getOrigin());
+  Ogre::Ray localRay(origin, inverse.transformAffine(ray.getOrigin() + ray.getDirection()) - origin);
+
+  const std::vector<Ogre::Vector3>& positions = tit->second.positions;
+  const std::vector<Ogre::uint32>& indices = tit->second.indices;
+  bool hit = false;
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    std::pair<bool, Ogre::Real> result = Ogre::Math::intersects(localRay, positions[indices[i]],
+								positions[indices[i + 1]], positions[indices[i + 2]],
+								true, true);
+    if (result.first && (!hit || (result.second < distance))) {
+      hit = true;
+      distance = result.second;
+    }
+  }
+  return hit;
+}
+
+OgreCollada::SceneWriter::PickResult OgreCollada::SceneWriter::pickResult(Ogre::uint32 item) const {
+  const IndexedEntity& ie = m_indexedEntities[item];
+  PickResult result = { ie.entity, 0, ie.node, m_pathComponents[ie.nodeId],
+			(ie.libNodeType == NO_NAME) ? Ogre::String() : m_pathComponents[ie.libNodeType] };
+  return result;
+}
+
+OgreCollada::SceneWriter::PickResult OgreCollada::SceneWriter::pick(const Ogre::Ray& ray) const {
+  Ogre::Real distance;
+  Ogre::uint32 item = m_bvh.raycast(ray,
+				    [this, &ray](Ogre::uint32 i, Ogre::Real& d) { return hitEntity(m_indexedEntities[i], ray, d); },
+				    distance);
+  if (item == Bvh::NO_ITEM) {
+    PickResult miss = { 0, 0, COLLADAFW::UniqueId(), "", "" };
+    return miss;
+  }
+  PickResult result = pickResult(item);
+  result.distance = distance;
+  return result;
+}
+
+void OgreCollada::SceneWriter::queryBox(const Ogre::AxisAlignedBox& box, std::vector<PickResult>& results) const {
+  std::vector<Ogre::uint32> items;
+  m_bvh.query(box, items);
+  for (size_t i = 0; i < items.size(); ++i) {
+    if (m_indexedEntities[items[i]].entity->isVisible()) {
+      results.push_back(pickResult(items[i]));
+    }
+  }
+}
+
+const std::vector<Ogre::SceneNode*>& OgreCollada::SceneWriter::getInstancesOfType(const Ogre::String& libNodeType) const {
+  static const std::vector<Ogre::SceneNode*> none;
+  std::unordered_map<Ogre::String, std::vector<Ogre::SceneNode*> >::const_iterator it = m_instancesByType.find(libNodeType);
+  return (it == m_instancesByType.end()) ? none : it->second;
+}
+
+const std::vector<Ogre::Entity*>& OgreCollada::SceneWriter::getEntitiesOfGeometry(const Ogre::String& geometryId) const {
+  static const std::vector<Ogre::Entity*> none;
+  std::unordered_map<Ogre::String, std::vector<Ogre::Entity*> >::const_iterator it = m_entitiesByGeometry.find(geometryId);
+  return (it == m_entitiesByGeometry.end()) ? none : it->second;
+}
+
+void OgreCollada::SceneWriter::setTypeVisible(const Ogre::String& libNodeType, bool visible) {
+  const std::vector<Ogre::SceneNode*>& instances = getInstancesOfType(libNodeType);
+  for (size_t i = 0; i < instances.size(); ++i) {
+    instances[i]->setVisible(visible);
+  }
+}
+
 // instantiate library node at the given Ogre SceneNode, assuming transformation is set for you
 bool OgreCollada::SceneWriter::processLibraryInstance(const COLLADAFW::InstanceNode* inode,
-					     Ogre::SceneNode* lsn, const Ogre::String& prefix) {
+						      const SceneVisit& at, std::vector<SceneVisit>& children) {
+  Ogre::SceneNode* lsn = at.sn;
   // an instantiation of an entire subtree
   // follow the hierarchy (the regular node and its subtree) associated with this instance node by looking it up in the library nodes
   LibNodesIterator lit = m_libNodes.find(inode->getInstanciatedObjectId());
@@ -336,12 +1187,15 @@ bool OgreCollada::SceneWriter::processLibraryInstance(const COLLADAFW::InstanceN
     // store the type (name of the library node) as a property
     Ogre::UserObjectBindings& lsprops = lsn->getUserObjectBindings();
     lsprops.setUserAny("LibNodeType", Ogre::Any(lit->second->getName()));
+    m_instancesByType[lit->second->getName()].push_back(lsn);
   }
 
-  if (!createSceneDFS(lit->second, lsn, prefix))
-    return false;
- 
- return true;
+  // the subtree itself gets built when the traversal gets to it
+  SceneVisit visit = { lit->second, lsn, at.prefix, at.path, at.libraries, VISIT_LIBRARY_NODE };
+  visit.selected = at.selected || libraryMatchesFilter(lit->second);
+  children.push_back(visit);
+
+  return true;
 }
 
 Ogre::Camera* OgreCollada::SceneWriter::getCamera() {
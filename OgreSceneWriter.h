@@ -17,12 +17,22 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 #include <OgreSceneManager.h>
 #include <COLLADAFWInstanceNode.h>
 
+#include <deque>
+#include <future>
+#include <memory>
+#include <set>
+
 #include "OgreColladaWriter.h"
+#include "OgreColladaBvh.h"
 
 namespace COLLADAFW {
    class Geometry;
 }
 
+namespace Ogre {
+   class WireBoundingBox;
+}
+
 namespace OgreCollada {
 
 class SceneWriter : public Writer {
@@ -37,17 +47,230 @@ class SceneWriter : public Writer {
 
   Ogre::Camera* getCamera();            // If Collada file defined and instantiated one (returns first)
 
+  // Leave the creation of Ogre resources (meshes, textures, materials, and the scene itself) out of
+  // loading, so it can run on another thread.  The render thread then calls createResources()
+  void setDeferResourceCreation(bool defer) { m_deferResourceCreation = defer; }
+  void createResources();
+  // throw away what a deferred load accumulated, e.g. after it was cancelled: the converted data waiting
+  // for createResources(), and the materials, geometries and nodes recorded from the document
+  void discardDeferredResources();
+
+  // Use a single mesh for geometries with identical contents (off by default).  The mesh is named for
+  // the first of them; entities still get the name of the geometry they instantiate.  Contents with
+  // matching fingerprints are compared in full, so each mesh's flattened data is kept until the scene
+  // is complete
+  void setMergeDuplicateGeometries(bool merge) { m_mergeDuplicateGeometries = merge; }
+
+  // Let Ogre generate the names of scene nodes and entities, instead of building them out of the
+  // full Collada path (which gets long, and slow, in deep hierarchies)
+  void setCompactNames(bool compact) { m_compactNames = compact; }
+  // The path-based name a scene node or entity gets without compact names.  With compact names
+  // it is assembled from a side table on each call
+  Ogre::String getColladaPath(const Ogre::SceneNode*) const;
+  Ogre::String getColladaPath(const Ogre::MovableObject*) const;
+
+  // The order in which the scene is built.  Depth first (the default) follows the file;
+  // nearest first builds nodes in order of distance from a viewpoint (in world coordinates)
+  enum InstantiationOrder { DEPTH_FIRST, BREADTH_FIRST, NEAREST_FIRST };
+  void setInstantiationOrder(InstantiationOrder order, const Ogre::Vector3& viewpoint = Ogre::Vector3::ZERO) {
+    m_instantiationOrder = order;
+    m_viewpoint = viewpoint;
+  }
+
+  // With incremental instantiation, finish() only prepares the scene, and the application calls step()
+  // (from a FrameListener, say) to build it a little at a time.  Whatever has been built is attached
+  // and visible immediately
+  void setIncrementalInstantiation(bool incremental) { m_incremental = incremental; }
+  // Build up to maxNodes Collada nodes, stopping early if maxMilliseconds (if nonzero) have passed.
+  // Returns true once the scene is complete.  The nodes still to be built are only referenced, not copied,
+  // so the loader must outlive the steps; if the document is released first (see Writer::releaseDocument)
+  // the rest of the scene is abandoned, and step() fails from then on
+  bool step(size_t maxNodes, Ogre::Real maxMilliseconds = 0);
+  bool isSceneComplete() const { return m_sceneStarted && m_pendingVisits.empty() && !m_sceneAbandoned; }
+  bool isSceneAbandoned() const { return m_sceneAbandoned; }
+
+  virtual void releaseDocument();
+
+  // Progressive loading, for looking at a large model while it is built: switches to incremental, nearest
+  // first instantiation, ordered by the bounds of whole subtrees (found by a quick pass over the nodes before
+  // anything is built) rather than by node positions.  Subtrees not yet built are shown as wireframe boxes
+  void setProgressiveLoading(bool progressive);
+  // take the nearest first viewpoint from the first camera the file instantiates, if it has one
+  void setViewpointFromCamera(bool fromCamera) { m_viewpointFromCamera = fromCamera; }
+
+  // Build a bounding volume hierarchy over the world bounds of the imported entities once the scene is
+  // complete, so picking and region queries don't have to look at every object.  It reflects the scene
+  // as built; moving nodes afterwards makes it stale
+  void setBuildSpatialIndex(bool build) { m_buildSpatialIndex = build; }
+  struct PickResult {
+    Ogre::Entity* entity;       // null if nothing was hit
+    Ogre::Real distance;        // along the ray
+    COLLADAFW::UniqueId node;   // the Collada node instantiating the geometry
+    Ogre::String nodeId;        // and its original ID
+    Ogre::String libNodeType;   // the library node it was instantiated through, if any (as in "LibNodeType")
+  };
+  // the nearest visible entity whose triangles the ray hits
+  PickResult pick(const Ogre::Ray&) const;
+  // visible entities whose world bounds intersect the box
+  void queryBox(const Ogre::AxisAlignedBox&, std::vector<PickResult>&) const;
+
+  // The scene nodes instantiating each library node, by its name (the "LibNodeType" stored on them),
+  // and the entities made from each geometry, by its original ID.  Both are filled in as the scene is built
+  const std::vector<Ogre::SceneNode*>& getInstancesOfType(const Ogre::String& libNodeType) const;
+  const std::vector<Ogre::Entity*>& getEntitiesOfGeometry(const Ogre::String& geometryId) const;
+  // show or hide everything instantiated from a library node
+  void setTypeVisible(const Ogre::String& libNodeType, bool visible);
+  size_t getInstantiatedNodeCount() const { return m_instantiatedNodes; }
+  size_t getPendingNodeCount() const { return m_pendingVisits.size(); }  // grows as the scene is expanded
+
  private:
   // hide default xtor and compiler-generated copy and assignment operators
   SceneWriter();
   SceneWriter( const SceneWriter& pre );
   const SceneWriter& operator= ( const SceneWriter& pre );
 
-  std::map<COLLADAFW::UniqueId, COLLADAFW::Camera> m_cameras;
+  std::unordered_map<COLLADAFW::UniqueId, COLLADAFW::Camera> m_cameras;
+
+  // meshes with quantized positions, and how to restore them
+  std::map<Ogre::MeshPtr, Dequantization> m_meshDequantization;
+
+  // meshes by content, so geometries exported more than once under different IDs can share one
+  bool m_mergeDuplicateGeometries;
+  struct ContentMesh {
+    Ogre::MeshPtr mesh;
+    std::shared_ptr<MeshData> md;     // to confirm a fingerprint match
+  };
+  std::multimap<MeshFingerprint, ContentMesh> m_meshesByContent;
+  std::unordered_map<COLLADAFW::UniqueId, Ogre::String> m_mergedGeometryNames;  // original IDs of the duplicates
+
+  // For memory accounting: each mesh's submesh buffer sizes, charged to a material when the submesh is
+  // first bound to one, or to its default material once the scene is complete
+  struct SubmeshBuffers {
+    std::vector<BufferSize> sizes;
+    std::vector<Ogre::String> defaultMaterials;
+    std::vector<bool> charged;
+  };
+  std::map<Ogre::MeshPtr, SubmeshBuffers> m_submeshBuffers;
+  void chargeSubmesh(const Ogre::MeshPtr&, size_t submesh, const Ogre::String& material);
+
+  // levels of detail being generated in the background, to be attached to their meshes in finish()
+  struct PendingLods {
+    Ogre::MeshPtr mesh;
+    std::shared_ptr<MeshData> md;     // shared with the task computing the levels
+    std::shared_future<LodData> lods;
+  };
+  std::vector<PendingLods> m_pendingLods;
+  size_t m_lodsWaited;                // pending entries known to be finished
+  void queueLods(Ogre::MeshPtr mesh, const std::shared_ptr<MeshData>& md);
+
+  // geometries converted while resource creation is deferred
+  static const size_t NO_LODS = ~size_t(0);
+  struct DeferredMesh {
+    COLLADAFW::UniqueId id;
+    Ogre::String name;
+    std::shared_ptr<MeshData> md;     // for a duplicate, that of the earlier geometry it duplicates
+    bool duplicate;
+    MeshFingerprint fp;
+    size_t lods;                      // into m_pendingLods, if already started
+  };
+  std::vector<DeferredMesh> m_deferredMeshes;
+  std::multimap<MeshFingerprint, std::shared_ptr<MeshData> > m_deferredContents;
+  void addMesh(const COLLADAFW::UniqueId&, const Ogre::String& name, const std::shared_ptr<MeshData>&,
+	       const MeshFingerprint&, size_t lods);
+  void buildScene();
 
   // utility functions
-  bool createSceneDFS(const COLLADAFW::Node*, Ogre::SceneNode*, const Ogre::String& prefix = "");
-  bool processLibraryInstance(const COLLADAFW::InstanceNode*, Ogre::SceneNode*, const Ogre::String& prefix);
+  Ogre::MeshPtr createManualMesh(const Ogre::String& name, const MeshData&);
+
+  // Work remaining in the scene traversal, which uses an explicit queue instead of recursion.
+  // Each visit refers to the library nodes being expanded above it, so instance cycles can be caught
+  enum SceneVisitType { VISIT_NODE, VISIT_LIBRARY_NODE };
+  struct SceneVisit {
+    const COLLADAFW::Node* node;
+    Ogre::SceneNode* sn;               // already created (and transformed) for this node
+    Ogre::String prefix;               // for uniquifying names in the subtree
+    Ogre::uint32 path;                 // instead of the prefix, with compact names
+    Ogre::uint32 libraries;            // into m_libraryChains
+    SceneVisitType type;
+    Ogre::Real priority;               // for nearest first order: smaller is sooner
+    Ogre::WireBoundingBox* placeholder; // shown until the node is built, in progressive loading
+    bool selected;                     // by the import filter, above this node
+  };
+  std::deque<SceneVisit> m_pendingVisits;        // a stack, queue, or heap, depending on order
+  static const Ogre::uint32 NO_LIBRARIES = ~Ogre::uint32(0);
+  std::vector<std::pair<COLLADAFW::UniqueId, Ogre::uint32> > m_libraryChains;   // (library node, parent entry)
+  InstantiationOrder m_instantiationOrder;
+  Ogre::Vector3 m_viewpoint;
+  bool m_incremental;
+  bool m_sceneStarted;
+  bool m_sceneAbandoned;              // because its document was released before it was built
+  size_t m_instantiatedNodes;
+  void queueVisits(std::vector<SceneVisit>&);    // supplied in document order
+  void discardVisit(const SceneVisit&);          // one outside the filter region, before it is queued
+  Ogre::Matrix4 importTransform(const Ogre::SceneNode*) const;   // of a node, relative to m_topNode
+  SceneVisit nextVisit();
+  bool enterLibraryNode(SceneVisit&);
+  void sceneComplete();
+  void abandonScene();
+  void removePlaceholder(SceneVisit&);
+  bool instantiateNode(const SceneVisit&, std::vector<SceneVisit>& children);
+  bool processLibraryInstance(const COLLADAFW::InstanceNode*, const SceneVisit& at, std::vector<SceneVisit>& children);
+  // create a scene node for a child (named "component") of the parent visit's node
+  SceneVisit childVisit(const SceneVisit& parent, const Ogre::String& component,
+			const COLLADAFW::Node*, SceneVisitType);
+
+  // progressive loading: the bounds of each node's subtree (including library instances) in its own space
+  bool m_progressive;
+  bool m_viewpointFromCamera;
+  std::unordered_map<const COLLADAFW::Node*, Ogre::AxisAlignedBox> m_subtreeBounds;
+  void computeSubtreeBounds();
+  Ogre::AxisAlignedBox meshBounds(const Ogre::MeshPtr&) const;   // restoring quantized positions
+
+  // Geometries arrive before the scene, so a filtered import converts them all; once the subset is built
+  // the meshes it didn't use are released
+  void releaseUnusedMeshes();
+  bool findCameraPosition(const Ogre::Matrix4& rootTransform, Ogre::Vector3& position);
+
+  // the spatial index, over entities recorded as they are created.  Exact ray hits use a copy of each
+  // mesh's triangles, in the space of the scene node named by "frame"
+  bool m_buildSpatialIndex;
+  static const Ogre::uint32 NO_NAME = ~Ogre::uint32(0);
+  struct IndexedEntity {
+    Ogre::Entity* entity;
+    Ogre::SceneNode* frame;
+    COLLADAFW::UniqueId node;
+    Ogre::uint32 nodeId;               // interned
+    Ogre::uint32 libNodeType;          // interned, or NO_NAME
+  };
+  std::vector<IndexedEntity> m_indexedEntities;
+  struct MeshTriangles {
+    std::vector<Ogre::Vector3> positions;
+    std::vector<Ogre::uint32> indices;   // triangle list
+  };
+  std::map<Ogre::MeshPtr, MeshTriangles> m_meshTriangles;
+  Bvh m_bvh;
+  void recordTriangles(Ogre::MeshPtr, const MeshData&);
+  void buildSpatialIndex();
+  bool hitEntity(const IndexedEntity&, const Ogre::Ray&, Ogre::Real& distance) const;
+  PickResult pickResult(Ogre::uint32 item) const;
+
+  std::unordered_map<Ogre::String, std::vector<Ogre::SceneNode*> > m_instancesByType;
+  std::unordered_map<Ogre::String, std::vector<Ogre::Entity*> > m_entitiesByGeometry;
+
+  // Collada paths for compact names, as (parent, name component) pairs with the components interned
+  bool m_compactNames;
+  static const Ogre::uint32 NO_PATH = ~Ogre::uint32(0);
+  struct PathEntry {
+    Ogre::uint32 parent;
+    Ogre::uint32 component;
+  };
+  std::vector<PathEntry> m_paths;
+  std::vector<Ogre::String> m_pathComponents;
+  std::unordered_map<Ogre::String, Ogre::uint32> m_pathComponentIds;
+  std::unordered_map<const void*, Ogre::uint32> m_objectPaths;   // of scene nodes and entities
+  Ogre::uint32 internName(const Ogre::String&);
+  Ogre::uint32 addPath(Ogre::uint32 parent, const Ogre::String& component);
+  Ogre::String pathString(Ogre::uint32 path) const;
 
   Ogre::SceneNode* m_topNode;
   Ogre::SceneManager* m_sceneMgr;
@@ -17,8 +17,8 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 
 #include <boost/lexical_cast.hpp>
 #include <fstream>
+#include <sstream>
 #include <COLLADAFWRoot.h>
-#include <COLLADASaxFWLLoader.h>
 
 #include <OgreRoot.h>
 #include <OgreLogManager.h>
@@ -28,8 +28,8 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 #include <OgreRenderWindow.h>
 
 #include "OgreMeshWriter.h"
-
-#define LOG_DEBUG(msg) { Ogre::LogManager::getSingleton().logMessage( Ogre::String((msg)) ); }
+#include "OgreColladaSaxLoader.h"
+#include "OgreColladaLog.h"
 
 // bug fix: subclass material serializer listener to override writing texture unit filename in cases where
 // the filename contains embedded spaces, and thus needs to be quoted
@@ -86,38 +86,249 @@ int main(int argc, char *argv[])
   // parse args.  A single arg gives the name of the input, and outputs will be placed
   // in the same directory.  Two args give the name of the input dae and output mesh files;
   // other outputs (e.g., materials) will be placed in the same directory as the output file
-  if ((argc < 2) || (argc > 3)) {  // argv[0] is program name...
-    std::cerr << "usage: collada2ogre input.dae [output.mesh]\n";
+  // Options may appear anywhere:
+  //   --compact      pack normals and texture coordinates into fewer bytes
+  //   --split        split submeshes too large for 16-bit indices
+  //   --optimize     reorder triangles and vertices for the GPU vertex caches
+  //   --stats        log per-geometry statistics
+  //   --share        use one vertex buffer for all submeshes
+  //   --weld[=eps]   merge nearly identical vertices (positions within eps) and drop degenerate triangles
+  //   --lod=N        generate N simplified levels of detail
+  //   --compress     also write a compressed copy of the mesh (.cmesh) for OgreCollada::decodeMesh
+  //   --tile=N       write spatial tiles of at most N triangles as separate meshes, listed in a .tiles file
+  //   --node=PATTERN convert only the subtrees under nodes whose name or ID matches (may repeat; "*" is a wildcard)
+  //   --type=PATTERN convert only instances of the matching library nodes (may repeat)
+  //   --region=x0,y0,z0,x1,y1,z1  convert only geometry instances meeting this box (in output coordinates)
+  //   --out-of-core[=MB]  buffer at most MB (default 256) megabytes of mesh data, spilling the rest to
+  //                  temporary files beside the output, for inputs too large to convert in memory
+  //   --profile[=trace.json]  log the time spent in each phase of conversion, and write it as a Chrome trace
+  //                  (by default beside the output, as name.trace.json).  Needs a build with OGRECOLLADA_PROFILING
+  //   --memory-report[=report.json]  write the memory taken by vertex and index buffers, textures, and intermediate
+  //                  data, per geometry, material and texture, as JSON (by default beside the output, as name.memory.json)
+  const char* usage = "usage: collada2ogre [--compact] [--split] [--optimize] [--share] [--weld[=eps]] [--lod=N] [--compress] [--tile=N] [--node=PATTERN] [--type=PATTERN] [--region=x0,y0,z0,x1,y1,z1] [--out-of-core[=MB]] [--stats] [--profile[=trace.json]] [--memory-report[=report.json]] input.dae [output.mesh]\n";
+  bool compact = false;
+  bool split = false;
+  bool optimize = false;
+  bool stats = false;
+  bool compress = false;
+  bool share = false;
+  bool weld = false;
+  OgreCollada::WeldTolerance weldTolerance;
+  unsigned lodLevels = 0;
+  size_t tileSize = 0;
+  size_t outOfCoreBudget = 0;     // in MB; zero for conversion in memory
+  bool profile = false;
+  std::string tracePath;
+  bool memoryReport = false;
+  std::string memoryReportPath;
+  OgreCollada::Writer::ImportFilter filter;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; ++i) {  // argv[0] is program name...
+    std::string arg(argv[i]);
+    if (arg == "--compact") {
+      compact = true;
+    } else if (arg == "--split") {
+      split = true;
+    } else if (arg == "--optimize") {
+      optimize = true;
+    } else if (arg == "--compress") {
+      compress = true;
+    } else if (arg == "--stats") {
+      stats = true;
+    } else if (arg == "--share") {
+      share = true;
+    } else if (arg == "--weld") {
+      weld = true;
+    } else if (arg.compare(0, 7, "--weld=") == 0) {
+      weld = true;
+      try {
+        weldTolerance.position = boost::lexical_cast<Ogre::Real>(arg.substr(7));
+      } catch (boost::bad_lexical_cast const&) {
+        std::cerr << "bad weld tolerance " << arg.substr(7) << "\n" << usage;
+        return 1;
+      }
+    } else if (arg.compare(0, 6, "--lod=") == 0) {
+      try {
+        lodLevels = boost::lexical_cast<unsigned>(arg.substr(6));
+      } catch (boost::bad_lexical_cast const&) {
+        std::cerr << "bad LOD level count " << arg.substr(6) << "\n" << usage;
+        return 1;
+      }
+    } else if (arg.compare(0, 7, "--tile=") == 0) {
+      try {
+        tileSize = boost::lexical_cast<size_t>(arg.substr(7));
+      } catch (boost::bad_lexical_cast const&) {
+        std::cerr << "bad tile size " << arg.substr(7) << "\n" << usage;
+        return 1;
+      }
+    } else if (arg.compare(0, 7, "--node=") == 0) {
+      filter.nodeNames.push_back(arg.substr(7));
+    } else if (arg.compare(0, 7, "--type=") == 0) {
+      filter.libNodeTypes.push_back(arg.substr(7));
+    } else if (arg.compare(0, 9, "--region=") == 0) {
+      std::vector<std::string> coords = Ogre::StringUtil::split(arg.substr(9), ",");
+      Ogre::Real c[6];
+      try {
+        if (coords.size() != 6) {
+          throw boost::bad_lexical_cast();
+        }
+        for (size_t j = 0; j < 6; ++j) {
+          c[j] = boost::lexical_cast<Ogre::Real>(coords[j]);
+        }
+      } catch (boost::bad_lexical_cast const&) {
+        std::cerr << "bad region " << arg.substr(9) << "\n" << usage;
+        return 1;
+      }
+      filter.region.setExtents(std::min(c[0], c[3]), std::min(c[1], c[4]), std::min(c[2], c[5]),
+                               std::max(c[0], c[3]), std::max(c[1], c[4]), std::max(c[2], c[5]));
+    } else if (arg == "--out-of-core") {
+      outOfCoreBudget = 256;
+    } else if (arg.compare(0, 14, "--out-of-core=") == 0) {
+      try {
+        outOfCoreBudget = boost::lexical_cast<size_t>(arg.substr(14));
+      } catch (boost::bad_lexical_cast const&) {
+        std::cerr << "bad memory budget " << arg.substr(14) << "\n" << usage;
+        return 1;
+      }
+      if (outOfCoreBudget == 0) {
+        std::cerr << "the out-of-core memory budget must be at least 1MB\n" << usage;
+        return 1;
+      }
+    } else if (arg == "--profile") {
+      profile = true;
+    } else if (arg.compare(0, 10, "--profile=") == 0) {
+      profile = true;
+      tracePath = arg.substr(10);
+    } else if (arg == "--memory-report") {
+      memoryReport = true;
+    } else if (arg.compare(0, 16, "--memory-report=") == 0) {
+      memoryReport = true;
+      memoryReportPath = arg.substr(16);
+    } else if (arg.compare(0, 2, "--") == 0) {
+      std::cerr << "unknown option " << arg << "\n" << usage;
+      return 1;
+    } else {
+      files.push_back(arg);
+    }
+  }
+  if (files.empty() || (files.size() > 2)) {
+    std::cerr << usage;
     return 1;
   }
+  if ((outOfCoreBudget > 0) && ((tileSize > 0) || compress || (lodLevels > 0))) {
+    std::cerr << "--out-of-core cannot be combined with --tile, --compress, or --lod\n" << usage;
+    return 1;
+  }
+#ifndef OGRECOLLADA_PROFILING
+  if (profile) {
+    std::cerr << "--profile needs the converter built with OGRECOLLADA_PROFILING\n";
+    return 1;
+  }
+#endif
 
-  boost::filesystem::path daepath(argv[1]);
+  boost::filesystem::path daepath(files[0]);
   boost::filesystem::path meshpath;
-  if (argc == 2) {
+  if (files.size() == 1) {
     // no output file supplied; base path and file on input
     meshpath = daepath;
     meshpath.replace_extension(".mesh");
   } else {
-    meshpath = boost::filesystem::path(argv[2]);
+    meshpath = boost::filesystem::path(files[1]);
   }
   boost::filesystem::path matpath = meshpath;
   matpath.replace_extension(".material");
   // we will let Ogre access textures using a relative path, which is what we will want for export
   boost::filesystem::path texturedir = meshpath.parent_path();
+  if (profile && tracePath.empty()) {
+    boost::filesystem::path tracepath = meshpath;
+    tracepath.replace_extension(".trace.json");
+    tracePath = tracepath.string();
+  }
+  if (memoryReport && memoryReportPath.empty()) {
+    boost::filesystem::path reportpath = meshpath;
+    reportpath.replace_extension(".memory.json");
+    memoryReportPath = reportpath.string();
+  }
   //  boost::filesystem::path texturedir = meshpath.parent_path() / meshpath.stem();  // slash operator concatenates path components
 
   OgreCollada::MeshWriter writer(texturedir.string());
-  COLLADASaxFWL::Loader loader;
+  writer.setCompactVertices(compact);
+  writer.setSplitLargeSubmeshes(split);
+  writer.setOptimizeVertexCache(optimize);
+  writer.setCalculateGeometryStats(stats);
+  writer.setShareVertices(share);
+  writer.setWeldVertices(weld, weldTolerance);
+  writer.setGenerateLods(lodLevels);
+  writer.setCompressedOutput(compress);
+  writer.setTileSize(tileSize);
+  writer.setImportFilter(filter);
+  if (outOfCoreBudget > 0) {
+    writer.setOutOfCore(texturedir.string(), outOfCoreBudget * 1024 * 1024);
+  }
+  OgreCollada::Profiler profiler;
+  if (profile) {
+    writer.setProfiler(&profiler);
+  }
+  writer.setMemoryAccounting(memoryReport);
+  // called on success, once everything is written
+  auto writeReports = [&]() {
+    if (profile) {
+      profiler.end();    // export
+      std::ostringstream summary;
+      profiler.writeSummary(summary);
+      std::vector<Ogre::String> lines = Ogre::StringUtil::split(summary.str(), "\n");
+      for (size_t i = 0; i < lines.size(); ++i) {
+        LOG_DEBUG(lines[i]);
+      }
+      std::ofstream tracefile(tracePath.c_str());
+      profiler.writeChromeTrace(tracefile);
+      if (!tracefile) {
+        std::cerr << "could not write " << tracePath << "\n";
+        return false;
+      }
+    }
+    if (memoryReport) {
+      const OgreCollada::MemoryAccount& memory = writer.getMemoryAccount();
+      LOG_DEBUG("buffers take " + boost::lexical_cast<Ogre::String>(memory.getTotal().vertexBytes + memory.getTotal().indexBytes) +
+                " bytes and textures " + boost::lexical_cast<Ogre::String>(memory.getTotal().textureBytes) +
+                "; conversion peaked at " + boost::lexical_cast<Ogre::String>(memory.getPeakStagingBytes()) +
+                " bytes of intermediate data");
+      std::ofstream reportfile(memoryReportPath.c_str());
+      memory.writeJson(reportfile);
+      if (!reportfile) {
+        std::cerr << "could not write " << memoryReportPath << "\n";
+        return false;
+      }
+    }
+    return true;
+  };
+  // The same loader for both passes, so unique IDs agree between them.  Each pass parses only
+  // what its writer uses: geometry is left for the second
+  OgreCollada::SaxLoader loader;
+  loader.setExtraDataWriter(&writer);
+  loader.setObjectFlags(OgreCollada::SaxLoader::USED_OBJECTS_MASK & ~COLLADASaxFWL::Loader::GEOMETRY_FLAG);
   COLLADAFW::Root pass1Root(&loader, writer.getPass1ProxyWriter());
+  if (profile) {
+    profiler.begin("pass 1");
+  }
   if (!pass1Root.loadDocument(daepath.string())) {
     std::cerr << "load document failed in pass 1\n";
     return 1;
   }
+  loader.setObjectFlags(COLLADASaxFWL::Loader::GEOMETRY_FLAG);
   COLLADAFW::Root pass2Root(&loader, writer.getPass2ProxyWriter());
+  if (profile) {
+    profiler.end();
+    profiler.begin("pass 2");
+  }
   if (!pass2Root.loadDocument(daepath.string())) {
     std::cerr << "load document failed in pass 2\n";
     return 1;
   }
+  if (profile) {
+    profiler.end();
+    profiler.begin("export");
+  }
 
   // access mesh, materials list and report statistics
   auto const& materials = writer.getMaterials();
@@ -130,6 +341,54 @@ int main(int argc, char *argv[])
   }
   matser.exportQueued(matpath.string());
 
+  if (tileSize > 0) {
+    // one mesh file per tile, and an index giving the name, triangle count, and bounds of each
+    const std::vector<OgreCollada::MeshWriter::Tile>& tiles = writer.getTiles();
+    if (tiles.empty()) {
+      LOG_DEBUG("no mesh created.  exiting.");
+      return 1;
+    }
+    boost::filesystem::path indexpath = meshpath;
+    indexpath.replace_extension(".tiles");
+    std::ofstream indexfile(indexpath.string().c_str());
+    indexfile << "# tile mesh, triangles, bounds minimum x y z, maximum x y z\n";
+    Ogre::MeshSerializer meshser;
+    for (size_t i = 0; i < tiles.size(); ++i) {
+      boost::filesystem::path tilepath = meshpath.parent_path() /
+        (meshpath.stem().string() + "_tile" + boost::lexical_cast<std::string>(i) + ".mesh");
+      meshser.exportMesh(tiles[i].mesh.get(), tilepath.string());
+      const Ogre::AxisAlignedBox& bounds = tiles[i].mesh->getBounds();
+      indexfile << tilepath.filename().string() << " " << tiles[i].triangles << " "
+                << bounds.getMinimum().x << " " << bounds.getMinimum().y << " " << bounds.getMinimum().z << " "
+                << bounds.getMaximum().x << " " << bounds.getMaximum().y << " " << bounds.getMaximum().z << "\n";
+      if (compress && tiles[i].compressed.empty()) {
+        std::cerr << "tile " << i << " is too large to compress; no .cmesh written for it\n";
+      } else if (compress) {
+        tilepath.replace_extension(".cmesh");
+        std::ofstream cmeshfile(tilepath.string().c_str(), std::ios::binary);
+        cmeshfile.write(reinterpret_cast<const char*>(tiles[i].compressed.data()), tiles[i].compressed.size());
+        if (!cmeshfile) {
+          std::cerr << "could not write " << tilepath.string() << "\n";
+          return 1;
+        }
+      }
+    }
+    if (!indexfile) {
+      std::cerr << "could not write " << indexpath.string() << "\n";
+      return 1;
+    }
+    LOG_DEBUG("Created " + boost::lexical_cast<Ogre::String>(tiles.size()) + " tile meshes");
+    return writeReports() ? 0 : 1;
+  }
+
+  if (outOfCoreBudget > 0) {
+    if (!writer.writeOutOfCoreMesh(meshpath.string())) {
+      std::cerr << "could not write " << meshpath.string() << "\n";
+      return 1;
+    }
+    return writeReports() ? 0 : 1;
+  }
+
   Ogre::MeshPtr mesh = writer.getMesh();
   if (mesh.isNull()) {
     LOG_DEBUG("no mesh created.  exiting.");
@@ -139,5 +398,19 @@ int main(int argc, char *argv[])
   Ogre::MeshSerializer meshser;
   meshser.exportMesh(mesh.get(), meshpath.string());
 
-  return 0;
+  if (compress && writer.getCompressedMesh().empty()) {
+    std::cerr << "the mesh is too large to compress; no .cmesh written\n";
+  } else if (compress) {
+    boost::filesystem::path cmeshpath = meshpath;
+    cmeshpath.replace_extension(".cmesh");
+    const std::vector<unsigned char>& cmesh = writer.getCompressedMesh();
+    std::ofstream cmeshfile(cmeshpath.string().c_str(), std::ios::binary);
+    cmeshfile.write(reinterpret_cast<const char*>(cmesh.data()), cmesh.size());
+    if (!cmeshfile) {
+      std::cerr << "could not write " << cmeshpath.string() << "\n";
+      return 1;
+    }
+  }
+
+  return writeReports() ? 0 : 1;
 }
@@ -0,0 +1,142 @@
+// Tests of the bounding volume hierarchy used for picking and region queries, against brute force
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#define BOOST_TEST_MODULE bounding volume hierarchy tests
+#include <boost/test/included/unit_test.hpp>
+
+#include <algorithm>
+#include <random>
+
+#include "OgreColladaBvh.h"
+
+namespace {
+
+// scattered boxes of assorted sizes, with a few null ones (which must never be found)
+std::vector<Ogre::AxisAlignedBox> randomBoxes(std::mt19937& rng, size_t count) {
+  std::uniform_real_distribution<Ogre::Real> position(0, 100), size(0.5f, 5);
+  std::vector<Ogre::AxisAlignedBox> boxes(count);
+  for (size_t i = 0; i < count; ++i) {
+    if (i % 17 == 3) {
+      continue;
+    }
+    Ogre::Vector3 minimum(position(rng), position(rng), position(rng));
+    boxes[i].setExtents(minimum, minimum + Ogre::Vector3(size(rng), size(rng), size(rng)));
+  }
+  return boxes;
+}
+
+// Stands in for an exact test against an item's contents: some items are missed even though
+// the ray enters their boxes, and the rest are hit somewhat beyond where it enters
+bool accepted(Ogre::uint32 item) { return (item % 4) != 0; }
+Ogre::Real exactDistance(Ogre::uint32 item, Ogre::Real entry) { return entry + (item % 3) * 0.25f; }
+
+Ogre::Ray randomRay(std::mt19937& rng, int n) {
+  std::uniform_real_distribution<Ogre::Real> position(-20, 120), direction(-1, 1);
+  Ogre::Vector3 dir(direction(rng), direction(rng), direction(rng));
+  if (n % 5 == 0) {
+    dir[n % 3] = 0;   // parallel to a pair of box faces
+  }
+  dir.normalise();
+  return Ogre::Ray(Ogre::Vector3(position(rng), position(rng), position(rng)), dir);
+}
+
+}
+
+BOOST_AUTO_TEST_CASE( raycast ) {
+  std::mt19937 rng(12345);
+  std::vector<Ogre::AxisAlignedBox> boxes = randomBoxes(rng, 1000);
+  OgreCollada::Bvh bvh;
+  bvh.build(boxes);
+  BOOST_REQUIRE(!bvh.empty());
+
+  size_t hits = 0;
+  for (int n = 0; n < 2000; ++n) {
+    Ogre::Ray ray = randomRay(rng, n);
+
+    Ogre::uint32 expected = OgreCollada::Bvh::NO_ITEM;
+    Ogre::Real expectedDistance = 0;
+    for (Ogre::uint32 i = 0; i < boxes.size(); ++i) {
+      if (boxes[i].isNull() || !accepted(i)) {
+	continue;
+      }
+      std::pair<bool, Ogre::Real> entry = Ogre::Math::intersects(ray, boxes[i]);
+      if (entry.first && ((expected == OgreCollada::Bvh::NO_ITEM) ||
+			  (exactDistance(i, entry.second) < expectedDistance))) {
+	expected = i;
+	expectedDistance = exactDistance(i, entry.second);
+      }
+    }
+
+    Ogre::Real distance = 0;
+    Ogre::uint32 item = bvh.raycast(ray,
+				    [](Ogre::uint32 i, Ogre::Real& d) {
+				      d = exactDistance(i, d);
+				      return accepted(i);
+				    },
+				    distance);
+    if (expected == OgreCollada::Bvh::NO_ITEM) {
+      BOOST_CHECK_EQUAL(OgreCollada::Bvh::NO_ITEM, item);
+      continue;
+    }
+    ++hits;
+    BOOST_REQUIRE_NE(OgreCollada::Bvh::NO_ITEM, item);
+    BOOST_REQUIRE(accepted(item));
+    // a different item is fine only if it is (numerically) just as near
+    BOOST_CHECK_SMALL(distance - expectedDistance, 1e-3f);
+    std::pair<bool, Ogre::Real> entry = Ogre::Math::intersects(ray, boxes[item]);
+    BOOST_REQUIRE(entry.first);
+    BOOST_CHECK_SMALL(distance - exactDistance(item, entry.second), 1e-3f);
+  }
+  // make sure the rays actually exercised something
+  BOOST_CHECK_GT(hits, 200);
+}
+
+BOOST_AUTO_TEST_CASE( query ) {
+  std::mt19937 rng(54321);
+  std::vector<Ogre::AxisAlignedBox> boxes = randomBoxes(rng, 1000);
+  OgreCollada::Bvh bvh;
+  bvh.build(boxes);
+
+  std::uniform_real_distribution<Ogre::Real> position(-10, 110), size(0, 30);
+  size_t found = 0;
+  for (int n = 0; n < 500; ++n) {
+    Ogre::Vector3 minimum(position(rng), position(rng), position(rng));
+    Ogre::AxisAlignedBox region(minimum, minimum + Ogre::Vector3(size(rng), size(rng), size(rng)));
+
+    std::vector<Ogre::uint32> expected;
+    for (Ogre::uint32 i = 0; i < boxes.size(); ++i) {
+      if (!boxes[i].isNull() && boxes[i].intersects(region)) {
+	expected.push_back(i);
+      }
+    }
+    std::vector<Ogre::uint32> items;
+    bvh.query(region, items);
+    std::sort(items.begin(), items.end());
+    BOOST_CHECK(items == expected);
+    found += items.size();
+  }
+  BOOST_CHECK_GT(found, 500);
+}
+
+BOOST_AUTO_TEST_CASE( empty ) {
+  OgreCollada::Bvh bvh;
+  bvh.build(std::vector<Ogre::AxisAlignedBox>(3));   // all null
+  BOOST_CHECK(bvh.empty());
+  Ogre::Real distance = 0;
+  BOOST_CHECK_EQUAL(OgreCollada::Bvh::NO_ITEM,
+		    bvh.raycast(Ogre::Ray(Ogre::Vector3::ZERO, Ogre::Vector3::UNIT_X),
+				[](Ogre::uint32, Ogre::Real&) { return true; }, distance));
+  std::vector<Ogre::uint32> items;
+  bvh.query(Ogre::AxisAlignedBox(-1e6, -1e6, -1e6, 1e6, 1e6, 1e6), items);
+  BOOST_CHECK(items.empty());
+}
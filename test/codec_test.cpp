@@ -0,0 +1,330 @@
+// Round trip tests of the compressed mesh encoder and decoder
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#define BOOST_TEST_MODULE compressed mesh codec tests
+#include <boost/test/included/unit_test.hpp>
+
+#include <cmath>
+#include <cstring>
+
+#include <OgreMeshManager.h>
+#include <OgreSubMesh.h>
+#include <OgreStringConverter.h>
+
+#include "OgreColladaMeshEncoder.h"
+#include "OgreColladaMeshDecoder.h"
+#include "OgreColladaMeshCodecFormat.h"
+#include "test_utils.h"
+
+using namespace OgreCollada::codec;
+
+// Decoding needs a mesh manager and hardware buffers, but not a render system
+struct CodecSetup : OgreSetup {
+  CodecSetup() : OgreSetup("codec_test.log") {}
+};
+BOOST_GLOBAL_FIXTURE( CodecSetup );
+
+namespace {
+
+// compare a decoded vertex buffer against the original, attribute by attribute
+void checkVertices(const OgreCollada::VertexArray& va, Ogre::VertexData* vdata, float positionTolerance) {
+  BOOST_REQUIRE(vdata);
+  BOOST_REQUIRE_EQUAL(va.size(), vdata->vertexCount);
+  Ogre::HardwareVertexBufferSharedPtr vbuf = vdata->vertexBufferBinding->getBuffer(0);
+  size_t floats = vbuf->getVertexSize() / sizeof(float);
+  BOOST_REQUIRE_EQUAL(va.stride(), floats);     // unpacked floats, in the same order as VertexArray
+  const float* decoded = static_cast<const float*>(vbuf->lock(Ogre::HardwareBuffer::HBL_READ_ONLY));
+  for (size_t v = 0; v < va.size(); ++v) {
+    const Ogre::Real* in = va.vertex(v);
+    const float* out = decoded + v * floats;
+    for (int k = 0; k < 3; ++k) {
+      BOOST_CHECK_SMALL(out[k] - in[k], positionTolerance);
+    }
+    if (va.hasNormals) {
+      // octahedral normals come back as unit vectors pointing very nearly the same way
+      Ogre::Vector3 n(out + va.normalOffset());
+      BOOST_CHECK_CLOSE(n.length(), 1.0f, 0.01f);
+      BOOST_CHECK_GT(n.dotProduct(Ogre::Vector3(in + va.normalOffset())), 0.9999f);
+    }
+    if (va.hasUVs) {
+      BOOST_CHECK_SMALL(out[va.uvOffset()] - in[va.uvOffset()], 1e-4f);
+      BOOST_CHECK_SMALL(out[va.uvOffset() + 1] - in[va.uvOffset() + 1], 1e-4f);
+    }
+  }
+  vbuf->unlock();
+}
+
+// Hand-built compressed data, for inputs the encoder never produces.  The vertex arrays have positions
+// only, quantized to 8 bits (two byte planes) within the unit cube
+struct Crafted {
+  std::vector<unsigned char> bytes;
+
+  void u8(unsigned v) { bytes.push_back(v & 0xff); }
+  void u16(unsigned v) { u8(v); u8(v >> 8); }
+  void u32(Ogre::uint32 v) { u16(v & 0xffff); u16(v >> 16); }
+  void f32(float v) {
+    Ogre::uint32 bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    u32(bits);
+  }
+  void varint(Ogre::uint64 v) {
+    while (v >= 0x80) {
+      u8((v & 0x7f) | 0x80);
+      v >>= 7;
+    }
+    u8(v);
+  }
+
+  void header() {
+    bytes.insert(bytes.end(), MAGIC, MAGIC + sizeof(MAGIC));
+    u8(VERSION);
+    for (int i = 0; i < 6; ++i) {
+      f32((i < 3) ? 0 : 1);
+    }
+    f32(2);
+    u8(1);       // shared vertices follow
+  }
+  // the count and attribute header of a vertex array; its two position planes come next
+  void vertexArray(Ogre::uint64 vcount) {
+    varint(vcount);
+    u8(0);
+    u8(0);
+    u8(8);
+    for (int i = 0; i < 6; ++i) {
+      f32((i < 3) ? 0 : 1);
+    }
+  }
+  // An entropy coded stream of "size" zero bytes.  With only one symbol in the table, decoding
+  // never reads any coded bytes past the initial states, however many symbols it produces
+  void zeroStream(Ogre::uint64 size, size_t codedSize) {
+    u8(STREAM_RANS);
+    varint(size);
+    varint(1);
+    u8(0);
+    u16(PROB_SCALE - 1);
+    varint(codedSize);
+    for (unsigned st = 0; st < RANS_STATES; ++st) {
+      u32(RANS_L);
+    }
+    bytes.resize(bytes.size() + codedSize - 4 * RANS_STATES, 0);
+  }
+  // a submesh using the shared vertices with the given index count, and three (zero) indices
+  void submesh(Ogre::uint64 icount) {
+    varint(1);
+    varint(0);
+    u8(Ogre::RenderOperation::OT_TRIANGLE_LIST);
+    u8(1);
+    varint(icount);
+    u8(STREAM_RAW);
+    varint(3);
+    u8(0);
+    u8(0);
+    u8(0);
+  }
+
+  Ogre::MeshPtr decode(const Ogre::String& name) const {
+    return OgreCollada::decodeMesh(name, &bytes[0], bytes.size());
+  }
+};
+
+void checkIndices(const std::vector<Ogre::uint32>& indices, Ogre::IndexData* idata) {
+  BOOST_REQUIRE(idata);
+  BOOST_REQUIRE_EQUAL(indices.size(), idata->indexCount);
+  Ogre::HardwareIndexBufferSharedPtr ibuf = idata->indexBuffer;
+  const void* data = ibuf->lock(Ogre::HardwareBuffer::HBL_READ_ONLY);
+  for (size_t i = 0; i < indices.size(); ++i) {
+    Ogre::uint32 index = (ibuf->getType() == Ogre::HardwareIndexBuffer::IT_16BIT) ?
+      static_cast<const Ogre::uint16*>(data)[i] : static_cast<const Ogre::uint32*>(data)[i];
+    BOOST_REQUIRE_EQUAL(indices[i], index);
+  }
+  ibuf->unlock();
+}
+
+}
+
+BOOST_AUTO_TEST_CASE( round_trip ) {
+  // two triangle submeshes sharing a grid's vertices, and a line submesh with its own positions only
+  const int N = 64;
+  OgreCollada::MeshData md;
+  md.sharedVertices = wavyGrid(N).vertices;
+  md.submeshes.resize(3);
+  md.submeshes[0].materialName = "Top";
+  md.submeshes[0].useSharedVertices = true;
+  gridTriangles(N, 0, N / 2, md.submeshes[0].indices);
+  md.submeshes[1].materialName = "Bottom";
+  md.submeshes[1].useSharedVertices = true;
+  gridTriangles(N, N / 2, N, md.submeshes[1].indices);
+  OgreCollada::SubmeshData& lines = md.submeshes[2];
+  lines.opType = Ogre::RenderOperation::OT_LINE_LIST;
+  for (int i = 0; i < 100; ++i) {
+    float v[3] = { std::cos(i * 0.0628f) * 50, std::sin(i * 0.0628f) * 50, -10 };
+    lines.vertices.data.insert(lines.vertices.data.end(), v, v + 3);
+    lines.indices.push_back(i);
+    lines.indices.push_back((i + 1) % 100);
+  }
+
+  std::vector<unsigned char> compressed;
+  OgreCollada::encodeMesh(md, compressed);
+  // most of the streams are highly compressible, so this will have used the entropy coder
+  size_t rawBytes = (md.sharedVertices.data.size() + lines.vertices.data.size()) * sizeof(float) +
+    (md.submeshes[0].indices.size() + md.submeshes[1].indices.size() + lines.indices.size()) * sizeof(Ogre::uint32);
+  BOOST_CHECK_LT(compressed.size(), rawBytes / 3);
+
+  Ogre::MeshPtr mesh = OgreCollada::decodeMesh("round_trip", &compressed[0], compressed.size());
+  BOOST_REQUIRE(!mesh.isNull());
+  BOOST_REQUIRE_EQUAL(3, mesh->getNumSubMeshes());
+
+  // 16 bit positions relative to the bounds of each vertex array
+  checkVertices(md.sharedVertices, mesh->sharedVertexData, 1e-3f);
+  checkVertices(lines.vertices, mesh->getSubMesh(2)->vertexData, 1e-2f);
+  for (size_t i = 0; i < 3; ++i) {
+    Ogre::SubMesh* sm = mesh->getSubMesh(i);
+    BOOST_CHECK_EQUAL(md.submeshes[i].materialName, sm->getMaterialName());
+    BOOST_CHECK_EQUAL(md.submeshes[i].opType, sm->operationType);
+    BOOST_CHECK_EQUAL(md.submeshes[i].useSharedVertices, sm->useSharedVertices);
+    checkIndices(md.submeshes[i].indices, sm->indexData);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( wide_indices ) {
+  // enough vertices for 32 bit indices, with index deltas spanning nearly the whole range in both directions
+  OgreCollada::MeshData md;
+  md.submeshes.resize(1);
+  OgreCollada::SubmeshData& smd = md.submeshes[0];
+  const Ogre::uint32 V = 70000;
+  for (Ogre::uint32 i = 0; i < V; ++i) {
+    float v[3] = { float(i % 100), float(i / 100), float(i % 7) };
+    smd.vertices.data.insert(smd.vertices.data.end(), v, v + 3);
+  }
+  for (Ogre::uint32 i = 0; i + 2 < V; i += 3) {
+    smd.indices.push_back(i);
+    smd.indices.push_back(V - 1 - i);
+    smd.indices.push_back(i + 1);
+  }
+
+  std::vector<unsigned char> compressed;
+  OgreCollada::encodeMesh(md, compressed);
+  Ogre::MeshPtr mesh = OgreCollada::decodeMesh("wide_indices", &compressed[0], compressed.size());
+  BOOST_REQUIRE(!mesh.isNull());
+  BOOST_REQUIRE_EQUAL(1, mesh->getNumSubMeshes());
+  BOOST_CHECK_EQUAL(Ogre::HardwareIndexBuffer::IT_32BIT, mesh->getSubMesh(0)->indexData->indexBuffer->getType());
+  checkVertices(smd.vertices, mesh->getSubMesh(0)->vertexData, 1e-2f);
+  checkIndices(smd.indices, mesh->getSubMesh(0)->indexData);
+}
+
+BOOST_AUTO_TEST_CASE( truncated ) {
+  OgreCollada::MeshData md;
+  md.sharedVertices = wavyGrid(16).vertices;
+  md.submeshes.resize(1);
+  md.submeshes[0].useSharedVertices = true;
+  gridTriangles(16, 0, 16, md.submeshes[0].indices);
+  std::vector<unsigned char> compressed;
+  OgreCollada::encodeMesh(md, compressed);
+
+  // every prefix must be rejected cleanly, not read past its end
+  for (size_t size = 0; size < compressed.size(); size += 7) {
+    std::vector<unsigned char> prefix(compressed.begin(), compressed.begin() + size);
+    Ogre::MeshPtr mesh = OgreCollada::decodeMesh("truncated" + Ogre::StringConverter::toString(size),
+                                                 prefix.empty() ? 0 : &prefix[0], prefix.size());
+    BOOST_CHECK(mesh.isNull());
+  }
+}
+
+BOOST_AUTO_TEST_CASE( crafted ) {
+  // the hand-built data is valid when its counts and sizes agree
+  Crafted c;
+  c.header();
+  c.vertexArray(100);
+  c.zeroStream(300, 16);
+  c.zeroStream(300, 16);
+  c.submesh(3);
+  Ogre::MeshPtr mesh = c.decode("crafted");
+  BOOST_REQUIRE(!mesh.isNull());
+  BOOST_CHECK_EQUAL(100, mesh->sharedVertexData->vertexCount);
+  BOOST_CHECK_EQUAL(3, mesh->getSubMesh(0)->indexData->indexCount);
+}
+
+BOOST_AUTO_TEST_CASE( inflated_counts ) {
+  // counts beyond the format's limits, or beyond what the rest of the input could possibly hold,
+  // must be rejected before anything is allocated for them
+  const Ogre::uint64 vcounts[] = { Ogre::uint64(1) << 40, MAX_VERTICES + 1, MAX_VERTICES, 1 << 20 };
+  for (size_t i = 0; i < sizeof(vcounts) / sizeof(vcounts[0]); ++i) {
+    Crafted c;
+    c.header();
+    c.vertexArray(vcounts[i]);
+    c.zeroStream(3 * vcounts[i], 16);
+    c.zeroStream(3 * vcounts[i], 16);
+    c.submesh(3);
+    BOOST_CHECK(c.decode("inflated_vertices" + Ogre::StringConverter::toString(i)).isNull());
+  }
+
+  const Ogre::uint64 icounts[] = { Ogre::uint64(1) << 40, MAX_INDICES + 1, 1 << 20, 4 };
+  for (size_t i = 0; i < sizeof(icounts) / sizeof(icounts[0]); ++i) {
+    Crafted c;
+    c.header();
+    c.vertexArray(100);
+    c.zeroStream(300, 16);
+    c.zeroStream(300, 16);
+    c.submesh(icounts[i]);
+    BOOST_CHECK(c.decode("inflated_indices" + Ogre::StringConverter::toString(i)).isNull());
+  }
+}
+
+BOOST_AUTO_TEST_CASE( inflated_sizes ) {
+  // a one-symbol table can claim any size from a few bytes, so streams must be padded to
+  // minCodedSize and sizes beyond that are rejected
+  const size_t V = 20000;
+  for (int padded = 0; padded < 2; ++padded) {
+    Crafted c;
+    c.header();
+    c.vertexArray(V);
+    size_t coded = padded ? minCodedSize(3 * V) : 16;
+    c.zeroStream(3 * V, coded);
+    c.zeroStream(3 * V, coded);
+    c.submesh(3);
+    Ogre::MeshPtr mesh = c.decode("inflated_size" + Ogre::StringConverter::toString(padded));
+    BOOST_CHECK_EQUAL(bool(padded), !mesh.isNull());
+  }
+
+  // stream sizes that don't match the vertex count, including ones that would overflow
+  const Ogre::uint64 sizes[] = { 301, Ogre::uint64(1) << 40, ~Ogre::uint64(0) };
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+    Crafted c;
+    c.header();
+    c.vertexArray(100);
+    c.zeroStream(sizes[i], 16);
+    c.zeroStream(300, 16);
+    c.submesh(3);
+    BOOST_CHECK(c.decode("wrong_size" + Ogre::StringConverter::toString(i)).isNull());
+  }
+}
+
+BOOST_AUTO_TEST_CASE( constant_data ) {
+  // every plane holds a single repeated value, so the encoder has to pad the coded streams
+  OgreCollada::MeshData md;
+  md.submeshes.resize(1);
+  OgreCollada::SubmeshData& smd = md.submeshes[0];
+  const size_t V = 30000;
+  for (size_t i = 0; i < V; ++i) {
+    float v[3] = { 1, 2, 3 };
+    smd.vertices.data.insert(smd.vertices.data.end(), v, v + 3);
+    smd.indices.push_back(i);
+  }
+  std::vector<unsigned char> compressed;
+  BOOST_REQUIRE(OgreCollada::encodeMesh(md, compressed));
+  BOOST_CHECK_GE(compressed.size(), 3 * minCodedSize(3 * V));
+  Ogre::MeshPtr mesh = OgreCollada::decodeMesh("constant_data", &compressed[0], compressed.size());
+  BOOST_REQUIRE(!mesh.isNull());
+  checkVertices(smd.vertices, mesh->getSubMesh(0)->vertexData, 1e-5f);
+  checkIndices(smd.indices, mesh->getSubMesh(0)->indexData);
+}
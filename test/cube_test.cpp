@@ -16,6 +16,7 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 
 #include <boost/test/included/unit_test.hpp>
 
+#include <cmath>
 #include <fstream>
 #include <COLLADAFWRoot.h>
 #include <COLLADASaxFWLLoader.h>
@@ -26,6 +27,8 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 #include <OgreSubEntity.h>
 #include <OgreMesh.h>
 #include <OgreSubMesh.h>
+#include <OgreMeshManager.h>
+#include <OgreMaterialManager.h>
 
 #include "OgreSceneWriter.h"
 
@@ -94,3 +97,79 @@ BOOST_AUTO_TEST_CASE( basic_contents ) {
   // TODO check structure of scene and transform of the entity
 
 }
+
+BOOST_AUTO_TEST_CASE( spatial_index ) {
+
+  // start over, so the import can recreate its mesh and material
+  sceneMgr->clearScene();
+  Ogre::MeshManager::getSingleton().removeAll();
+  Ogre::MaterialManager::getSingleton().remove("LandlordWhite");
+
+  Ogre::SceneNode* topnode = sceneMgr->getRootSceneNode()->createChildSceneNode("Indexed");
+  topnode->setPosition(3, -2, 1);
+
+  OgreCollada::SceneWriter writer(sceneMgr, topnode, ".");
+  writer.setBuildSpatialIndex(true);
+
+  COLLADASaxFWL::Loader loader;
+  COLLADAFW::Root colladaRoot(&loader, &writer);
+  BOOST_REQUIRE(colladaRoot.loadDocument(fname));
+
+  // brute force: every entity in the scene, by its world bounds.  The cube fills its box, so a ray
+  // hits its triangles exactly where it enters the box (less the padding Ogre adds to mesh bounds)
+  std::vector<Ogre::Entity*> entities;
+  Ogre::SceneManager::MovableObjectIterator mit = sceneMgr->getMovableObjectIterator("Entity");
+  while (mit.hasMoreElements()) {
+    entities.push_back(static_cast<Ogre::Entity*>(mit.getNext()));
+  }
+  BOOST_REQUIRE_EQUAL(1, entities.size());
+  Ogre::AxisAlignedBox bounds = entities[0]->getWorldBoundingBox(true);
+  Ogre::Vector3 size = bounds.getSize();
+  Ogre::Real padding = size.length() * Ogre::MeshManager::getSingleton().getBoundsPaddingFactor();
+
+  // rays straight down a grid of points covering the cube and its surroundings
+  size_t hits = 0;
+  for (int i = -4; i <= 12; ++i) {
+    for (int j = -4; j <= 12; ++j) {
+      Ogre::Real u = i / 8.0f, v = j / 8.0f;
+      // stay clear of the edges, where the padding decides
+      if ((std::abs(u) < 0.05f) || (std::abs(u - 1) < 0.05f) || (std::abs(v) < 0.05f) || (std::abs(v - 1) < 0.05f)) {
+	continue;
+      }
+      Ogre::Vector3 origin = bounds.getMinimum() + Ogre::Vector3(u * size.x, v * size.y, 5 * size.z);
+      Ogre::Ray ray(origin, Ogre::Vector3::NEGATIVE_UNIT_Z);
+
+      std::pair<bool, Ogre::Real> expected = Ogre::Math::intersects(ray, bounds);
+      OgreCollada::SceneWriter::PickResult picked = writer.pick(ray);
+      BOOST_CHECK_EQUAL(expected.first, picked.entity != 0);
+      if (expected.first && picked.entity) {
+	++hits;
+	BOOST_CHECK_EQUAL(entities[0], picked.entity);
+	BOOST_CHECK_EQUAL("Cube", picked.nodeId);
+	BOOST_CHECK_SMALL(picked.distance - expected.second, 4 * padding);
+      }
+    }
+  }
+  BOOST_CHECK_GT(hits, 0);
+
+  // region queries: boxes clearly overlapping the cube and clearly apart from it
+  for (int i = -2; i <= 2; ++i) {
+    Ogre::Vector3 offset(i * 0.6f * size.x, 0, 0);
+    Ogre::AxisAlignedBox region(bounds.getMinimum() + offset + size * 0.25f, bounds.getMaximum() + offset - size * 0.25f);
+    std::vector<OgreCollada::SceneWriter::PickResult> found;
+    writer.queryBox(region, found);
+    bool expected = region.intersects(bounds);
+    BOOST_REQUIRE_EQUAL(expected ? 1 : 0, found.size());
+    if (expected) {
+      BOOST_CHECK_EQUAL(entities[0], found[0].entity);
+    }
+  }
+
+  // hidden entities can't be found
+  entities[0]->setVisible(false);
+  Ogre::Ray center(bounds.getCenter() + Ogre::Vector3(0, 0, 4 * size.z), Ogre::Vector3::NEGATIVE_UNIT_Z);
+  BOOST_CHECK(!writer.pick(center).entity);
+  std::vector<OgreCollada::SceneWriter::PickResult> found;
+  writer.queryBox(bounds, found);
+  BOOST_CHECK(found.empty());
+}
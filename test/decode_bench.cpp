@@ -0,0 +1,81 @@
+// Throughput of the compressed mesh decoder, in bytes of vertex and index buffers produced per second
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// Not a unit test (its results depend on the machine), so it isn't registered with ctest.
+// usage: decode_bench [grid size] [repetitions]
+// Decodes a wavy grid of (grid size)^2 squares, with normals and texture coordinates, the given
+// number of times.  Buffers come from DefaultHardwareBufferManager, so no render system is needed
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <OgreMeshManager.h>
+#include <OgreSubMesh.h>
+
+#include "OgreColladaMeshEncoder.h"
+#include "OgreColladaMeshDecoder.h"
+#include "test_utils.h"
+
+int main(int argc, char* argv[]) {
+  int n = (argc > 1) ? std::atoi(argv[1]) : 512;
+  int reps = (argc > 2) ? std::atoi(argv[2]) : 20;
+  if ((n <= 0) || (reps <= 0)) {
+    std::cerr << "usage: decode_bench [grid size] [repetitions]\n";
+    return 1;
+  }
+
+  OgreSetup ogre("decode_bench.log");
+
+  // the kind of data c2mesh compresses: one vertex array shared by a few submeshes
+  OgreCollada::MeshData md;
+  md.sharedVertices = wavyGrid(n).vertices;
+  const int submeshes = 4;
+  md.submeshes.resize(submeshes);
+  for (int s = 0; s < submeshes; ++s) {
+    md.submeshes[s].useSharedVertices = true;
+    gridTriangles(n, n * s / submeshes, n * (s + 1) / submeshes, md.submeshes[s].indices);
+  }
+
+  std::vector<unsigned char> compressed;
+  if (!OgreCollada::encodeMesh(md, compressed)) {
+    std::cerr << "grid too large for the compressed format\n";
+    return 1;
+  }
+
+  size_t output = 0;
+  std::chrono::steady_clock::duration elapsed(0);
+  for (int rep = 0; rep < reps; ++rep) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Ogre::MeshPtr mesh = OgreCollada::decodeMesh("decode_bench", &compressed[0], compressed.size());
+    elapsed += std::chrono::steady_clock::now() - start;
+    if (mesh.isNull()) {
+      std::cerr << "decoding failed\n";
+      return 1;
+    }
+    output = mesh->sharedVertexData->vertexBufferBinding->getBuffer(0)->getSizeInBytes();
+    for (unsigned short s = 0; s < mesh->getNumSubMeshes(); ++s) {
+      output += mesh->getSubMesh(s)->indexData->indexBuffer->getSizeInBytes();
+    }
+    Ogre::MeshManager::getSingleton().remove(mesh->getHandle());
+  }
+
+  double seconds = std::chrono::duration<double>(elapsed).count() / reps;
+  std::cout << md.sharedVertices.size() << " vertices, " << n * n * 2 << " triangles\n";
+  std::cout << "compressed: " << compressed.size() << " bytes; decoded buffers: " << output << " bytes\n";
+  std::cout << "decode: " << seconds * 1e3 << " ms, " << output / seconds / 1e9 << " GB/s of buffers, "
+            << compressed.size() / seconds / 1e6 << " MB/s of input\n";
+
+  return 0;
+}
@@ -0,0 +1,177 @@
+// Microbenchmark of the lookups done while importing: std::map vs. hashing of Collada unique IDs,
+// and scanning material bindings vs. a per-instance table
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// Not a unit test (its results depend on the machine), so it isn't registered with ctest.
+// usage: lookup_bench [model.dae]
+// With a model, the IDs of its nodes, materials, and geometries are used;
+// otherwise 100k nodes and 100k materials are made up
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include <COLLADAFWRoot.h>
+#include <COLLADAFWIWriter.h>
+#include <COLLADAFWNode.h>
+#include <COLLADAFWVisualScene.h>
+#include <COLLADAFWLibraryNodes.h>
+#include <COLLADAFWMaterial.h>
+#include <COLLADAFWGeometry.h>
+#include <COLLADAFWMaterialBinding.h>
+#include <COLLADASaxFWLLoader.h>
+
+#include "OgreColladaWriterBase.h"
+#include "OgreColladaUniqueIdHash.h"
+
+// gather the unique IDs of everything the importer keeps in its containers
+class IdCollector : public OgreCollada::WriterBase {
+public:
+  std::vector<COLLADAFW::UniqueId> ids;
+
+  virtual bool writeVisualScene(const COLLADAFW::VisualScene* vs) {
+    addNodes(vs->getRootNodes());
+    return true;
+  }
+  virtual bool writeLibraryNodes(const COLLADAFW::LibraryNodes* ln) {
+    addNodes(ln->getNodes());
+    return true;
+  }
+  virtual bool writeMaterial(const COLLADAFW::Material* m) {
+    ids.push_back(m->getUniqueId());
+    return true;
+  }
+  virtual bool writeGeometry(const COLLADAFW::Geometry* g) {
+    ids.push_back(g->getUniqueId());
+    return true;
+  }
+  virtual void finish() {}
+
+private:
+  void addNodes(const COLLADAFW::NodePointerArray& roots) {
+    std::vector<const COLLADAFW::Node*> nodes;
+    for (size_t i = 0; i < roots.getCount(); ++i) {
+      nodes.push_back(roots[i]);
+    }
+    while (!nodes.empty()) {
+      const COLLADAFW::Node* n = nodes.back();
+      nodes.pop_back();
+      ids.push_back(n->getUniqueId());
+      for (size_t i = 0; i < n->getChildNodes().getCount(); ++i) {
+	nodes.push_back(n->getChildNodes()[i]);
+      }
+    }
+  }
+};
+
+template<typename F>
+double nsPer(size_t count, F f) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  f();
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / count;
+}
+
+int main(int argc, char* argv[]) {
+  IdCollector collector;
+  if (argc > 1) {
+    COLLADASaxFWL::Loader loader;
+    COLLADAFW::Root root(&loader, &collector);
+    if (!root.loadDocument(argv[1])) {
+      std::cerr << "could not load " << argv[1] << "\n";
+      return 1;
+    }
+  } else {
+    // the class IDs here are arbitrary; the loader numbers objects sequentially within each class
+    for (COLLADAFW::ObjectId i = 0; i < 100000; ++i) {
+      collector.ids.push_back(COLLADAFW::UniqueId(COLLADAFW::ClassId(1), i, 0));
+      collector.ids.push_back(COLLADAFW::UniqueId(COLLADAFW::ClassId(2), i, 0));
+    }
+  }
+  const std::vector<COLLADAFW::UniqueId>& ids = collector.ids;
+  std::cout << ids.size() << " unique IDs\n";
+  if (ids.empty()) {
+    return 1;
+  }
+
+  std::map<COLLADAFW::UniqueId, size_t> ordered;
+  std::unordered_map<COLLADAFW::UniqueId, size_t> hashed;
+  for (size_t i = 0; i < ids.size(); ++i) {
+    ordered[ids[i]] = i;
+    hashed[ids[i]] = i;
+  }
+
+  // look everything up several times, in random order, like instance references do
+  std::vector<COLLADAFW::UniqueId> queries;
+  for (int rep = 0; rep < 5; ++rep) {
+    queries.insert(queries.end(), ids.begin(), ids.end());
+  }
+  std::mt19937 rng(1);
+  std::shuffle(queries.begin(), queries.end(), rng);
+
+  size_t checksum = 0;
+  double mapNs = nsPer(queries.size(), [&]() {
+      for (size_t i = 0; i < queries.size(); ++i) {
+	checksum += ordered.find(queries[i])->second;
+      }
+    });
+  double hashNs = nsPer(queries.size(), [&]() {
+      for (size_t i = 0; i < queries.size(); ++i) {
+	checksum -= hashed.find(queries[i])->second;
+      }
+    });
+  std::cout << "std::map lookup:           " << mapNs << " ns\n";
+  std::cout << "std::unordered_map lookup: " << hashNs << " ns\n";
+
+  // material bindings: an instance binds a handful of material IDs, and each primitive of the
+  // geometry looks up its own.  Compare scanning the bindings (resolving the material each time)
+  // with resolving them once into a table
+  const size_t instances = 100000, bindings = 8, primitives = 8;
+  std::vector<std::pair<COLLADAFW::MaterialId, COLLADAFW::UniqueId> > binding(bindings);
+  for (size_t j = 0; j < bindings; ++j) {
+    binding[j] = std::make_pair(COLLADAFW::MaterialId(j), ids[(j * 7919) % ids.size()]);
+  }
+  size_t lookups = instances * primitives;
+  double scanNs = nsPer(lookups, [&]() {
+      for (size_t inst = 0; inst < instances; ++inst) {
+	for (size_t p = 0; p < primitives; ++p) {
+	  COLLADAFW::MaterialId matid = (p + inst) % bindings;
+	  for (size_t j = 0; j < bindings; ++j) {
+	    if (binding[j].first == matid) {
+	      checksum += ordered.find(binding[j].second)->second;
+	    }
+	  }
+	}
+      }
+    });
+  double tableNs = nsPer(lookups, [&]() {
+      for (size_t inst = 0; inst < instances; ++inst) {
+	std::unordered_map<COLLADAFW::MaterialId, size_t> table;
+	for (size_t j = 0; j < bindings; ++j) {
+	  table[binding[j].first] = hashed.find(binding[j].second)->second;
+	}
+	for (size_t p = 0; p < primitives; ++p) {
+	  checksum -= table.find((p + inst) % bindings)->second;
+	}
+      }
+    });
+  std::cout << "material per primitive, scanning bindings: " << scanNs << " ns\n";
+  std::cout << "material per primitive, binding table:     " << tableNs << " ns\n";
+
+  // keeps the optimizer from discarding the loops
+  return (checksum == 1) ? 2 : 0;
+}
@@ -0,0 +1,150 @@
+// Smoke tests of memory accounting: the account itself, its JSON report, and the charge for generated LODs
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#define BOOST_TEST_MODULE memory account tests
+#include <boost/test/included/unit_test.hpp>
+
+#include <sstream>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include <OgreMeshManager.h>
+#include <OgreSubMesh.h>
+
+#include "OgreColladaMemoryAccount.h"
+#include "OgreColladaMeshSimplifier.h"
+#include "test_utils.h"
+
+// Attaching LODs needs a mesh manager and hardware buffers, but not a render system
+struct MemorySetup : OgreSetup {
+  MemorySetup() : OgreSetup("memory_test.log") {}
+};
+BOOST_GLOBAL_FIXTURE( MemorySetup );
+
+BOOST_AUTO_TEST_CASE( usage ) {
+  OgreCollada::MemoryAccount account;
+  account.addGeometryBuffers("box", 100, 20);
+  account.addGeometryBuffers("box", 50, 10);          // a second submesh, or instance
+  account.addGeometryBuffers("sphere", 1000, 200);
+  account.addMaterialBuffers("wood", 150, 30);
+  account.addMaterialBuffers("metal", 1000, 200);
+  account.addTexture("grain.png", 4096);
+  account.addTexture("grain.png", 4096);               // loaded again: still one texture
+  account.addTexture("scratches.png", 1024);
+  account.addMaterialTexture("wood", "grain.png");
+  account.addMaterialTexture("metal", "grain.png");
+  account.addMaterialTexture("metal", "scratches.png");
+  account.addMaterialTexture("paint", "scratches.png");  // textures only
+
+  BOOST_CHECK_EQUAL(150, account.getGeometryUsage("box").vertexBytes);
+  BOOST_CHECK_EQUAL(30, account.getGeometryUsage("box").indexBytes);
+  BOOST_CHECK_EQUAL(0, account.getGeometryUsage("cone").total());
+  OgreCollada::MemoryAccount::Usage total = account.getTotal();
+  BOOST_CHECK_EQUAL(1150, total.vertexBytes);
+  BOOST_CHECK_EQUAL(230, total.indexBytes);
+  BOOST_CHECK_EQUAL(4096 + 1024, total.textureBytes);   // shared textures counted once
+  BOOST_CHECK_EQUAL(1200 + 4096 + 1024, account.getMaterialUsage("metal").total());
+  BOOST_CHECK_EQUAL(1024, account.getMaterialUsage("paint").total());
+  BOOST_CHECK_EQUAL(3, account.getMaterials().size());
+
+  account.removeGeometry("sphere");
+  BOOST_CHECK_EQUAL(150, account.getTotal().vertexBytes);
+
+  account.stage(500);
+  account.stage(300);
+  account.unstage(500);
+  account.stage(100);
+  BOOST_CHECK_EQUAL(400, account.getStagingBytes());
+  BOOST_CHECK_EQUAL(800, account.getPeakStagingBytes());
+  account.unstage(1000);                               // never below zero
+  BOOST_CHECK_EQUAL(0, account.getStagingBytes());
+
+  account.clear();
+  BOOST_CHECK_EQUAL(0, account.getTotal().total());
+  BOOST_CHECK_EQUAL(0, account.getPeakStagingBytes());
+  BOOST_CHECK(account.getMaterials().empty());
+}
+
+BOOST_AUTO_TEST_CASE( json ) {
+  OgreCollada::MemoryAccount account;
+  account.addGeometryBuffers("small", 10, 2);
+  account.addGeometryBuffers("large \"quoted\"", 1000, 200);
+  account.addGeometryBuffers("medium", 100, 20);
+  account.addMaterialBuffers("wood", 110, 22);
+  account.addTexture("grain.png", 4096);
+  account.addMaterialTexture("wood", "grain.png");
+  account.stage(64);
+
+  std::stringstream json;
+  account.writeJson(json);
+  boost::property_tree::ptree root;
+  BOOST_REQUIRE_NO_THROW(boost::property_tree::read_json(json, root));
+
+  BOOST_CHECK_EQUAL(1110, root.get<size_t>("total.vertexBytes"));
+  BOOST_CHECK_EQUAL(4096, root.get<size_t>("total.textureBytes"));
+  BOOST_CHECK_EQUAL(64, root.get<size_t>("staging.peakBytes"));
+  // largest first
+  std::vector<std::string> names;
+  for (const boost::property_tree::ptree::value_type& g : root.get_child("geometries")) {
+    names.push_back(g.second.get<std::string>("name"));
+  }
+  BOOST_REQUIRE_EQUAL(3, names.size());
+  BOOST_CHECK_EQUAL("large \"quoted\"", names[0]);
+  BOOST_CHECK_EQUAL("medium", names[1]);
+  BOOST_CHECK_EQUAL("small", names[2]);
+  const boost::property_tree::ptree& wood = root.get_child("materials").begin()->second;
+  BOOST_CHECK_EQUAL("wood", wood.get<std::string>("name"));
+  BOOST_CHECK_EQUAL(4096, wood.get<size_t>("textureBytes"));
+  BOOST_CHECK_EQUAL("grain.png", wood.get_child("textures").begin()->second.get_value<std::string>());
+}
+
+BOOST_AUTO_TEST_CASE( lod_buffers ) {
+  // a submesh with its own vertices, one sharing, and one with too many vertices for 16-bit indices
+  OgreCollada::MeshData md;
+  md.submeshes.push_back(grid(30));
+  OgreCollada::SubmeshData shared = grid(20);
+  md.sharedVertices = shared.vertices;
+  shared.vertices = OgreCollada::VertexArray();
+  shared.useSharedVertices = true;
+  md.submeshes.push_back(shared);
+  md.submeshes.push_back(grid(20));
+  md.submeshes.back().vertices.data.resize(3 * (OgreCollada::MAX_16BIT_VERTICES + 10));   // unused, but there
+
+  Ogre::MeshPtr mesh = OgreCollada::createMesh("lod_buffers", md);
+  OgreCollada::LodData lods = OgreCollada::generateLods(md, 3, 0.5f);
+  OgreCollada::applyLods(mesh, md, lods, 2);
+
+  std::vector<size_t> bytes;
+  OgreCollada::lodIndexBytes(md, lods, bytes);
+  BOOST_REQUIRE_EQUAL(md.submeshes.size(), bytes.size());
+  for (size_t i = 0; i < md.submeshes.size(); ++i) {
+    // what the account is told must be what the buffers take
+    size_t actual = 0;
+    const Ogre::SubMesh* sm = mesh->getSubMesh(i);
+    BOOST_REQUIRE_EQUAL(3, sm->mLodFaceList.size());
+    for (size_t level = 0; level < sm->mLodFaceList.size(); ++level) {
+      if (!sm->mLodFaceList[level]->indexBuffer.isNull()) {
+	actual += sm->mLodFaceList[level]->indexBuffer->getSizeInBytes();
+      }
+    }
+    BOOST_CHECK_GT(bytes[i], 0);
+    BOOST_CHECK_EQUAL(actual, bytes[i]);
+  }
+  // the last submesh needed 32-bit indices
+  size_t wide = 0;
+  for (size_t level = 0; level < lods.indices.size(); ++level) {
+    wide += lods.indices[level][2].size();
+  }
+  BOOST_CHECK_EQUAL(sizeof(Ogre::uint32) * wide, bytes[2]);
+}
@@ -0,0 +1,190 @@
+// Tests of out-of-core mesh output: the .mesh file it writes, read back by Ogre, against the same data built in memory
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#define BOOST_TEST_MODULE out-of-core mesh tests
+#include <boost/test/included/unit_test.hpp>
+
+#include <fstream>
+#include <map>
+
+#include <OgreDataStream.h>
+#include <OgreMeshManager.h>
+#include <OgreMeshSerializer.h>
+#include <OgreSubMesh.h>
+
+#include "OgreColladaMeshData.h"
+#include "OgreColladaOutOfCoreMesh.h"
+#include "test_utils.h"
+
+// Reading meshes needs a mesh manager and hardware buffers, but not a render system
+struct OutOfCoreSetup : OgreSetup {
+  OutOfCoreSetup() : OgreSetup("outofcore_test.log") {}
+};
+BOOST_GLOBAL_FIXTURE( OutOfCoreSetup );
+
+namespace {
+
+// Geometry as a renderer sees it: for each material, the attributes of every vertex each primitive
+// refers to, in order.  That is what must survive regrouping the submeshes and renumbering their vertices
+typedef std::map<Ogre::String, std::vector<float> > Expanded;
+
+Expanded expand(Ogre::Mesh* mesh) {
+  Expanded result;
+  for (unsigned short s = 0; s < mesh->getNumSubMeshes(); ++s) {
+    Ogre::SubMesh* sm = mesh->getSubMesh(s);
+    std::vector<float>& out = result[sm->getMaterialName()];
+    Ogre::VertexData* vdata = sm->useSharedVertices ? mesh->sharedVertexData : sm->vertexData;
+    BOOST_REQUIRE(vdata);
+
+    // every attribute here is made of floats
+    const Ogre::VertexElementSemantic semantics[] = { Ogre::VES_POSITION, Ogre::VES_NORMAL, Ogre::VES_TEXTURE_COORDINATES };
+    std::vector<const Ogre::VertexElement*> elements;
+    for (int e = 0; e < 3; ++e) {
+      if (const Ogre::VertexElement* ve = vdata->vertexDeclaration->findElementBySemantic(semantics[e])) {
+	BOOST_REQUIRE_EQUAL(0, ve->getSource());
+	elements.push_back(ve);
+      }
+    }
+    Ogre::HardwareVertexBufferSharedPtr vbuf = vdata->vertexBufferBinding->getBuffer(0);
+    const unsigned char* vertices = static_cast<const unsigned char*>(vbuf->lock(Ogre::HardwareBuffer::HBL_READ_ONLY));
+    Ogre::HardwareIndexBufferSharedPtr ibuf = sm->indexData->indexBuffer;
+    const void* indices = ibuf->lock(Ogre::HardwareBuffer::HBL_READ_ONLY);
+    bool wide = (ibuf->getType() == Ogre::HardwareIndexBuffer::IT_32BIT);
+    for (size_t i = sm->indexData->indexStart; i < sm->indexData->indexStart + sm->indexData->indexCount; ++i) {
+      Ogre::uint32 idx = wide ? static_cast<const Ogre::uint32*>(indices)[i] : static_cast<const Ogre::uint16*>(indices)[i];
+      BOOST_REQUIRE_LT(idx, vdata->vertexStart + vdata->vertexCount);
+      const unsigned char* vertex = vertices + (vdata->vertexStart + idx) * vbuf->getVertexSize();
+      for (size_t e = 0; e < elements.size(); ++e) {
+	const float* f = reinterpret_cast<const float*>(vertex + elements[e]->getOffset());
+	out.insert(out.end(), f, f + Ogre::VertexElement::getTypeCount(elements[e]->getType()));
+      }
+    }
+    ibuf->unlock();
+    vbuf->unlock();
+  }
+  return result;
+}
+
+Ogre::MeshPtr readMesh(const Ogre::String& fileName, const Ogre::String& name) {
+  std::ifstream file(fileName.c_str(), std::ios::binary);
+  Ogre::DataStreamPtr stream(new Ogre::FileStreamDataStream(&file, false));
+  Ogre::MeshPtr mesh = Ogre::MeshManager::getSingleton().createManual(name, "General");
+  Ogre::MeshSerializer serializer;
+  serializer.importMesh(stream, mesh.get());
+  return mesh;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE( matches_in_core ) {
+  // Submeshes of two materials and several vertex layouts, one of them using shared vertices,
+  // added over several calls and with a budget small enough to spill repeatedly
+  std::vector<OgreCollada::MeshData> parts(3);
+  parts[0].submeshes.push_back(wavyGrid(20, 0, true, true));
+  parts[0].submeshes.back().materialName = "Red";
+  parts[0].submeshes.push_back(wavyGrid(12, 5, false, false));
+  parts[0].submeshes.back().materialName = "Blue";
+  parts[1].sharedVertices = wavyGrid(16, 10, true, true).vertices;
+  parts[1].submeshes.push_back(wavyGrid(16, 10, true, true));
+  parts[1].submeshes.back().vertices = OgreCollada::VertexArray();
+  parts[1].submeshes.back().useSharedVertices = true;
+  parts[1].submeshes.back().materialName = "Red";
+  parts[2].submeshes.push_back(wavyGrid(8, 15, true, false));
+  parts[2].submeshes.back().materialName = "Red";
+  parts[2].submeshes.push_back(wavyGrid(8, 20, false, false));
+  parts[2].submeshes.back().materialName = "Blue";
+  parts[2].submeshes.back().opType = Ogre::RenderOperation::OT_LINE_LIST;   // odd lines, but lines all the same
+
+  ScratchDir scratch("outofcore_test");
+  Ogre::String fileName = (scratch.path / "out.mesh").string();
+  size_t budget = 16 * 1024;
+  {
+    OgreCollada::OutOfCoreMesh ooc(scratch.path.string(), budget);
+    for (size_t i = 0; i < parts.size(); ++i) {
+      BOOST_REQUIRE(ooc.add(parts[i]));
+    }
+    BOOST_CHECK_EQUAL(4, ooc.getSubmeshCount());    // by material, primitive type, and vertex attributes
+    BOOST_CHECK_GT(ooc.getSpilledBytes(), 0);
+    BOOST_REQUIRE(ooc.write(fileName));
+  }
+  // the spill files are gone with it
+  BOOST_CHECK_EQUAL(1, std::distance(boost::filesystem::directory_iterator(scratch.path),
+				     boost::filesystem::directory_iterator()));
+
+  // the same data the usual way: everything in one mesh built in memory
+  OgreCollada::MeshData whole;
+  for (size_t i = 0; i < parts.size(); ++i) {
+    OgreCollada::MeshData part = parts[i];
+    OgreCollada::appendMeshData(part, whole, OgreCollada::MAX_16BIT_VERTICES);
+  }
+  Ogre::MeshPtr inCore = OgreCollada::createMesh("in_core", whole);
+  Ogre::MeshPtr outOfCore = readMesh(fileName, "out_of_core");
+
+  BOOST_CHECK_EQUAL(4, outOfCore->getNumSubMeshes());
+  BOOST_CHECK(expand(outOfCore.get()) == expand(inCore.get()));
+  // exact bounds, where Ogre pads those of meshes built in memory
+  Ogre::AxisAlignedBox bounds = OgreCollada::computeBounds(whole.sharedVertices);
+  for (size_t i = 0; i < whole.submeshes.size(); ++i) {
+    bounds.merge(OgreCollada::computeBounds(whole.submeshes[i].vertices));
+  }
+  BOOST_CHECK_EQUAL(bounds.getMinimum(), outOfCore->getBounds().getMinimum());
+  BOOST_CHECK_EQUAL(bounds.getMaximum(), outOfCore->getBounds().getMaximum());
+  for (unsigned short s = 0; s < outOfCore->getNumSubMeshes(); ++s) {
+    BOOST_CHECK(!outOfCore->getSubMesh(s)->useSharedVertices);
+    BOOST_CHECK_EQUAL(Ogre::HardwareIndexBuffer::IT_16BIT, outOfCore->getSubMesh(s)->indexData->indexBuffer->getType());
+  }
+}
+
+BOOST_AUTO_TEST_CASE( budget_per_submesh ) {
+  // many submeshes in one call, each well under the budget but together far over it
+  OgreCollada::MeshData md;
+  for (int i = 0; i < 20; ++i) {
+    md.submeshes.push_back(wavyGrid(10, float(i), true, false));
+  }
+  size_t submeshBytes = OgreCollada::dataBytes(md) / md.submeshes.size();
+  size_t budget = 3 * submeshBytes;
+
+  ScratchDir scratch("outofcore_test");
+  OgreCollada::OutOfCoreMesh ooc(scratch.path.string(), budget);
+  BOOST_REQUIRE(ooc.add(md));
+  // the whole call's data was never held at once
+  BOOST_CHECK_LE(ooc.getPeakBufferedBytes(), budget + submeshBytes);
+  BOOST_CHECK_GT(ooc.getSpilledBytes(), 0);
+
+  Ogre::String fileName = (scratch.path / "out.mesh").string();
+  BOOST_REQUIRE(ooc.write(fileName));
+  Ogre::MeshPtr outOfCore = readMesh(fileName, "budget_out_of_core");
+  Ogre::MeshPtr inCore = OgreCollada::createMesh("budget_in_core", md);
+  BOOST_CHECK(expand(outOfCore.get()) == expand(inCore.get()));
+}
+
+BOOST_AUTO_TEST_CASE( wide_indices ) {
+  // more vertices than 16-bit indices can reach, in one bucket
+  OgreCollada::MeshData md;
+  md.submeshes.push_back(wavyGrid(200, 0, false, true));
+  md.submeshes.push_back(wavyGrid(200, 1, false, true));
+  md.submeshes[0].materialName = md.submeshes[1].materialName = "Wide";
+
+  ScratchDir scratch("outofcore_test");
+  Ogre::String fileName = (scratch.path / "out.mesh").string();
+  {
+    OgreCollada::OutOfCoreMesh ooc(scratch.path.string(), 256 * 1024);
+    BOOST_REQUIRE(ooc.add(md));
+    BOOST_REQUIRE(ooc.write(fileName));
+  }
+  Ogre::MeshPtr outOfCore = readMesh(fileName, "wide_out_of_core");
+  BOOST_REQUIRE_EQUAL(1, outOfCore->getNumSubMeshes());
+  BOOST_CHECK_EQUAL(Ogre::HardwareIndexBuffer::IT_32BIT, outOfCore->getSubMesh(0)->indexData->indexBuffer->getType());
+  Ogre::MeshPtr inCore = OgreCollada::createMesh("wide_in_core", md);
+  BOOST_CHECK(expand(outOfCore.get()) == expand(inCore.get()));
+}
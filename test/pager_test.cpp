@@ -0,0 +1,180 @@
+// Tests of the scene pager: pages come and go with the viewpoint, within the memory budget
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#define BOOST_TEST_MODULE scene pager tests
+#include <boost/test/included/unit_test.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <set>
+#include <thread>
+
+#include <OgreEntity.h>
+#include <OgreMeshManager.h>
+#include <OgreMeshSerializer.h>
+#include <OgreSceneManager.h>
+#include <OgreSceneNode.h>
+#include <OgreStringConverter.h>
+
+#include "OgreColladaMeshData.h"
+#include "OgreColladaScenePager.h"
+#include "test_utils.h"
+
+// Loading pages needs meshes, entities, and hardware buffers, but not a render system
+struct PagerSetup : OgreSetup {
+  PagerSetup() : OgreSetup("pager_test.log") {
+    sceneMgr = root->createSceneManager(Ogre::ST_GENERIC);
+  }
+  ~PagerSetup() {
+    root->destroySceneManager(sceneMgr);
+  }
+  static Ogre::SceneManager* sceneMgr;
+};
+Ogre::SceneManager* PagerSetup::sceneMgr = 0;
+BOOST_GLOBAL_FIXTURE( PagerSetup );
+
+namespace {
+
+const int GOOD_PAGES = 5;
+
+// A directory of pages along the X axis, ten units apart, each a small grid in its own .mesh file.
+// Beyond them are a page whose file isn't a mesh and one whose file is missing
+struct PageSet {
+  PageSet() : scratch("pager_test"), dir(scratch.path), pageSize(0) {
+    manifest = (dir / "pages.txt").string();
+    std::ofstream index(manifest.c_str());
+    index << "# mesh triangles minimum maximum" << std::endl;
+    for (int p = 0; p < GOOD_PAGES; ++p) {
+      OgreCollada::MeshData md;
+      OgreCollada::SubmeshData smd;
+      const int n = 8;
+      for (int y = 0; y <= n; ++y) {
+	for (int x = 0; x <= n; ++x) {
+	  Ogre::Real v[3] = { 10.0f * p + Ogre::Real(x) / n, Ogre::Real(y) / n, 0 };
+	  smd.vertices.data.insert(smd.vertices.data.end(), v, v + 3);
+	}
+      }
+      gridTriangles(n, 0, n, smd.indices);
+      md.submeshes.push_back(smd);
+
+      Ogre::String file = "page" + Ogre::StringConverter::toString(p) + ".mesh";
+      Ogre::MeshPtr mesh = OgreCollada::createMesh("pager_test_source", md);
+      Ogre::MeshSerializer serializer;
+      serializer.exportMesh(mesh.get(), (dir / file).string());
+      Ogre::MeshManager::getSingleton().remove(mesh->getHandle());
+
+      // all the pages are alike, so they take the same space
+      pageSize = size_t(boost::filesystem::file_size(dir / file));
+      index << file << " " << 2 * n * n << " " << 10 * p << " 0 0 " << 10 * p + 1 << " 1 0" << std::endl;
+    }
+
+    std::ofstream bad((dir / "bad.mesh").string().c_str(), std::ios::binary);
+    bad << "this is not a mesh, though it is about as long as one.";
+    for (size_t i = 0; i < pageSize / 8; ++i) {
+      bad << "garbage!";
+    }
+    index << "bad.mesh 128 100 0 0 101 1 0" << std::endl;
+    index << "missing.mesh 128 110 0 0 111 1 0" << std::endl;
+  }
+  ScratchDir scratch;
+  boost::filesystem::path dir;          // the scratch directory
+  Ogre::String manifest;
+  size_t pageSize;
+};
+
+// The page files whose meshes are in the scene, as the names of the entities under the pager's node
+std::set<Ogre::String> loadedFiles(Ogre::SceneNode* parent, const Ogre::String& manifest) {
+  std::set<Ogre::String> files;
+  Ogre::Node::ChildNodeIterator cit = parent->getChildIterator();
+  while (cit.hasMoreElements()) {
+    Ogre::SceneNode::ObjectIterator oit = static_cast<Ogre::SceneNode*>(cit.getNext())->getAttachedObjectIterator();
+    while (oit.hasMoreElements()) {
+      Ogre::String name = static_cast<Ogre::Entity*>(oit.getNext())->getMesh()->getName();
+      files.insert(name.substr(manifest.size() + 1));    // after the manifest name and a colon
+    }
+  }
+  return files;
+}
+
+// Keep updating, as an application would every frame, until the expected pages are in and nothing else
+// is on its way (by the memory charged)
+bool settle(OgreCollada::ScenePager& pager, const Ogre::Vector3& viewpoint, size_t loaded, size_t bytes) {
+  for (int i = 0; i < 1000; ++i) {
+    pager.update(viewpoint);
+    if ((pager.getLoadedPageCount() == loaded) && (pager.getMemoryUsed() == bytes)) {
+      pager.update(viewpoint);   // and make sure it stays that way
+      return (pager.getLoadedPageCount() == loaded) && (pager.getMemoryUsed() == bytes);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return false;
+}
+
+std::set<Ogre::String> files(int first, int last) {
+  std::set<Ogre::String> result;
+  for (int p = first; p <= last; ++p) {
+    result.insert("page" + Ogre::StringConverter::toString(p) + ".mesh");
+  }
+  return result;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE( load_unload_budget ) {
+  PageSet pages;
+  Ogre::SceneNode* parent = PagerSetup::sceneMgr->getRootSceneNode()->createChildSceneNode();
+  {
+    // room for two pages and a bit
+    OgreCollada::ScenePager pager(PagerSetup::sceneMgr, parent, 2 * pages.pageSize + pages.pageSize / 2);
+    BOOST_REQUIRE(pager.loadManifest(pages.manifest));
+    BOOST_CHECK_EQUAL(GOOD_PAGES + 2, pager.getPageCount());
+    BOOST_CHECK_EQUAL(0, pager.getLoadedPageCount());
+    BOOST_CHECK_EQUAL(0, pager.getMemoryUsed());
+
+    // the two nearest the viewpoint, at the start of the row
+    BOOST_REQUIRE(settle(pager, Ogre::Vector3(-5, 0, 0), 2, 2 * pages.pageSize));
+    BOOST_CHECK(loadedFiles(parent, pages.manifest) == files(0, 1));
+
+    // moving to the other end swaps them for the last two
+    BOOST_REQUIRE(settle(pager, Ogre::Vector3(10 * GOOD_PAGES + 5, 0, 0), 2, 2 * pages.pageSize));
+    BOOST_CHECK(loadedFiles(parent, pages.manifest) == files(GOOD_PAGES - 2, GOOD_PAGES - 1));
+    BOOST_CHECK(Ogre::MeshManager::getSingleton().getByName(pages.manifest + ":page0.mesh").isNull());
+
+    // a smaller budget drops the farther one
+    pager.setMemoryBudget(pages.pageSize);
+    BOOST_REQUIRE(settle(pager, Ogre::Vector3(10 * GOOD_PAGES + 5, 0, 0), 1, pages.pageSize));
+    BOOST_CHECK(loadedFiles(parent, pages.manifest) == files(GOOD_PAGES - 1, GOOD_PAGES - 1));
+  }
+  // the pager takes its pages, meshes, and node with it
+  BOOST_CHECK_EQUAL(0, parent->numChildren());
+  BOOST_CHECK(Ogre::MeshManager::getSingleton().getByName(pages.manifest + ":page" +
+							  Ogre::StringConverter::toString(GOOD_PAGES - 1) + ".mesh").isNull());
+  PagerSetup::sceneMgr->destroySceneNode(parent);
+}
+
+BOOST_AUTO_TEST_CASE( bad_pages ) {
+  PageSet pages;
+  Ogre::SceneNode* parent = PagerSetup::sceneMgr->getRootSceneNode()->createChildSceneNode();
+  {
+    OgreCollada::ScenePager pager(PagerSetup::sceneMgr, parent, 100 * pages.pageSize);
+    BOOST_REQUIRE(pager.loadManifest(pages.manifest));
+
+    // Right next to the damaged page, which is wanted first.  It fails, and the rest still load;
+    // nothing stays charged for the failed pages
+    BOOST_REQUIRE(settle(pager, Ogre::Vector3(100, 0, 0), GOOD_PAGES, GOOD_PAGES * pages.pageSize));
+    BOOST_CHECK(loadedFiles(parent, pages.manifest) == files(0, GOOD_PAGES - 1));
+    BOOST_CHECK(Ogre::MeshManager::getSingleton().getByName(pages.manifest + ":bad.mesh").isNull());
+  }
+  BOOST_CHECK_EQUAL(0, parent->numChildren());
+  PagerSetup::sceneMgr->destroySceneNode(parent);
+}
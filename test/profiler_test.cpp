@@ -0,0 +1,130 @@
+// Smoke tests of the import profiler: nesting, threads, counters, and its two report formats
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#define BOOST_TEST_MODULE profiler tests
+#include <boost/test/included/unit_test.hpp>
+
+#include <set>
+#include <sstream>
+#include <thread>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include "OgreColladaProfiler.h"
+
+namespace {
+
+// a small import-shaped workload: nested phases on this thread, one more phase on a worker
+void record(OgreCollada::Profiler& profiler) {
+  {
+    OgreCollada::ProfileScope load(&profiler, "load");
+    {
+      OgreCollada::ProfileScope geometry(&profiler, "writeGeometry", "needs \"quoting\"\n");
+      profiler.count("triangles", 12);
+    }
+    {
+      OgreCollada::ProfileScope geometry(&profiler, "writeGeometry", "plain");
+      profiler.count("triangles", 30);
+    }
+    std::thread worker([&profiler]() {
+	OgreCollada::ProfileScope lods(&profiler, "generateLods");
+	profiler.count("triangles", 0.5);
+      });
+    worker.join();
+  }
+  OgreCollada::ProfileScope nothing(static_cast<OgreCollada::Profiler*>(0), "ignored");   // no profiler, no effect
+}
+
+}
+
+BOOST_AUTO_TEST_CASE( counters ) {
+  OgreCollada::Profiler profiler;
+  record(profiler);
+  BOOST_CHECK_EQUAL(42.5, profiler.getCount("triangles"));
+  BOOST_CHECK_EQUAL(0, profiler.getCount("never counted"));
+  profiler.clear();
+  BOOST_CHECK_EQUAL(0, profiler.getCount("triangles"));
+}
+
+BOOST_AUTO_TEST_CASE( chrome_trace ) {
+  OgreCollada::Profiler profiler;
+  record(profiler);
+  profiler.begin("by hand");
+  profiler.end();
+  profiler.end();                   // unbalanced; ignored
+  profiler.begin("never ended");    // left out, having no duration
+
+  std::stringstream trace;
+  profiler.writeChromeTrace(trace);
+  boost::property_tree::ptree root;
+  BOOST_REQUIRE_NO_THROW(boost::property_tree::read_json(trace, root));
+
+  size_t threadNames = 0, scopes = 0, samples = 0;
+  std::set<std::string> names, details, tids;
+  for (const boost::property_tree::ptree::value_type& ev : root.get_child("traceEvents")) {
+    std::string ph = ev.second.get<std::string>("ph");
+    if (ph == "M") {
+      ++threadNames;
+    } else if (ph == "X") {
+      ++scopes;
+      names.insert(ev.second.get<std::string>("name"));
+      tids.insert(ev.second.get<std::string>("tid"));
+      BOOST_CHECK_GE(ev.second.get<double>("dur"), 0);
+      if (boost::optional<std::string> detail = ev.second.get_optional<std::string>("args.detail")) {
+	details.insert(*detail);
+      }
+    } else if (ph == "C") {
+      ++samples;
+    }
+  }
+  BOOST_CHECK_EQUAL(2, threadNames);
+  BOOST_CHECK_EQUAL(5, scopes);       // load, two writeGeometry, generateLods, and "by hand"
+  BOOST_CHECK_EQUAL(3, samples);
+  BOOST_CHECK_EQUAL(2, tids.size());
+  BOOST_CHECK(names.count("generateLods") && names.count("by hand") && !names.count("never ended"));
+  BOOST_CHECK(details.count("needs \"quoting\"\n") && details.count("plain"));
+}
+
+BOOST_AUTO_TEST_CASE( summary ) {
+  OgreCollada::Profiler profiler;
+  record(profiler);
+
+  std::stringstream summary;
+  profiler.writeSummary(summary, 1);
+  std::string text = summary.str();
+  size_t slowest = text.find("\nslowest:\n");
+  BOOST_REQUIRE_NE(std::string::npos, slowest);
+  std::string phases = text.substr(0, slowest), rest = text.substr(slowest);
+
+  // writeGeometry is nested under load and listed once for both calls; the worker's phase is a root of its own
+  BOOST_CHECK_NE(std::string::npos, phases.find("  load\n"));
+  BOOST_CHECK_NE(std::string::npos, phases.find("  generateLods\n"));
+  size_t geometry = phases.find("    writeGeometry\n");
+  BOOST_REQUIRE_NE(std::string::npos, geometry);
+  BOOST_CHECK_EQUAL(geometry, phases.rfind("    writeGeometry\n"));
+  std::istringstream line(phases.substr(phases.rfind('\n', geometry) + 1));
+  double total, self;
+  size_t calls;
+  BOOST_REQUIRE(line >> total >> self >> calls);
+  BOOST_CHECK_EQUAL(2, calls);
+
+  // only the slowest detailed scope is named, and the counter totals follow
+  size_t named = 0;
+  for (size_t p = rest.find("writeGeometry "); p != std::string::npos; p = rest.find("writeGeometry ", p + 1)) {
+    ++named;
+  }
+  BOOST_CHECK_EQUAL(1, named);
+  BOOST_CHECK_NE(std::string::npos, rest.find("\ncounters:\n"));
+  BOOST_CHECK_NE(std::string::npos, rest.find(" 42.5  triangles\n"));
+}
@@ -0,0 +1,137 @@
+// Tests of the quadric error mesh simplifier used to generate levels of detail
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#define BOOST_TEST_MODULE mesh simplifier tests
+#include <boost/test/included/unit_test.hpp>
+
+#include <map>
+#include <set>
+
+#include "OgreColladaMeshSimplifier.h"
+#include "test_utils.h"
+
+namespace {
+
+// edges used by only one triangle, in both orders
+std::set<std::pair<Ogre::uint32, Ogre::uint32> > openEdges(const std::vector<Ogre::uint32>& indices) {
+  std::map<std::pair<Ogre::uint32, Ogre::uint32>, int> uses;
+  for (size_t t = 0; t < indices.size() / 3; ++t) {
+    for (int k = 0; k < 3; ++k) {
+      Ogre::uint32 a = indices[3*t + k], b = indices[3*t + (k + 1) % 3];
+      ++uses[std::make_pair(std::min(a, b), std::max(a, b))];
+    }
+  }
+  std::set<std::pair<Ogre::uint32, Ogre::uint32> > result;
+  for (std::map<std::pair<Ogre::uint32, Ogre::uint32>, int>::const_iterator it = uses.begin(); it != uses.end(); ++it) {
+    if (it->second == 1) {
+      result.insert(it->first);
+    }
+  }
+  return result;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE( triangle_targets ) {
+  const int N = 60;
+  OgreCollada::MeshData md;
+  md.submeshes.push_back(grid(N));
+  size_t original = md.submeshes[0].indices.size() / 3;
+
+  OgreCollada::LodData lods = OgreCollada::generateLods(md, 3, 0.5f);
+  BOOST_REQUIRE_EQUAL(3, lods.triangleCounts.size());
+  BOOST_REQUIRE_EQUAL(3, lods.indices.size());
+  size_t previous = original;
+  for (size_t level = 0; level < 3; ++level) {
+    size_t target = size_t(original * std::pow(0.5f, Ogre::Real(level + 1)));
+    BOOST_CHECK_EQUAL(lods.triangleCounts[level], lods.indices[level][0].size() / 3);
+    BOOST_CHECK_LE(lods.triangleCounts[level], target);
+    BOOST_CHECK_LT(lods.triangleCounts[level], previous);
+    // collapses stop at the target, so we shouldn't undershoot it by much
+    BOOST_CHECK_GE(lods.triangleCounts[level], target - target / 10);
+    previous = lods.triangleCounts[level];
+  }
+}
+
+BOOST_AUTO_TEST_CASE( boundary_preserved ) {
+  const int N = 40;
+  OgreCollada::MeshData md;
+  md.submeshes.push_back(grid(N));
+  const OgreCollada::SubmeshData& smd = md.submeshes[0];
+  std::set<std::pair<Ogre::uint32, Ogre::uint32> > original = openEdges(smd.indices);
+  BOOST_REQUIRE_EQUAL(4 * N, original.size());
+
+  OgreCollada::LodData lods = OgreCollada::generateLods(md, 2, 0.5f);
+  for (size_t level = 0; level < 2; ++level) {
+    // open edges are locked, so the outline of the grid must come through unchanged
+    BOOST_CHECK(openEdges(lods.indices[level][0]) == original);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( closed_mesh_never_empty ) {
+  // a cube has no open edges to lock, so nothing stops it collapsing to nothing
+  OgreCollada::MeshData md;
+  md.submeshes.push_back(OgreCollada::SubmeshData());
+  OgreCollada::SubmeshData& cube = md.submeshes[0];
+  for (int v = 0; v < 8; ++v) {
+    cube.vertices.data.push_back(v & 1);
+    cube.vertices.data.push_back((v >> 1) & 1);
+    cube.vertices.data.push_back((v >> 2) & 1);
+  }
+  Ogre::uint32 faces[6][4] = { { 0, 2, 3, 1 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 },
+                               { 2, 6, 7, 3 }, { 0, 4, 6, 2 }, { 1, 3, 7, 5 } };
+  for (int f = 0; f < 6; ++f) {
+    Ogre::uint32 tris[6] = { faces[f][0], faces[f][1], faces[f][2], faces[f][0], faces[f][2], faces[f][3] };
+    cube.indices.insert(cube.indices.end(), tris, tris + 6);
+  }
+
+  OgreCollada::LodData lods = OgreCollada::generateLods(md, 4, 0.1f);
+  size_t previous = cube.indices.size() / 3;
+  for (size_t level = 0; level < 4; ++level) {
+    BOOST_CHECK_GT(lods.triangleCounts[level], 0);
+    BOOST_CHECK_LE(lods.triangleCounts[level], previous);
+    BOOST_CHECK_EQUAL(0, lods.indices[level][0].size() % 3);
+    previous = lods.triangleCounts[level];
+  }
+}
+
+BOOST_AUTO_TEST_CASE( indices_in_range ) {
+  // two submeshes of different sizes, one sharing vertices, simplified on two threads
+  OgreCollada::MeshData md;
+  md.submeshes.push_back(grid(30));
+  OgreCollada::SubmeshData shared = grid(20);
+  md.sharedVertices = shared.vertices;
+  shared.vertices = OgreCollada::VertexArray();
+  shared.useSharedVertices = true;
+  md.submeshes.push_back(shared);
+
+  OgreCollada::LodData lods = OgreCollada::generateLods(md, 4, 0.5f, 2);
+  OgreCollada::LodData serial = OgreCollada::generateLods(md, 4, 0.5f, 1);
+  for (size_t level = 0; level < 4; ++level) {
+    for (size_t i = 0; i < md.submeshes.size(); ++i) {
+      const std::vector<Ogre::uint32>& indices = lods.indices[level][i];
+      size_t vcount = md.submeshes[i].useSharedVertices ? md.sharedVertices.size() : md.submeshes[i].vertices.size();
+      BOOST_CHECK_EQUAL(0, indices.size() % 3);
+      for (size_t j = 0; j < indices.size(); ++j) {
+        BOOST_REQUIRE_LT(indices[j], vcount);
+      }
+      // no collapsed (degenerate) triangles survive
+      for (size_t t = 0; t < indices.size() / 3; ++t) {
+        BOOST_CHECK((indices[3*t] != indices[3*t+1]) && (indices[3*t+1] != indices[3*t+2]) &&
+                    (indices[3*t] != indices[3*t+2]));
+      }
+      // dividing the work among threads doesn't change it
+      BOOST_CHECK(indices == serial.indices[level][i]);
+    }
+  }
+}
@@ -0,0 +1,110 @@
+// Scaffolding shared by the unit tests: Ogre without a render system, grids of test geometry,
+// and scratch directories
+// Author: agent <agent@local>
+
+/*
+Copyright (c) 2026 agent
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef OGRE_COLLADA_TEST_UTILS_H
+#define OGRE_COLLADA_TEST_UTILS_H
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#define BOOST_FILESYSTEM_VERSION 3
+#include <boost/filesystem.hpp>
+
+#include <OgreRoot.h>
+#include <OgreMeshManager.h>
+#include <OgreDefaultHardwareBufferManager.h>
+
+#include "OgreColladaMeshData.h"
+
+// Building and reading meshes needs a mesh manager and hardware buffers, but not a render system.
+// Each test derives a global fixture from this, naming its log
+struct OgreSetup {
+  explicit OgreSetup(const char* logName) : root(new Ogre::Root("", "", logName)),
+                                            bufferManager(new Ogre::DefaultHardwareBufferManager) {}
+  ~OgreSetup() {
+    Ogre::MeshManager::getSingleton().removeAll();   // while their buffers can still be released
+    delete bufferManager;
+    delete root;
+  }
+  Ogre::Root* root;
+  Ogre::DefaultHardwareBufferManager* bufferManager;
+};
+
+// the two triangles of each square in rows [firstRow, lastRow) of an n by n grid of squares,
+// whose (n + 1)^2 vertices are numbered row by row
+inline void gridTriangles(int n, int firstRow, int lastRow, std::vector<Ogre::uint32>& indices) {
+  for (int y = firstRow; y < lastRow; ++y) {
+    for (int x = 0; x < n; ++x) {
+      Ogre::uint32 a = y * (n + 1) + x, b = a + 1, c = a + n + 1, d = c + 1;
+      Ogre::uint32 tris[6] = { a, b, c, b, d, c };
+      indices.insert(indices.end(), tris, tris + 6);
+    }
+  }
+}
+
+// a bumpy (so not trivially collapsible) grid of n by n squares, positions only
+inline OgreCollada::SubmeshData grid(int n) {
+  OgreCollada::SubmeshData smd;
+  for (int y = 0; y <= n; ++y) {
+    for (int x = 0; x <= n; ++x) {
+      smd.vertices.data.push_back(x);
+      smd.vertices.data.push_back(y);
+      smd.vertices.data.push_back(0.3f * std::sin(x * 0.2f) * std::cos(y * 0.15f));
+    }
+  }
+  gridTriangles(n, 0, n, smd.indices);
+  return smd;
+}
+
+// an n by n grid of squares over a wavy surface, starting at the given height, optionally with
+// matching normals and texture coordinates
+inline OgreCollada::SubmeshData wavyGrid(int n, float height = 0, bool normals = true, bool uvs = true) {
+  OgreCollada::SubmeshData smd;
+  smd.vertices.hasNormals = normals;
+  smd.vertices.hasUVs = uvs;
+  for (int y = 0; y <= n; ++y) {
+    for (int x = 0; x <= n; ++x) {
+      Ogre::Vector3 normal(-0.3f * std::cos(x * 0.3f) * std::cos(y * 0.2f),
+                           0.2f * std::sin(x * 0.3f) * std::sin(y * 0.2f), 1);
+      normal.normalise();
+      float v[8] = { float(x), float(y), height + std::sin(x * 0.3f) * std::cos(y * 0.2f),
+                     normal.x, normal.y, normal.z, float(x) / n, float(y) / n };
+      smd.vertices.data.insert(smd.vertices.data.end(), v, v + 3);
+      if (normals) {
+        smd.vertices.data.insert(smd.vertices.data.end(), v + 3, v + 6);
+      }
+      if (uvs) {
+        smd.vertices.data.insert(smd.vertices.data.end(), v + 6, v + 8);
+      }
+    }
+  }
+  gridTriangles(n, 0, n, smd.indices);
+  return smd;
+}
+
+// a fresh directory under the system's temporary one, removed with everything in it afterwards
+struct ScratchDir {
+  explicit ScratchDir(const std::string& prefix)
+    : path(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path(prefix + "-%%%%-%%%%")) {
+    boost::filesystem::create_directories(path);
+  }
+  ~ScratchDir() {
+    boost::system::error_code ec;
+    boost::filesystem::remove_all(path, ec);
+  }
+  boost::filesystem::path path;
+};
+
+#endif // OGRE_COLLADA_TEST_UTILS_H